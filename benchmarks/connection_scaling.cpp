@@ -0,0 +1,168 @@
+
+#include <iostream>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <sys/resource.h>
+#include "argparser.h"
+#include "network/reactor.h"
+
+/**
+ * \file connection_scaling.cpp
+ * \brief Measures how a Reactor scales with the number of connections
+ *
+ * Runs an echo server on a Reactor thread, listening on loopback, then connects 1, 2, 4... up to the maximum number
+ * of clients to it. For each connection count it measures how fast the connections are established, then runs a
+ * number of rounds where every client sends a small message and a client-side Reactor waits for all the echoes.
+ * Round trip throughput should stay flat as connections grow, since epoll only reports the descriptors that are
+ * ready. The open file limit is raised as far as allowed, and the connection count is capped to fit in it.
+ *
+ * Usage: `bench_connection_scaling [--connections=<max clients>] [--rounds=<rounds>] [--port=<port>]`
+ */
+
+/**
+ * Message each client sends per round
+ */
+static const char message[] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+static const ulong message_size = sizeof(message) - 1;
+
+/**
+ * Read everything available on a non-blocking socket, optionally echoing it back
+ *
+ * \return Bytes read, or -1 if the connection closed or failed
+ */
+static long drain(network::Socket& socket, bool echo) {
+    char buffer[4096];
+    long total = 0;
+    while (true) {
+        network::IOResult result = socket.recv_into(buffer, sizeof(buffer));
+        if (result.would_block()) {
+            return total;
+        }
+        if (!result.ok() || result.bytes == 0) {
+            return -1;
+        }
+        if (echo) {
+            socket.send_all(buffer, result.bytes);
+        }
+        total += (long)result.bytes;
+    }
+}
+
+/**
+ * Serve echo connections on a Reactor until it is stopped
+ */
+static void serve(network::Reactor& reactor, network::Socket& listener) {
+    std::vector<std::unique_ptr<network::Socket>> clients;
+    std::vector<network::Socket> accepted;
+    reactor.add(listener, network::IO_READ, [&](uint) {
+        listener.accept_many(accepted);
+        for (auto& socket : accepted) {
+            network::Socket* client = new network::Socket(std::move(socket));
+            clients.emplace_back(client);
+            reactor.add(client->get_fd(), network::IO_READ, [&reactor, client](uint) {
+                if (drain(*client, true) < 0) {
+                    reactor.remove(client->get_fd());
+                }
+            });
+        }
+        accepted.clear();
+    });
+    reactor.run();
+    for (auto& client : clients) {
+        reactor.remove(client->get_fd());
+    }
+    reactor.remove(listener.get_fd());
+}
+
+/**
+ * Raise the open file limit as high as allowed
+ *
+ * \return New limit
+ */
+static ulong raise_file_limit() {
+    rlimit limit {};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return (ulong)limit.rlim_cur;
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    ulong max_connections = args.has_variable("connections") ? std::stoul(args.get_variable("connections")) : 4096;
+    ulong rounds = args.has_variable("rounds") ? std::stoul(args.get_variable("rounds")) : 20;
+    ushort port = args.has_variable("port") ? (ushort)std::stoul(args.get_variable("port")) : 7001;
+    
+    // Each connection needs a descriptor on both ends, plus a few spare
+    ulong limit = raise_file_limit();
+    max_connections = std::min(max_connections, (limit - 32) / 2);
+    
+    network::Reactor server;
+    network::Socket listener((ushort)AF_INET, (uint)SOCK_STREAM);
+    int reuse = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &reuse);
+    listener.bind(port);
+    listener.listen(4096);
+    std::thread server_thread(serve, std::ref(server), std::ref(listener));
+    
+    std::cout << "connections,connects_per_sec,rounds,round_trips_per_sec,round_p50_us,round_max_us" << std::endl;
+    for (ulong connections = 1; connections <= max_connections;
+         connections = connections < max_connections && connections * 2 > max_connections ? max_connections :
+                       connections * 2) {
+        network::Reactor client;
+        std::vector<network::Socket> sockets;
+        sockets.reserve(connections);
+        auto start = std::chrono::steady_clock::now();
+        for (ulong i = 0; i < connections; ++i) {
+            sockets.emplace_back((ushort)AF_INET, (uint)SOCK_STREAM);
+            sockets.back().connect("127.0.0.1", port);
+        }
+        std::chrono::duration<double> connect_time = std::chrono::steady_clock::now() - start;
+        
+        ulong received = 0;
+        for (auto& socket : sockets) {
+            network::Socket* target = &socket;
+            client.add(socket, network::IO_READ, [target, &received](uint) {
+                long count = drain(*target, false);
+                if (count > 0) {
+                    received += (ulong)count;
+                }
+            });
+        }
+        
+        std::vector<ulong> round_times;
+        start = std::chrono::steady_clock::now();
+        for (ulong round = 0; round < rounds; ++round) {
+            auto round_start = std::chrono::steady_clock::now();
+            received = 0;
+            for (auto& socket : sockets) {
+                socket.send_all(message, message_size);
+            }
+            while (received < connections * message_size) {
+                client.run_once(std::chrono::milliseconds(1000));
+            }
+            round_times.push_back((ulong)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - round_start
+            ).count());
+        }
+        std::chrono::duration<double> echo_time = std::chrono::steady_clock::now() - start;
+        std::sort(round_times.begin(), round_times.end());
+        
+        std::cout << connections << "," << (ulong)((double)connections / connect_time.count()) << "," << rounds
+                  << "," << (ulong)((double)(connections * rounds) / echo_time.count()) << ","
+                  << (round_times.empty() ? 0 : round_times[round_times.size() / 2]) << ","
+                  << (round_times.empty() ? 0 : round_times.back()) << std::endl;
+        
+        for (auto& socket : sockets) {
+            client.remove(socket.get_fd());
+        }
+    }
+    
+    server.stop();
+    server_thread.join();
+    return 0;
+}
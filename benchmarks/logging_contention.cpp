@@ -0,0 +1,87 @@
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include "argparser.h"
+#include "at_logging"
+
+/**
+ * \file logging_contention.cpp
+ * \brief Measures logging throughput as threads are added
+ *
+ * Every thread logs to the same logger and handler. Logging directly is compared against the same work serialized
+ * by one global mutex, which is what callers had to do before loggers were thread-safe.
+ *
+ * Usage: `bench_logging_contention [--messages=<per thread>] [--threads=<max threads>]`
+ */
+
+/**
+ * Handler that only counts what reaches it, so the benchmark measures the logging path rather than output
+ */
+class CountingHandler : public logging::Handler {
+public:
+    
+    ulong count = 0;
+    
+    void log(const std::string& message, const logging::Level*) override {
+        count += message.size() > 0;
+    }
+    
+};
+
+static std::mutex global_mutex;
+
+/**
+ * Log from a number of threads at once, and return the total messages per second
+ */
+static double run(logging::Logger* logger, uint threads, ulong messages, bool global_lock) {
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (uint t = 0; t < threads; ++t) {
+        workers.emplace_back([=]() {
+            std::string message = "worker " + std::to_string(t) + " reporting";
+            for (ulong i = 0; i < messages; ++i) {
+                if (global_lock) {
+                    std::lock_guard<std::mutex> guard(global_mutex);
+                    logger->info(message);
+                } else {
+                    logger->info(message);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)(threads * messages) / elapsed.count();
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    ulong messages = args.has_variable("messages") ? std::stoul(args.get_variable("messages")) : 200000;
+    uint max_threads = args.has_variable("threads") ? (uint)std::stoul(args.get_variable("threads")) :
+                       std::max(1u, std::thread::hardware_concurrency());
+    
+    logging::Logger* logger = logging::get_logger("bench.contention");
+    logger->set_propagation(false);
+    logger->set_level(logging::INFO);
+    logger->set_pattern("%l %n: %m");
+    CountingHandler handler;
+    logger->add_handler(&handler);
+    
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "direct msg/s" << std::setw(20)
+              << "global mutex msg/s" << std::endl;
+    for (uint threads = 1; threads <= max_threads; threads *= 2) {
+        double direct = run(logger, threads, messages, false);
+        double locked = run(logger, threads, messages, true);
+        std::cout << std::setw(8) << threads << std::setw(16) << (ulong)direct << std::setw(20) << (ulong)locked
+                  << std::endl;
+    }
+    
+    logger->remove_handler(&handler);
+    return 0;
+}
@@ -0,0 +1,206 @@
+
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "argparser.h"
+#include "at_logging"
+
+/**
+ * \file logging_throughput.cpp
+ * \brief Measures logging throughput and per-call latency
+ *
+ * Each case is run at 1, 2, 4... up to the maximum thread count, with every thread logging to the same logger. One
+ * pass measures messages per second without timing individual calls, and a second pass times every call to find
+ * the 50th, 99th and 99.9th percentile latency. Results are printed one row per case and thread count, as CSV or
+ * as JSON lines, so they can be compared between builds by scripts.
+ *
+ * Cases:
+ * - disabled: the message level is below the logger's level
+ * - no_handlers: the level is enabled but no logger has a handler
+ * - null_handler: the message is formatted and passed to a handler that discards it
+ * - file_handler: the message is written by a FileHandler
+ * - deep_hierarchy: a logger nested 8 levels deep by auto_parent, with no level of its own, propagating to a null
+ *   handler on its top ancestor
+ *
+ * Usage: `bench_logging_throughput [--messages=<per thread>] [--threads=<max threads>] [--cases=<a,b,...>]
+ * [--format=csv|json] [--file=<log file>]`
+ */
+
+/**
+ * Handler that formats every record and throws it away, so the benchmark measures the logging path rather than
+ * output
+ */
+class NullHandler : public logging::Handler {
+public:
+    
+    void log(const std::string&, const logging::Level*) override {}
+    
+};
+
+/**
+ * Results of one case at one thread count
+ */
+struct BenchResult {
+    double per_second;
+    ulong p50;
+    ulong p99;
+    ulong p999;
+};
+
+/**
+ * A logger configured for one case, and the level messages are logged at
+ */
+struct BenchCase {
+    std::string name;
+    logging::Logger* logger;
+    logging::Level* level;
+};
+
+/**
+ * Run one pass of a case from a number of threads at once. If latencies is given, every call is timed and the
+ * durations in nanoseconds are appended to it
+ */
+static double run_pass(const BenchCase& bench, uint threads, ulong messages, std::vector<ulong>* latencies) {
+    std::vector<std::vector<ulong>> timings(threads);
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (uint t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::string message = "worker " + std::to_string(t) + " handled request";
+            if (latencies == nullptr) {
+                for (ulong i = 0; i < messages; ++i) {
+                    bench.logger->log(message, bench.level);
+                }
+                return;
+            }
+            std::vector<ulong>& local = timings[t];
+            local.reserve(messages);
+            for (ulong i = 0; i < messages; ++i) {
+                auto before = std::chrono::steady_clock::now();
+                bench.logger->log(message, bench.level);
+                auto after = std::chrono::steady_clock::now();
+                local.push_back((ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (latencies != nullptr) {
+        for (auto& local : timings) {
+            latencies->insert(latencies->end(), local.begin(), local.end());
+        }
+    }
+    return (double)(threads * messages) / elapsed.count();
+}
+
+/**
+ * Get a percentile of a set of latencies, partially reordering them
+ */
+static ulong percentile(std::vector<ulong>& latencies, double fraction) {
+    if (latencies.empty()) {
+        return 0;
+    }
+    ulong index = std::min(latencies.size() - 1, (ulong)(fraction * (double)latencies.size()));
+    std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies[index];
+}
+
+/**
+ * Measure one case at one thread count
+ */
+static BenchResult measure(const BenchCase& bench, uint threads, ulong messages) {
+    BenchResult result {};
+    result.per_second = run_pass(bench, threads, messages, nullptr);
+    std::vector<ulong> latencies;
+    latencies.reserve(threads * messages);
+    run_pass(bench, threads, messages, &latencies);
+    result.p50 = percentile(latencies, 0.5);
+    result.p99 = percentile(latencies, 0.99);
+    result.p999 = percentile(latencies, 0.999);
+    return result;
+}
+
+/**
+ * Get the next thread count to run at, doubling each time but always finishing on the maximum
+ */
+static uint next_threads(uint threads, uint max_threads) {
+    if (threads < max_threads && threads * 2 > max_threads) {
+        return max_threads;
+    }
+    return threads * 2;
+}
+
+/**
+ * Get a logger for a case that doesn't propagate to the root logger, so the default handlers don't run
+ */
+static logging::Logger* isolated_logger(const std::string& name, logging::Level* level) {
+    logging::Logger* logger = logging::get_logger(name);
+    logger->set_propagation(false);
+    logger->set_level(level);
+    logger->set_pattern("%l %n: %m");
+    return logger;
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    ulong messages = args.has_variable("messages") ? std::stoul(args.get_variable("messages")) : 100000;
+    uint max_threads = args.has_variable("threads") ? (uint)std::stoul(args.get_variable("threads")) :
+                       std::max(1u, std::thread::hardware_concurrency());
+    std::string cases = args.has_variable("cases") ? args.get_variable("cases") : "";
+    bool json = args.has_variable("format") && args.get_variable("format") == "json";
+    std::string filename = args.has_variable("file") ? args.get_variable("file") : "bench_logging_throughput.log";
+    
+    logging::get_root_logger();
+    NullHandler null_handler;
+    logging::FileHandler* file_handler = new logging::FileHandler(filename);
+    
+    logging::Logger* file_logger = isolated_logger("bench.throughput.file", logging::INFO);
+    file_logger->add_handler(file_handler);
+    logging::Logger* null_logger = isolated_logger("bench.throughput.null", logging::INFO);
+    null_logger->add_handler(&null_handler);
+    logging::Logger* deep_root = isolated_logger("bench.throughput.deep", logging::INFO);
+    deep_root->add_handler(&null_handler);
+    logging::Logger* deep_logger = logging::get_logger("bench.throughput.deep.a.b.c.d.e.f.g.h");
+    
+    std::vector<BenchCase> all = {
+        {"disabled", isolated_logger("bench.throughput.disabled", logging::WARN), logging::INFO},
+        {"no_handlers", isolated_logger("bench.throughput.empty", logging::INFO), logging::INFO},
+        {"null_handler", null_logger, logging::INFO},
+        {"file_handler", file_logger, logging::INFO},
+        {"deep_hierarchy", deep_logger, logging::INFO}
+    };
+    
+    if (!json) {
+        std::cout << "case,threads,messages,msgs_per_sec,p50_ns,p99_ns,p999_ns" << std::endl;
+    }
+    for (auto& bench : all) {
+        if (!cases.empty() && ("," + cases + ",").find("," + bench.name + ",") == std::string::npos) {
+            continue;
+        }
+        for (uint threads = 1; threads <= max_threads; threads = next_threads(threads, max_threads)) {
+            BenchResult result = measure(bench, threads, messages);
+            if (json) {
+                std::cout << "{\"case\":\"" << bench.name << "\",\"threads\":" << threads << ",\"messages\":"
+                          << threads * messages << ",\"msgs_per_sec\":" << (ulong)result.per_second
+                          << ",\"p50_ns\":" << result.p50 << ",\"p99_ns\":" << result.p99 << ",\"p999_ns\":"
+                          << result.p999 << "}" << std::endl;
+            } else {
+                std::cout << bench.name << "," << threads << "," << threads * messages << ","
+                          << (ulong)result.per_second << "," << result.p50 << "," << result.p99 << ","
+                          << result.p999 << std::endl;
+            }
+        }
+    }
+    
+    file_logger->remove_handler(file_handler);
+    null_logger->remove_handler(&null_handler);
+    deep_root->remove_handler(&null_handler);
+    delete file_handler;
+    std::remove(filename.c_str());
+    return 0;
+}
@@ -0,0 +1,126 @@
+
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include "argparser.h"
+#include "network/socket.h"
+
+/**
+ * \file unix_latency.cpp
+ * \brief Compares round trip latency over loopback TCP and Unix domain sockets
+ *
+ * For each transport, runs an echo thread on one end of a connection and sends a message back and forth from the
+ * other end, timing every round trip. Loopback TCP has NODELAY set, so the comparison is between the TCP/IP stack
+ * and the Unix socket path rather than Nagle's algorithm. Unix sockets are measured as a stream bound to an
+ * abstract name, and as a seqpacket connection, which keeps message boundaries. Reports the median, 99th percentile
+ * and throughput of round trips for each message size.
+ *
+ * Usage: `bench_unix_latency [--rounds=<round trips>] [--sizes=<comma separated message sizes>] [--port=<port>]`
+ */
+
+/**
+ * Echo messages of a fixed size until the peer closes the connection
+ */
+static void echo(network::Socket socket, ulong size) {
+    std::vector<char> buffer(size);
+    while (socket.recv_exact(buffer.data(), size).bytes == size) {
+        if (!socket.send_all(buffer.data(), size).ok()) {
+            break;
+        }
+    }
+}
+
+/**
+ * Time round trips of one message size on a connected socket whose peer echoes
+ *
+ * \return Round trip times in nanoseconds, sorted
+ */
+static std::vector<ulong> measure(network::Socket& socket, ulong size, ulong rounds) {
+    std::vector<char> message(size, 'x');
+    std::vector<char> reply(size);
+    std::vector<ulong> times;
+    times.reserve(rounds);
+    for (ulong round = 0; round < rounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        socket.send_all(message.data(), size);
+        if (socket.recv_exact(reply.data(), size).bytes != size) {
+            break;
+        }
+        times.push_back((ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start
+        ).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+/**
+ * Connect a client to a fresh listener, run an echo thread on the accepted end, and report its round trips
+ */
+static void run(const std::string& transport, ulong size, ulong rounds, network::Socket listener,
+                const std::function<network::Socket()>& connect) {
+    listener.listen(1);
+    network::Socket client = connect();
+    std::thread server(echo, listener.accept(), size);
+    
+    measure(client, size, rounds / 10 + 1);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ulong> times = measure(client, size, rounds);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    client.shutdown(SHUT_RDWR);
+    server.join();
+    
+    std::cout << transport << "," << size << "," << times.size() << ","
+              << (times.empty() ? 0 : times[times.size() / 2]) << ","
+              << (times.empty() ? 0 : times[times.size() * 99 / 100]) << ","
+              << (ulong)((double)times.size() / elapsed.count()) << std::endl;
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    ulong rounds = args.has_variable("rounds") ? std::stoul(args.get_variable("rounds")) : 20000;
+    std::string size_list = args.has_variable("sizes") ? args.get_variable("sizes") : "16,256,4096,65536";
+    ushort port = args.has_variable("port") ? (ushort)std::stoul(args.get_variable("port")) : 7002;
+    
+    std::vector<ulong> sizes;
+    for (ulong start = 0; start < size_list.size();) {
+        ulong end = std::min(size_list.find(',', start), size_list.size());
+        sizes.push_back(std::stoul(size_list.substr(start, end - start)));
+        start = end + 1;
+    }
+    
+    std::cout << "transport,message_size,round_trips,p50_ns,p99_ns,round_trips_per_sec" << std::endl;
+    for (ulong size : sizes) {
+        network::Socket tcp((ushort)AF_INET, (uint)SOCK_STREAM);
+        tcp.set(network::SockOpt::REUSEADDR, 1);
+        tcp.bind(port);
+        run("tcp_loopback", size, rounds, std::move(tcp), [port]() {
+            network::Socket socket((ushort)AF_INET, (uint)SOCK_STREAM);
+            socket.connect("127.0.0.1", port);
+            socket.set(network::SockOpt::NODELAY, 1);
+            return socket;
+        });
+        
+        std::string name = network::abstract_name("bench_unix_latency." + std::to_string(port));
+        network::Socket stream((ushort)AF_UNIX, (uint)SOCK_STREAM);
+        stream.bind(name);
+        run("unix_stream", size, rounds, std::move(stream), [&name]() {
+            network::Socket socket((ushort)AF_UNIX, (uint)SOCK_STREAM);
+            socket.connect(name);
+            return socket;
+        });
+        
+        network::Socket seqpacket((ushort)AF_UNIX, (uint)SOCK_SEQPACKET);
+        seqpacket.bind(name);
+        run("unix_seqpacket", size, rounds, std::move(seqpacket), [&name]() {
+            network::Socket socket((ushort)AF_UNIX, (uint)SOCK_SEQPACKET);
+            socket.connect(name);
+            return socket;
+        });
+    }
+    return 0;
+}
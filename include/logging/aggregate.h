@@ -0,0 +1,206 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+#include "handler.h"
+
+/**
+ * \file aggregate.h
+ * \brief Coalescing repeated log messages
+ *
+ * Contains a handler that sits in front of another handler and collapses bursts of identical messages into a single
+ * line with a repeat count, while keeping a running estimate of which messages are logged most often.
+ */
+
+/**
+ * Default number of most frequent messages an AggregatingHandler reports
+ */
+#define AT_AGGREGATE_TOP 10
+
+namespace logging {
+
+/**
+ * How often one message has been logged, as reported by AggregatingHandler::get_top
+ */
+struct MessageCount {
+    std::string name;
+    const Level* level;
+    std::string message;
+    ulong count;
+};
+
+/**
+ * \internal
+ *
+ * Coalescing state for one distinct message within its current window
+ */
+struct __AggregateEntry {
+    const Level* level;
+    std::string name;
+    std::string message;
+    std::string text;
+    std::chrono::steady_clock::time_point start;
+    ulong suppressed;
+};
+
+/**
+ * \internal
+ *
+ * A Space-Saving counter for one candidate frequent message. The true count is between count - error and count.
+ * Counters are kept in a min-heap on count, and know their place in it so a count can be raised in place
+ */
+struct __TopCounter {
+    const Level* level;
+    std::string name;
+    std::string message;
+    ulong count;
+    ulong error;
+    ulong hash;
+    ulong position;
+};
+
+/**
+ * A handler that coalesces identical messages. Messages are identical if they come from the same logger at the same
+ * level with the same unformatted message, so patterns with timestamps don't defeat coalescing. The first time a
+ * message is seen it's passed on immediately and opens a window. Repeats within the window are counted and dropped
+ * before they are formatted, and once the window ends a single line reporting how many repeats were dropped is
+ * passed on, as `<first text> (repeated N more times)`.
+ *
+ * Ended windows are only reported as later records arrive, when flush is called, or when the handler is destroyed,
+ * so after a burst followed by silence the summary waits for one of those. Call flush periodically, such as from a
+ * timer, to report ended windows promptly. The handler also estimates the most frequent messages it has seen, using
+ * a fixed number of counters, which get_top reports.
+ */
+class AggregatingHandler : public Handler {
+    
+    Handler* inner;
+    std::chrono::steady_clock::duration window;
+    std::chrono::steady_clock::time_point last_sweep;
+    std::unordered_multimap<ulong, __AggregateEntry> entries;
+    std::vector<__TopCounter> counters;
+    std::vector<__TopCounter*> heap;
+    std::unordered_multimap<ulong, __TopCounter*> counter_index;
+    ulong top_count;
+    ulong counter_limit;
+    ulong suppressed_total;
+    
+    /**
+     * Hash the identity of a record
+     *
+     * \param record Record to hash
+     * \return Hash of the logger, level and message
+     */
+    static ulong key(const Record& record);
+    
+    /**
+     * Find the open entry for a record's message, comparing the message itself rather than only its hash. Must be
+     * called with the handler lock held
+     *
+     * \param hash Hash of the record
+     * \param record Record to find the entry of
+     * \return The entry, or the end of the entries if the message has none
+     */
+    std::unordered_multimap<ulong, __AggregateEntry>::iterator find_entry(ulong hash, const Record& record);
+    
+    /**
+     * Move a counter towards the leaves of the heap until it's no larger than its children
+     *
+     * \param counter Counter whose count was raised
+     */
+    void sift_down(__TopCounter* counter);
+    
+    /**
+     * Move a counter towards the root of the heap until it's no smaller than its parent
+     *
+     * \param counter Counter just added to the end of the heap
+     */
+    void sift_up(__TopCounter* counter);
+    
+    /**
+     * Count a message towards the frequent message estimate. When every counter is in use, the smallest, at the
+     * root of the heap, is taken over by the new message. Must be called with the handler lock held
+     *
+     * \param hash Identity of the message
+     * \param record Record being counted
+     */
+    void count(ulong hash, const Record& record);
+    
+    /**
+     * Collect the summary line for an entry, if it dropped any repeats
+     *
+     * \param entry Entry whose window ended
+     * \param out List of summaries to append to
+     */
+    static void summarize(const __AggregateEntry& entry, std::vector<__AggregateEntry>& out);
+    
+    /**
+     * Remove every entry whose window has ended, collecting their summaries. Must be called with the handler lock
+     * held
+     *
+     * \param now Current time
+     * \param all Whether to end every window, regardless of age
+     * \param out List of summaries to append to
+     */
+    void sweep(std::chrono::steady_clock::time_point now, bool all, std::vector<__AggregateEntry>& out);
+    
+    /**
+     * Pass summary lines to the wrapped handler. Called without the handler lock held
+     *
+     * \param summaries Summaries to pass on
+     */
+    void emit(const std::vector<__AggregateEntry>& summaries);
+    
+public:
+    
+    /**
+     * Construct a new AggregatingHandler in front of a handler, coalescing repeats within a window and tracking
+     * the top_count most frequent messages
+     *
+     * \param inner Handler to pass records to. Not owned by this handler
+     * \param window How long repeats of a message are coalesced after it's first seen
+     * \param top_count Number of frequent messages to track
+     */
+    AggregatingHandler(Handler* inner, std::chrono::milliseconds window, ulong top_count = AT_AGGREGATE_TOP);
+    
+    /**
+     * Deconstruct an AggregatingHandler, passing on summaries of any repeats still open. The wrapped handler must
+     * still exist
+     */
+    ~AggregatingHandler() override;
+    
+    /**
+     * End every open window now, passing on summaries of any dropped repeats
+     */
+    void flush();
+    
+    /**
+     * Get the estimated most frequent messages, most frequent first. Counts may overestimate messages that entered
+     * the tracked set late, but any message logged more than 1 / (4 * top_count) of the time is always included
+     *
+     * \return Up to top_count most frequent messages
+     */
+    std::vector<MessageCount> get_top();
+    
+    /**
+     * Get the total number of repeats dropped over the life of the handler
+     *
+     * \return Number of dropped repeats
+     */
+    ulong get_suppressed();
+    
+    bool accepts(const Record& record) override;
+    
+    bool needs_text() const override;
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
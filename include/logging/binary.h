@@ -0,0 +1,202 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <streambuf>
+#include <ostream>
+#include <istream>
+#include "types.h"
+#include "level.h"
+#include "logger.h"
+
+/**
+ * \file binary.h
+ * \brief Deferred-format binary logging
+ *
+ * Binary logging skips text rendering on the hot path entirely. Each call site registers its format string once and
+ * receives a static ID, after which a log call only writes that ID, a timestamp, and the raw argument bytes into a
+ * per-thread buffer. The resulting stream can be rendered to text later with decode_binary, or the log_decode tool.
+ *
+ * Format strings use `{}` as the placeholder for each argument, in order.
+ */
+
+/**
+ * Size a per-thread binary buffer may reach before it is automatically flushed to the binary output
+ */
+#define AT_BINARY_FLUSH_SIZE (64 * 1024)
+
+/**
+ * Log a message in binary mode. The first use of each call site registers the format string, later uses only write
+ * the site ID and arguments.
+ *
+ * Usage:
+ *
+ * ```
+ * AT_BINLOG(logging::INFO, "net.server", "Accepted {} connections in {}s", count, elapsed);
+ * ```
+ */
+#define AT_BINLOG(LEVEL, LOGGER, ...) logging::binary_log([](const char* __fmt) -> const logging::BinarySite& { \
+    static const logging::BinarySite __site = (logging::__ensure_levels(), \
+                                               logging::register_format(LEVEL, LOGGER, __fmt)); \
+    return __site; \
+}, __VA_ARGS__)
+
+namespace logging {
+
+/**
+ * Tags that start each entry in a binary log stream
+ */
+enum class BinaryTag : uchar {
+    FORMAT = 1, MESSAGE = 2
+};
+
+/**
+ * Type tags for arguments stored in a binary log message
+ */
+enum class BinaryArg : uchar {
+    INT = 1, UINT = 2, DOUBLE = 3, STRING = 4
+};
+
+/**
+ * A registered binary log call site. Holds the ID written to the stream, and what is needed to filter the call
+ * without a string lookup
+ */
+struct BinarySite {
+    uint id;
+    const Level* level;
+    Logger* logger;
+};
+
+/**
+ * The information registered for a binary log format ID, needed to render its messages later
+ */
+struct BinaryFormat {
+    std::string level;
+    std::string logger;
+    std::string format;
+};
+
+/**
+ * \internal
+ *
+ * Growable in-memory stream buffer, used as the per-thread staging area for binary log records
+ */
+class __BinaryBuffer : public std::streambuf {
+    
+    std::vector<char> data;
+    
+protected:
+    
+    int_type overflow(int_type ch) override;
+    
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    
+public:
+    
+    /**
+     * Construct a new buffer with the default flush size preallocated
+     */
+    __BinaryBuffer();
+    
+    /**
+     * Get the number of bytes currently held in this buffer
+     *
+     * \return Buffered byte count
+     */
+    ulong size() const;
+    
+    /**
+     * Get a pointer to the start of the buffered bytes
+     *
+     * \return Buffered data
+     */
+    const char* bytes() const;
+    
+    /**
+     * Discard all buffered bytes, keeping the allocated space
+     */
+    void reset();
+    
+};
+
+/**
+ * \internal
+ *
+ * Per-thread binary log staging buffer. Flushes whatever is left to the binary output when its thread exits
+ */
+struct __BinaryThreadBuffer {
+    
+    __BinaryBuffer buffer;
+    std::ostream stream;
+    
+    __BinaryThreadBuffer();
+    
+    ~__BinaryThreadBuffer();
+    
+};
+
+/**
+ * \internal
+ *
+ * Get the binary staging buffer of the calling thread
+ *
+ * \return Thread-local binary buffer
+ */
+__BinaryThreadBuffer& __binary_thread_buffer();
+
+/**
+ * Register a binary log format, returning the call site information for it. Normally called once per call site
+ * through AT_BINLOG, rather than directly
+ *
+ * \param level Level the site logs at
+ * \param logger Name of the logger the site logs to
+ * \param format Format string for the site, with `{}` placeholders
+ * \return New call site information
+ */
+BinarySite register_format(const Level* level, const std::string& logger, const std::string& format);
+
+/**
+ * Get every binary format registered so far, indexed by ID
+ *
+ * \return Registered formats
+ */
+std::vector<BinaryFormat> get_binary_formats();
+
+/**
+ * Set the stream that binary log records are flushed to. A stream header is written immediately. Passing nullptr
+ * disables binary logging, and records are discarded when flushed. The stream is not owned by the library.
+ *
+ * \param out New binary output stream
+ */
+void set_binary_output(std::ostream* out);
+
+/**
+ * Flush the binary records buffered by the calling thread to the binary output
+ */
+void flush_binary();
+
+/**
+ * Write a binary message record for a call site. Normally used through AT_BINLOG, rather than directly
+ *
+ * \tparam F Type of the site registration functor
+ * \tparam Args Types of the message arguments
+ * \param site Functor returning the call site information
+ * \param format Format string of the call site
+ * \param args Arguments to store for the message
+ */
+template<typename F, typename... Args>
+void binary_log(F site, const char* format, const Args&... args);
+
+/**
+ * Decode a binary log stream, rendering each message as a line of text of the form
+ * `<timestamp> <level> <logger>: <message>`
+ *
+ * \param in Binary log stream to read
+ * \param out Stream to write rendered lines to
+ * \return Number of messages decoded
+ */
+ulong decode_binary(std::istream& in, std::ostream& out);
+
+}
+
+#include "binary.tpp"
@@ -0,0 +1,71 @@
+
+#include <chrono>
+#include <type_traits>
+#include <cstring>
+#include "utils/io.h"
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * Write a single argument to a binary record, prefixed with its type tag
+ *
+ * \tparam T Type of the argument
+ * \param out Stream to write to
+ * \param arg Argument to write
+ */
+template<typename T>
+void __write_binary_arg(std::ostream& out, const T& arg) {
+    typedef typename std::decay<T>::type D;
+    if constexpr (std::is_same<D, bool>::value) {
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::UINT);
+        util::write_ulong<Endian::LITTLE>(out, arg ? 1 : 0);
+    } else if constexpr (std::is_integral<D>::value && std::is_signed<D>::value) {
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::INT);
+        util::write_long<Endian::LITTLE>(out, (slong)arg);
+    } else if constexpr (std::is_integral<D>::value) {
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::UINT);
+        util::write_ulong<Endian::LITTLE>(out, (ulong)arg);
+    } else if constexpr (std::is_floating_point<D>::value) {
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::DOUBLE);
+        util::write_double<Endian::LITTLE>(out, (double)arg);
+    } else if constexpr (std::is_same<D, std::string>::value) {
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::STRING);
+        util::write_uint<Endian::LITTLE>(out, (uint)arg.size());
+        out.write(arg.data(), arg.size());
+    } else if constexpr (std::is_same<D, const char*>::value || std::is_same<D, char*>::value) {
+        uint length = (uint)std::strlen(arg);
+        util::write_uchar<Endian::LITTLE>(out, (uchar)BinaryArg::STRING);
+        util::write_uint<Endian::LITTLE>(out, length);
+        out.write(arg, length);
+    } else {
+        static_assert(std::is_array<D>::value, "Binary log arguments must be numbers or strings");
+        __write_binary_arg(out, (const char*)arg);
+    }
+}
+
+template<typename F, typename... Args>
+void binary_log(F site, const char* format, const Args&... args) {
+    const BinarySite& info = site(format);
+    if (!info.logger->is_enabled_for(info.level)) {
+        return;
+    }
+    
+    __BinaryThreadBuffer& local = __binary_thread_buffer();
+    ulong timestamp = (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    
+    util::write_uchar<Endian::LITTLE>(local.stream, (uchar)BinaryTag::MESSAGE);
+    util::write_uint<Endian::LITTLE>(local.stream, info.id);
+    util::write_ulong<Endian::LITTLE>(local.stream, timestamp);
+    util::write_uchar<Endian::LITTLE>(local.stream, (uchar)sizeof...(args));
+    (__write_binary_arg(local.stream, args), ...);
+    
+    if (local.buffer.size() >= AT_BINARY_FLUSH_SIZE) {
+        flush_binary();
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include "types.h"
+
+/**
+ * \file clock.h
+ * \brief Cheap time and thread identity for log records
+ *
+ * Contains the clocks loggers stamp records with, and renderers for timestamps and thread ids that avoid calling
+ * into the C library for every message. Each thread caches the formatted date and time of the last second it
+ * rendered, so a timestamp in the same second only needs its sub-second digits written.
+ */
+
+namespace logging {
+
+/**
+ * Get the current wall clock time
+ *
+ * \return Nanoseconds since the Unix epoch
+ */
+ulong wall_time();
+
+/**
+ * Get the time elapsed since the logging library was loaded, from a monotonic clock
+ *
+ * \return Nanoseconds since the library was loaded
+ */
+ulong elapsed_time();
+
+/**
+ * Get an id for the calling thread. On Linux this is the kernel thread id, elsewhere a small number assigned
+ * in the order threads first ask for one. Cached per thread after the first call
+ *
+ * \return Id of the calling thread
+ */
+ulong thread_id();
+
+/**
+ * Append a timestamp as a UTC date and time, `YYYY-MM-DD HH:MM:SS`, followed by a fraction of a second with the
+ * given number of digits. The date and time are cached per thread, and only rebuilt when the second changes
+ *
+ * \param out String to append to
+ * \param timestamp Nanoseconds since the Unix epoch
+ * \param precision Digits after the decimal point, from 0 to 9
+ */
+void render_timestamp(std::string& out, ulong timestamp, uint precision);
+
+/**
+ * Append a duration as seconds, followed by a fraction of a second with the given number of digits
+ *
+ * \param out String to append to
+ * \param nanos Duration in nanoseconds
+ * \param precision Digits after the decimal point, from 0 to 9
+ */
+void render_duration(std::string& out, ulong nanos, uint precision);
+
+}
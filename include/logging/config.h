@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <istream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include "types.h"
+
+/**
+ * \file config.h
+ * \brief Loading and reloading logger configuration
+ *
+ * Contains functions to configure loggers from a simple text format, and a watcher that reapplies a configuration
+ * file whenever it changes or the process receives a signal. Each line has the form `<logger>.<setting> = <value>`,
+ * where the setting is one of `level`, `pattern` or `propagate`, and `#` starts a comment. For example:
+ *
+ *     root.level = INFO
+ *     root.pattern = %t %l %n: %m
+ *     net.socket.level = DEBUG
+ *     net.socket.propagate = false
+ *
+ * Levels are given by name, with NONE clearing a logger's own level so it inherits from its parent. As loggers
+ * publish configuration changes atomically, reloading never blocks threads that are logging.
+ */
+
+namespace logging {
+
+/**
+ * Apply logger configuration read from a stream. The whole stream is parsed before anything is applied, so a
+ * malformed configuration leaves every logger unchanged
+ *
+ * \param input Stream to read configuration from
+ * \return Number of settings applied
+ * \throws std::runtime_error If any line is malformed, naming the first such line
+ */
+ulong apply_config(std::istream& input);
+
+/**
+ * Apply logger configuration read from a file, see apply_config
+ *
+ * \param filename File to read configuration from
+ * \return Number of settings applied
+ * \throws std::runtime_error If the file can't be read or is malformed
+ */
+ulong load_config(const std::string& filename);
+
+/**
+ * Keeps loggers configured from a file, reapplying it whenever its modification time or size changes, or after a
+ * reload signal. A background thread checks the file once per interval, and reapplies a changed file once it's been
+ * left alone for a whole interval. Writers should still replace the file by renaming a new one over it where they
+ * can. Failed reloads are logged to the root logger at ERROR and leave the previous configuration in place.
+ */
+class ConfigWatcher {
+    
+    std::string filename;
+    std::chrono::milliseconds interval;
+    
+    long modified;
+    long size;
+    long seen_modified;
+    long seen_size;
+    ulong signals_seen;
+    std::atomic<ulong> reloads;
+    
+    std::mutex mutex;
+    bool stopping;
+    std::condition_variable wake;
+    std::thread watcher;
+    
+    /**
+     * Body of the background watching thread
+     */
+    void run();
+    
+    /**
+     * Check whether the file has changed since it was last loaded, updating the recorded state if so. A change only
+     * counts once the modification time and size are the same on two checks in a row, so a file being rewritten in
+     * place isn't loaded half written
+     *
+     * \return Whether the file has changed and settled
+     */
+    bool changed();
+    
+public:
+    
+    /**
+     * Construct a new ConfigWatcher, loading the file now and then watching it for changes
+     *
+     * \param filename Configuration file to watch
+     * \param interval Time between checks of the file
+     * \throws std::runtime_error If the initial load fails
+     */
+    explicit ConfigWatcher(const std::string& filename,
+                           std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    
+    /**
+     * Deconstruct a ConfigWatcher, stopping its thread
+     */
+    ~ConfigWatcher();
+    
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+    
+    /**
+     * Reload the file now, whether or not it has changed
+     *
+     * \return Whether the configuration was applied
+     */
+    bool reload();
+    
+    /**
+     * Reload the file whenever the process receives a signal, such as SIGHUP. The signal handler only sets a flag,
+     * the reload itself happens on the watching thread at its next check. Every watcher reloads on any signal
+     * registered through this method
+     *
+     * \param signum Signal to reload on
+     */
+    void reload_on_signal(int signum);
+    
+    /**
+     * Get the number of times the configuration has been successfully applied, including the initial load
+     *
+     * \return Successful loads
+     */
+    ulong get_reloads() const;
+    
+};
+
+}
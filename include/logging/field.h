@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include "types.h"
+#include "math/vector.h"
+
+/**
+ * \file field.h
+ * \brief Typed key-value fields for structured log records
+ */
+
+namespace logging {
+
+/**
+ * The type of value held by a Field
+ */
+enum class FieldType : uchar {
+    INT = 1, UINT = 2, DOUBLE = 3, BOOL = 4, STRING = 5, VECTOR = 6
+};
+
+/**
+ * \internal
+ *
+ * Unowned string value of a field
+ */
+struct __FieldString {
+    const char* data;
+    ulong length;
+};
+
+/**
+ * \internal
+ *
+ * Vector value of a field, kept as plain components so it can live in a union
+ */
+struct __FieldVector {
+    double x, y, z;
+};
+
+/**
+ * A single typed key-value pair attached to a log record. Values are stored as given, and only converted to text
+ * when a handler renders them. Keys and string values are not copied, so a field must not outlive the log call it's
+ * passed to. This is always the case when fields are written inline, as in
+ *
+ * ```
+ * logger->info("Request done", {{"id", request_id}, {"latency", seconds}, {"path", path}});
+ * ```
+ */
+struct Field {
+    
+    const char* key;
+    FieldType type;
+    
+    union {
+        slong int_value;
+        ulong uint_value;
+        double double_value;
+        bool bool_value;
+        __FieldString string_value;
+        __FieldVector vector_value;
+    };
+    
+    /**
+     * Construct a field holding any integral value. Signed types are stored as INT, unsigned types as UINT, and
+     * bool as BOOL
+     *
+     * \tparam T Integral type of the value
+     * \param key Name of the field
+     * \param value Value of the field
+     */
+    template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    Field(const char* key, T value) noexcept;
+    
+    /**
+     * Construct a field holding a floating point value
+     *
+     * \param key Name of the field
+     * \param value Value of the field
+     */
+    Field(const char* key, double value) noexcept;
+    
+    /**
+     * Construct a field holding a null-terminated string
+     *
+     * \param key Name of the field
+     * \param value Value of the field
+     */
+    Field(const char* key, const char* value) noexcept;
+    
+    /**
+     * Construct a field holding a string
+     *
+     * \param key Name of the field
+     * \param value Value of the field
+     */
+    Field(const char* key, const std::string& value) noexcept;
+    
+    /**
+     * Construct a field holding a vector
+     *
+     * \param key Name of the field
+     * \param value Value of the field
+     */
+    Field(const char* key, const math::Vector& value) noexcept;
+    
+    /**
+     * Append this field's value, rendered as text, to a string. Strings are appended without quotes or escaping
+     *
+     * \param out String to append to
+     */
+    void render_value(std::string& out) const;
+    
+};
+
+/**
+ * \internal
+ *
+ * Append the shortest text form of a double that reads back as the same value
+ *
+ * \param out String to append to
+ * \param value Value to append
+ */
+void __render_double(std::string& out, double value);
+
+}
+
+#include "field.tpp"
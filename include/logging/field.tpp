@@ -0,0 +1,21 @@
+
+#include <type_traits>
+
+namespace logging {
+
+template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type>
+Field::Field(const char* key, T value) noexcept {
+    this->key = key;
+    if constexpr (std::is_same<T, bool>::value) {
+        type = FieldType::BOOL;
+        bool_value = value;
+    } else if constexpr (std::is_signed<T>::value) {
+        type = FieldType::INT;
+        int_value = value;
+    } else {
+        type = FieldType::UINT;
+        uint_value = value;
+    }
+}
+
+}
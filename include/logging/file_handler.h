@@ -0,0 +1,198 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include "types.h"
+#include "level.h"
+#include "handler.h"
+#include "log_index.h"
+
+/**
+ * \file file_handler.h
+ * \brief High-throughput file output for loggers
+ *
+ * Contains a file handler built for heavy log volume. It collects records in a large user-space buffer, writes it
+ * out with vectored writes, rotates files by size or age, and bounds how often data is synced to disk. It can also
+ * keep a sparse sidecar index of its output, see log_index.h.
+ */
+
+/**
+ * Default size of each chunk in a BufferedFileHandler write buffer
+ */
+#define AT_FILE_CHUNK_SIZE (64 * 1024)
+
+/**
+ * Default number of chunks in a BufferedFileHandler write buffer
+ */
+#define AT_FILE_CHUNK_COUNT 16
+
+namespace logging {
+
+/**
+ * When a BufferedFileHandler asks the OS to sync written data to disk
+ */
+enum class SyncPolicy {
+    NEVER, INTERVAL, BYTES
+};
+
+/**
+ * Write statistics for a BufferedFileHandler, counted over the life of the handler
+ */
+struct FileStats {
+    ulong records = 0;
+    ulong bytes = 0;
+    ulong writes = 0;
+    ulong syncs = 0;
+    ulong rotations = 0;
+};
+
+/**
+ * A handler that outputs log messages to a file through a large user-space buffer. Buffered records are written
+ * with a single vectored write once the buffer fills, on flush, or on destruction. The file can be rotated once it
+ * grows past a size or age, keeping a number of numbered backups, and data can be synced to disk never, every
+ * so many milliseconds, or every so many bytes. The public methods take the handler lock, so they can be called while
+ * other threads are logging.
+ */
+class BufferedFileHandler : public Handler {
+    
+    std::string filename;
+    int fd;
+    
+    std::vector<std::vector<char>> chunks;
+    std::vector<ulong> chunk_used;
+    ulong current_chunk;
+    
+    ulong file_size;
+    std::chrono::steady_clock::time_point opened;
+    ulong max_bytes;
+    std::chrono::milliseconds max_age;
+    uint backups;
+    
+    SyncPolicy sync_policy;
+    ulong sync_amount;
+    ulong unsynced_bytes;
+    std::chrono::steady_clock::time_point last_sync;
+    
+    FileStats stats;
+    __IndexWriter* index;
+    ulong index_interval;
+    
+    /**
+     * Open the log file, and its index if enabled for appending, and record its current size
+     */
+    void open_file();
+    
+    /**
+     * Write all buffered chunks, and optionally one extra oversized message, with as few syscalls as possible
+     *
+     * \param extra Message too large for a chunk, or nullptr
+     * \param extra_length Length of the extra message
+     */
+    void write_out(const char* extra, ulong extra_length);
+    
+    /**
+     * Write all buffered records to the file, without taking the handler lock
+     */
+    void do_flush();
+    
+    /**
+     * Flush and sync the file to disk, without taking the handler lock
+     */
+    void do_sync();
+    
+    /**
+     * Flush and rotate the log file, without taking the handler lock
+     */
+    void do_rotate();
+    
+    /**
+     * Get the size the log file will have once the buffer is written
+     *
+     * \return Bytes written plus bytes buffered
+     */
+    ulong logical_size() const;
+    
+    /**
+     * Check whether the rotation or sync policy needs to act, given the next record's size
+     *
+     * \param length Size of the next record
+     */
+    void check_policies(ulong length);
+    
+public:
+    
+    /**
+     * Construct a new BufferedFileHandler that appends to a given file, with a buffer of chunk_count chunks
+     * of chunk_size bytes
+     *
+     * \param filename File to log to
+     * \param chunk_size Size of each buffer chunk
+     * \param chunk_count Number of buffer chunks
+     */
+    explicit BufferedFileHandler(const std::string& filename, ulong chunk_size = AT_FILE_CHUNK_SIZE,
+                                 ulong chunk_count = AT_FILE_CHUNK_COUNT);
+    
+    /**
+     * Deconstruct a BufferedFileHandler, flushing any buffered records and releasing the file
+     */
+    ~BufferedFileHandler();
+    
+    /**
+     * Set when the log file is rotated. When rotated, the file is renamed to `<filename>.1`, existing backups are
+     * shifted up by one, and any beyond the backup count are removed. A zero size or age disables that trigger.
+     *
+     * \param max_bytes Size the file may reach before being rotated
+     * \param max_age Time a file may be written to before being rotated
+     * \param backups Number of old files to keep
+     */
+    void set_rotation(ulong max_bytes, std::chrono::milliseconds max_age = std::chrono::milliseconds(0),
+                      uint backups = 5);
+    
+    /**
+     * Set how often written data is synced to disk. For INTERVAL, amount is in milliseconds. For BYTES, amount is
+     * the number of bytes written between syncs.
+     *
+     * \param policy New sync policy
+     * \param amount Interval or byte count for the policy
+     */
+    void set_sync_policy(SyncPolicy policy, ulong amount = 0);
+    
+    /**
+     * Start writing a sidecar index of this log to `<filename>.idx`, with an entry for each block of roughly
+     * interval bytes. Only records delivered through handle are described by the index, though every byte of the
+     * log is covered by some block. Rotated logs keep their index, as `<filename>.<n>.idx`
+     *
+     * \param interval Bytes of log covered by each index entry
+     */
+    void set_index(ulong interval = AT_INDEX_INTERVAL);
+    
+    /**
+     * Write all buffered records to the file
+     */
+    void flush();
+    
+    /**
+     * Write all buffered records to the file, and sync the file to disk
+     */
+    void sync();
+    
+    /**
+     * Flush and rotate the log file now, regardless of the rotation policy
+     */
+    void rotate();
+    
+    /**
+     * Get the write statistics for this handler
+     *
+     * \return Current statistics
+     */
+    FileStats get_stats();
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+#include "handler.h"
+
+/**
+ * \file flight_recorder.h
+ * \brief Keeping recent log context in memory
+ *
+ * Contains a handler that records the most recent records of every level into a preallocated ring, and only writes
+ * them out when something goes wrong. This keeps verbose context around for crashes without paying for verbose
+ * output the rest of the time.
+ */
+
+/**
+ * Default number of records a FlightRecorder keeps
+ */
+#define AT_FLIGHT_RECORDS 4096
+
+/**
+ * Default number of message bytes a FlightRecorder keeps per record. Longer messages are truncated
+ */
+#define AT_FLIGHT_SLOT_SIZE 256
+
+/**
+ * Number of logger name bytes a FlightRecorder keeps per record. Longer names are truncated
+ */
+#define AT_FLIGHT_NAME_SIZE 128
+
+/**
+ * Maximum number of FlightRecorders that can dump on signals at once
+ */
+#define AT_FLIGHT_SIGNAL_RECORDERS 8
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * A single record in the flight recorder ring. The sequence is odd while the slot is being written, and
+ * `2 * (ticket + 1)` once the record with that ticket is complete, so readers can detect torn slots
+ */
+struct __FlightSlot {
+    std::atomic<ulong> sequence {0};
+    const Level* level = nullptr;
+    ulong timestamp = 0;
+    uint name_length = 0;
+    uint length = 0;
+    bool truncated = false;
+    char* name = nullptr;
+    char* text = nullptr;
+};
+
+/**
+ * A handler that keeps the last N records at every level in a fixed ring, and writes them to a file descriptor
+ * only when a record at or above its trigger level arrives, when a registered signal is raised, or when dump is
+ * called. Records are stored unformatted, as the raw message, level, logger name and time, so recording one is a
+ * few atomic operations and a copy of the message and name. No locks are taken and nothing is allocated after
+ * construction.
+ *
+ * The recorder only sees records its loggers let through, so loggers it's attached to should be set to the lowest
+ * level worth keeping, with other handlers given their own levels.
+ */
+class FlightRecorder : public Handler {
+    
+    __FlightSlot* slots;
+    char* storage;
+    char* scratch;
+    ulong capacity;
+    ulong slot_size;
+    std::atomic<ulong> next {0};
+    std::atomic<bool> dumping {false};
+    std::atomic<const Level*> trigger;
+    std::atomic<int> output;
+    
+    /**
+     * Store a message in the next slot of the ring
+     *
+     * \param message Message to store
+     * \param level Level of the message
+     * \param name Logger name, or null. Copied into the slot, up to AT_FLIGHT_NAME_SIZE bytes
+     * \param timestamp Time of the message
+     */
+    void store(const std::string& message, const Level* level, const std::string* name, ulong timestamp);
+    
+public:
+    
+    /**
+     * Construct a new FlightRecorder keeping the last capacity records, each with up to slot_size bytes of message.
+     * Dumps go to stderr until set_output is called
+     *
+     * \param capacity Number of records to keep
+     * \param slot_size Bytes of message kept per record
+     */
+    explicit FlightRecorder(ulong capacity = AT_FLIGHT_RECORDS, ulong slot_size = AT_FLIGHT_SLOT_SIZE);
+    
+    /**
+     * Deconstruct a FlightRecorder, unregistering it from signal dumps and releasing its ring
+     */
+    ~FlightRecorder() override;
+    
+    /**
+     * Set the level that triggers a dump when a record at or above it is handled. Defaults to FATAL
+     *
+     * \param level New trigger level, or nullptr to never dump automatically
+     */
+    void set_trigger(const Level* level);
+    
+    /**
+     * Set the file descriptor dumps are written to. The descriptor is not owned by the recorder
+     *
+     * \param fd File descriptor to dump to
+     */
+    void set_output(int fd);
+    
+    /**
+     * Dump this recorder to its output whenever the given signal is raised. If the signal is a crash signal, such as
+     * SIGSEGV or SIGABRT, the default action is run after all recorders have dumped
+     *
+     * \param signum Signal to dump on
+     */
+    void dump_on_signal(int signum);
+    
+    /**
+     * Write the recorded records, oldest first, to the output, one line per record. Safe to call from a signal
+     * handler. Returns without writing if another dump of this recorder is in progress
+     *
+     * \return Number of records written
+     */
+    ulong dump();
+    
+    /**
+     * Write the recorded records, oldest first, to a file descriptor, one line per record. Safe to call from a
+     * signal handler. Returns without writing if another dump of this recorder is in progress
+     *
+     * \param fd File descriptor to write to
+     * \return Number of records written
+     */
+    ulong dump(int fd);
+    
+    /**
+     * Get the total number of records this recorder has been given, including ones since overwritten
+     *
+     * \return Number of records recorded
+     */
+    ulong get_recorded() const;
+    
+    bool needs_text() const override;
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <string>
+#include <mutex>
+#include <atomic>
 #include "level.h"
+#include "record.h"
 
 /**
  * \file handler.h
@@ -10,6 +13,9 @@
  * Contains the abstract class and several default implementations of the Handler protocol for loggers.
  * A logger can have multiple handlers, each responsible for one form of output and each can have its own minimum
  * logging level it outputs at.
+ *
+ * Handlers may be shared between loggers used on many threads. Loggers deliver records through Handler::handle,
+ * which holds the handler's own lock for the whole record, so output from different threads never interleaves.
  */
 
 /**
@@ -26,7 +32,8 @@ namespace logging {
 class Handler {
 protected:
     
-    Level* level;
+    std::atomic<Level*> level;
+    std::mutex mutex;
 
 public:
     
@@ -35,6 +42,11 @@ public:
      */
     Handler();
     
+    /**
+     * Virtual destructor, so handlers can be deleted through a base pointer
+     */
+    virtual ~Handler() = default;
+    
     /**
      * Set the current logging level of this handler. Logs below this level won't be output
      *
@@ -43,7 +55,34 @@ public:
     void set_level(Level* level);
     
     /**
-     * Actually log a message to output
+     * Decide whether a record would be handled, before its message is formatted. Loggers only format a message if
+     * at least one of their handlers accepts it. The default accepts records at or above this handler's level.
+     * Called without the handler's lock held.
+     *
+     * \param record Record to check, without text
+     * \return Whether the record should be passed to handle
+     */
+    virtual bool accepts(const Record& record);
+    
+    /**
+     * Whether this handler uses the formatted text of records. Loggers skip formatting for records that only go to
+     * handlers that don't, such as those rendering records as JSON. The default returns true.
+     *
+     * \return Whether handle needs record text
+     */
+    virtual bool needs_text() const;
+    
+    /**
+     * Handle a whole record from a logger. The default implementation holds this handler's lock while passing the
+     * formatted text to log, so subclasses only need to override log to be thread-safe.
+     *
+     * \param record Record to handle
+     */
+    virtual void handle(const Record& record);
+    
+    /**
+     * Actually log a message to output. Not synchronized, callers other than handle must hold the handler's lock
+     * if the handler is shared between threads
      *
      * \param message Message to log. May contain newlines or other unusual characters
      * \param level Level being logged at
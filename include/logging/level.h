@@ -111,14 +111,21 @@ public:
      *
      * \return Level name
      */
-    std::string get_name();
+    std::string get_name() const;
+    
+    /**
+     * Get the name of this level without copying it, for use where allocating isn't allowed
+     *
+     * \return Level name, valid for the life of the level
+     */
+    const char* get_c_name() const noexcept;
     
     /**
      * Get the priority of this level, as an int
      *
      * \return level priority
      */
-    int get_priority();
+    int get_priority() const;
     
 };
 
@@ -130,6 +137,14 @@ extern Level* WARN;
 extern Level* ERROR;
 extern Level* FATAL;
 
+/**
+ * Find one of the default levels by name, as would be written in configuration or output by a handler
+ *
+ * \param name Name of the level, in upper case
+ * \return Matching level, or nullptr if no default level has that name
+ */
+Level* find_level(const std::string& name);
+
 /**
  * \internal
  *
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+
+/**
+ * \file log_index.h
+ * \brief Sparse indexes for seeking in large log files
+ *
+ * Contains the sidecar index a BufferedFileHandler can write next to its log file, and a reader that maps a log
+ * into memory and uses its index to find the regions that could hold records of interest. The log is split into
+ * contiguous blocks of roughly equal size, and each block gets one fixed-size index entry giving its byte range, the
+ * range of record timestamps in it, which levels appear in it, and a small bloom filter of the loggers that wrote to
+ * it. Queries by time, level and logger then only need to read matching blocks, and the tail of the log not yet
+ * covered by an entry.
+ *
+ * The index lives in `<log file>.idx`, starting with an 8 byte magic string followed by 48 byte little-endian
+ * entries: u64 offset, u64 length, u64 first time, u64 last time, u64 logger bloom, u8 level mask and 7 bytes of
+ * padding. Times are nanoseconds since the Unix epoch, and level mask bits are indexed by metric_index.
+ */
+
+/**
+ * Default number of log bytes covered by each index entry
+ */
+#define AT_INDEX_INTERVAL (256 * 1024)
+
+namespace logging {
+
+/**
+ * One block of a log file, as described by its index entry
+ */
+struct IndexEntry {
+    ulong offset = 0;
+    ulong length = 0;
+    ulong first_time = ~(ulong)0;
+    ulong last_time = 0;
+    ulong loggers = 0;
+    uchar levels = 0;
+};
+
+/**
+ * What to look for in an indexed log. Every condition must hold for a block to match
+ */
+struct IndexQuery {
+    
+    /**
+     * Earliest record time of interest, in nanoseconds since the Unix epoch
+     */
+    ulong start_time = 0;
+    
+    /**
+     * Latest record time of interest, in nanoseconds since the Unix epoch
+     */
+    ulong end_time = ~(ulong)0;
+    
+    /**
+     * Lowest level of interest, or nullptr for every level
+     */
+    const Level* min_level = nullptr;
+    
+    /**
+     * Name of the logger of interest, or empty for every logger
+     */
+    std::string logger;
+    
+};
+
+/**
+ * A range of bytes in a mapped log file that may hold matching records. Always starts at the start of a record
+ */
+struct LogRegion {
+    ulong offset;
+    const char* data;
+    ulong length;
+};
+
+/**
+ * \internal
+ *
+ * Builds the sidecar index of a log file as records are written to it. Not synchronized, owned by a single handler
+ */
+class __IndexWriter {
+    
+    std::string filename;
+    int fd;
+    ulong interval;
+    
+    IndexEntry block;
+    bool block_open;
+    std::string pending;
+    
+public:
+    
+    /**
+     * Open the index of a log file for appending, creating it if needed
+     *
+     * \param filename Name of the index file
+     * \param interval Bytes of log to cover with each entry
+     * \param start Current size of the log file, where the first block starts
+     */
+    __IndexWriter(const std::string& filename, ulong interval, ulong start);
+    
+    /**
+     * Close the index file. Any open block or pending entries are lost, so close_block and write_pending should be
+     * called first
+     */
+    ~__IndexWriter();
+    
+    /**
+     * Note a record written to the log
+     *
+     * \param record Record that was written
+     * \param offset Offset in the log the record starts at
+     * \param length Bytes the record takes up in the log
+     */
+    void add(const Record& record, ulong offset, ulong length);
+    
+    /**
+     * End the open block, if there is one, so its entry is written with the next write_pending
+     *
+     * \param end Offset in the log the block ends at
+     */
+    void close_block(ulong end);
+    
+    /**
+     * Append every finished entry to the index file. Must only be called once the log bytes they cover are written
+     */
+    void write_pending();
+    
+};
+
+/**
+ * A read-only view of a log file and its sidecar index. The log is mapped into memory, so reading matching regions
+ * only touches the pages they cover
+ */
+class LogIndex {
+    
+    std::string filename;
+    const char* data;
+    ulong size;
+    std::string contents;
+    std::vector<IndexEntry> entries;
+    
+public:
+    
+    /**
+     * Map a log file and load its index. A missing index is treated as an empty one, so the whole log is one
+     * unindexed region
+     *
+     * \param filename Log file to open
+     * \throws std::runtime_error If the log can't be opened or the index is malformed
+     */
+    explicit LogIndex(const std::string& filename);
+    
+    /**
+     * Unmap the log file
+     */
+    ~LogIndex();
+    
+    LogIndex(const LogIndex&) = delete;
+    LogIndex& operator=(const LogIndex&) = delete;
+    
+    /**
+     * Get the entries of the index, in log order
+     *
+     * \return Index entries
+     */
+    const std::vector<IndexEntry>& get_entries() const;
+    
+    /**
+     * Get the size of the mapped log
+     *
+     * \return Log size in bytes
+     */
+    ulong get_size() const;
+    
+    /**
+     * Find the regions of the log that may hold records matching a query. Adjacent matching blocks are merged. Parts
+     * of the log no entry covers, such as the tail after the last finished block, always match, as nothing is known
+     * about them
+     *
+     * \param query What to look for
+     * \return Regions to scan, in log order
+     */
+    std::vector<LogRegion> find(const IndexQuery& query) const;
+    
+};
+
+}
@@ -2,8 +2,14 @@
 
 #include <string>
 #include <vector>
+#include <initializer_list>
+#include <atomic>
+#include <mutex>
 #include "level.h"
+#include "field.h"
+#include "record.h"
 #include "handler.h"
+#include "metrics.h"
 
 /**
  * \file logger.h
@@ -11,6 +17,11 @@
  *
  * The base logger class. Can be subclassed for custom loggers, and is automatically constructed
  * by the logger factory functions. Attempts to be relatively generic, as much as is practical.
+ *
+ * Loggers are safe to use from many threads at once. Each thread formats messages into its own staging buffer, and
+ * handlers receive each record whole. A logger's pattern and handlers live in an immutable snapshot, which logging
+ * reads without taking any lock. Configuration changes copy the snapshot, publish the copy atomically, and free the
+ * old one once no thread can still be reading it (see utils/rcu.h).
  */
 
 /**
@@ -18,8 +29,60 @@
  */
 #define AT_DEFAULT_LOGGER_LEVEL (logging::INFO)
 
+/**
+ * Log a message to a logger at a level, recording the source location of the call
+ */
+#define AT_LOG(LOGGER, LEVEL, MESSAGE) (LOGGER)->log(MESSAGE, LEVEL, AT_SOURCE_LOCATION)
+
+/**
+ * Log a message with structured fields to a logger at a level, recording the source location of the call. Fields
+ * are given as `{"key", value}` pairs after the message
+ */
+#define AT_LOG_FIELDS(LOGGER, LEVEL, MESSAGE, ...) (LOGGER)->log(MESSAGE, LEVEL, {__VA_ARGS__}, AT_SOURCE_LOCATION)
+
+/**
+ * Log a message to a logger with the TRACE level, recording the source location of the call
+ */
+#define AT_TRACE(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::TRACE, MESSAGE)
+
+/**
+ * Log a message to a logger with the DEBUG level, recording the source location of the call
+ */
+#define AT_DEBUG(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::DEBUG, MESSAGE)
+
+/**
+ * Log a message to a logger with the INFO level, recording the source location of the call
+ */
+#define AT_INFO(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::INFO, MESSAGE)
+
+/**
+ * Log a message to a logger with the WARN level, recording the source location of the call
+ */
+#define AT_WARN(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::WARN, MESSAGE)
+
+/**
+ * Log a message to a logger with the ERROR level, recording the source location of the call
+ */
+#define AT_ERROR(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::ERROR, MESSAGE)
+
+/**
+ * Log a message to a logger with the FATAL level, recording the source location of the call
+ */
+#define AT_FATAL(LOGGER, MESSAGE) AT_LOG(LOGGER, logging::FATAL, MESSAGE)
+
 namespace logging {
 
+/**
+ * \internal
+ *
+ * The part of a logger's configuration that can't be swapped with a single atomic store. Never changed once
+ * published, each change publishes a new snapshot instead
+ */
+struct __LoggerConfig {
+    std::string pattern;
+    std::vector<Handler*> handlers;
+};
+
 /**
  * Built-in logger type, provides all the library functionality. May in the future be altered into a base type
  */
@@ -27,13 +90,21 @@ class Logger {
 
 protected:
     
-    bool propagate = true;
-    Logger* parent = nullptr;
+    std::atomic<bool> propagate {true};
+    std::atomic<Logger*> parent {nullptr};
     std::string name;
-    std::string pattern = "";
-    Level* level;
-    Level* stream_level;
-    std::vector<Handler*> handlers;
+    std::atomic<Level*> level;
+    std::atomic<Level*> stream_level;
+    std::atomic<const __LoggerConfig*> config;
+    std::mutex config_mutex;
+    __MetricCounters metrics;
+    
+    /**
+     * Publish a new configuration snapshot, retiring the current one. Must be called with the config mutex held
+     *
+     * \param next New snapshot, owned by this logger from now on
+     */
+    void publish(const __LoggerConfig* next);
     
     /**
      * Get the level of this logger, considering parents if this logger has no level
@@ -50,28 +121,36 @@ protected:
     std::string get_effective_pattern() const;
     
     /**
-     * Return the result of a format code for logging with a given instruction and context
+     * Append the result of a format code for logging with a given instruction and record
      *
+     * \param out String to append the result to
      * \param instruct Instruction to use
-     * \param message Message to log
-     * \param level Level logged at
-     * \return Instruction result
+     * \param record Record being logged
+     */
+    void format_instruct(std::string& out, const std::string& instruct, const Record& record);
+    
+    /**
+     * Format a record for logging, using the effective pattern of this logger. If the pattern has no %k, any fields
+     * are appended after the formatted text. Must be called inside an RCU read guard.
+     *
+     * \param out String to write the formatted message to
+     * \param record Record to format
      */
-    std::string format_instruct(const std::string& instruct, std::string message, const Level* level);
+    void log_format(std::string& out, const Record& record);
     
     /**
-     * Format a message for logging at a given level
+     * Pass a record to the parent of this logger if propagating, then to each handler of this logger that
+     * accepts it, formatting its text the first time a handler needs it. Stamps the record with the current time
+     * the first time it reaches a logger with handlers
      *
-     * \param message Message to format
-     * \param level Level logged at
-     * \return Formatted message result
+     * \param record Record to deliver
      */
-    std::string log_format(const std::string& message, const Level* level);
+    void dispatch(Record& record);
     
     /**
      * As loggers are managed through the library, outside systems can't delete them
      */
-    ~Logger() = default;
+    ~Logger();
 
 public:
     
@@ -127,9 +206,23 @@ public:
      */
     Level* get_level() const;
     
+    /**
+     * Check whether a message at the given level would be handled by this logger, considering parents if this
+     * logger has no level of its own
+     *
+     * \param level Level to check
+     * \return Whether the level is enabled
+     */
+    bool is_enabled_for(const Level* level) const;
+    
     /**
      * Set the pattern for this logger. This pattern will be used to format the output of logging operations.
-     * Valid specifiers include %l for level, %m for message, and %n for name
+     * Valid specifiers include %l for level, %m for message, %n for name, and %k for structured fields. %t is the
+     * UTC time the record was logged, %e the time since the library was loaded, %T the id of the logging thread,
+     * %s the source file and line, and %F the source function. %t and %e may be followed by a digit giving how many
+     * sub-second digits to show, which defaults to 3 for %t and 6 for %e. %S is the stack trace captured for the
+     * record, one indented frame per line, and is appended after the text if a record has a stack and the pattern
+     * has no %S (see set_stack_level)
      *
      * \param pattern New pattern to use
      */
@@ -180,6 +273,28 @@ public:
      */
     void log(const std::string& message, const Level* level);
     
+    /**
+     * Log a message at a given level, from a known place in the source. Usually called through the AT_LOG family
+     * of macros
+     *
+     * \param message Message to log
+     * \param level Level to log at
+     * \param location Where the message was logged from
+     */
+    void log(const std::string& message, const Level* level, const SourceLocation& location);
+    
+    /**
+     * Log a message with structured fields at a given level, optionally from a known place in the source. Field
+     * values are passed to handlers as they are, and only rendered by handlers that output them
+     *
+     * \param message Message to log
+     * \param level Level to log at
+     * \param fields Fields to attach to the record
+     * \param location Where the message was logged from
+     */
+    void log(const std::string& message, const Level* level, std::initializer_list<Field> fields,
+             const SourceLocation& location = SourceLocation());
+    
     /**
      * Log a message with the TRACE level
      *
@@ -187,6 +302,14 @@ public:
      */
     void trace(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the TRACE level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void trace(const std::string& message, std::initializer_list<Field> fields);
+    
     /**
      * Log a message with the DEBUG level
      *
@@ -194,6 +317,14 @@ public:
      */
     void debug(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the DEBUG level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void debug(const std::string& message, std::initializer_list<Field> fields);
+    
     /**
      * Log a message with the INFO level
      *
@@ -201,6 +332,14 @@ public:
      */
     void info(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the INFO level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void info(const std::string& message, std::initializer_list<Field> fields);
+    
     /**
      * Log a message with the WARN level
      *
@@ -208,6 +347,14 @@ public:
      */
     void warn(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the WARN level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void warn(const std::string& message, std::initializer_list<Field> fields);
+    
     /**
      * Log a message with the ERROR level
      *
@@ -215,6 +362,14 @@ public:
      */
     void error(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the ERROR level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void error(const std::string& message, std::initializer_list<Field> fields);
+    
     /**
      * Log a message with the FATAL level
      *
@@ -222,6 +377,22 @@ public:
      */
     void fatal(const std::string& message);
     
+    /**
+     * Log a message with structured fields with the FATAL level
+     *
+     * \param message Message to log
+     * \param fields Fields to attach to the record
+     */
+    void fatal(const std::string& message, std::initializer_list<Field> fields);
+    
+    /**
+     * Get a snapshot of the counters of this logger. Records are counted as emitted or filtered by the logger they
+     * were logged to, while handler bytes and time are counted by the logger owning the handler
+     *
+     * \return Current counts
+     */
+    LoggerMetrics get_metrics() const;
+    
     /**
      * Add a new handler. Handlers are the devices which are actually logged to, representing the console, a file, or
      * any other location for logs to be sent to
@@ -231,7 +402,8 @@ public:
     void add_handler(Handler* handler);
     
     /**
-     * Remove a previously registered handler from this logger
+     * Remove a previously registered handler from this logger. Once this returns no thread is still using the handler
+     * through this logger, so it may be deleted if no other logger holds it
      *
      * \param handler Handler to remove
      * \return Whether the handler was successfully moved
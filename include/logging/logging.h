@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "level.h"
 #include "logger.h"
 
@@ -10,7 +11,32 @@
  *
  * Provides functions to get/set logger defaults, as well as access into the global
  * logger cache. All loggers are stored there, so they can be statically retrieved from anywhere.
+ *
+ * The cache can be read from any thread without locking. Only the first retrieval of a logger, which creates it,
+ * takes a lock.
+ */
+
+/**
+ * Number of buckets in the logger cache. The cache never resizes, so many more loggers than this will lengthen
+ * lookups, though not break them
+ */
+#define AT_LOGGER_BUCKETS 1024
+
+/**
+ * Get a logger by name, caching the result at the call site. After the first call, this never does a string
+ * lookup, which makes it suited to hot code. NAME is only evaluated once per call site, and can't refer to local
+ * variables.
+ *
+ * Usage:
+ *
+ * ```
+ * AT_LOGGER("net.server")->info("Started");
+ * ```
  */
+#define AT_LOGGER(NAME) ([]() -> logging::Logger* { \
+    static logging::Logger* const __logger = logging::get_logger(NAME); \
+    return __logger; \
+}())
 
 namespace logging {
 
@@ -51,11 +77,18 @@ Logger* get_root_logger();
 
 /**
  * Get a logger by name, with automatic namespace resolution. If a logger by that name was retrieved before, it will
- * return that logger. Otherwise, a new logger will be created and added to the cache
+ * return that logger. Otherwise, a new logger will be created and added to the cache. Safe to call from any thread,
+ * concurrent first calls for the same name return the same logger
  * \param name Name of the logger to get or create
  * \param auto_parent Whether to automatically resolve the logger namespace
  * \return Logger with the given name
  */
 Logger* get_logger(const std::string& name, bool auto_parent = true);
 
+/**
+ * Get a snapshot of the counters of every logger in the cache, without taking any locks
+ * \return Counters of each logger, in no particular order
+ */
+std::vector<LoggerMetrics> snapshot_metrics();
+
 }
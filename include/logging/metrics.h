@@ -0,0 +1,229 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+#include "handler.h"
+
+/**
+ * \file metrics.h
+ * \brief Counting what loggers do
+ *
+ * Contains the counters every logger keeps of records logged, filtered and handled, and a handler that periodically
+ * reports them. Counters are split into shards, each on its own cache lines, and each thread only adds to one shard
+ * with relaxed atomics, so counting costs a few nanoseconds and threads logging to the same logger don't contend.
+ * Shards are only summed when a snapshot is taken.
+ */
+
+/**
+ * Number of level buckets counted separately, one for each default level from TRACE to FATAL
+ */
+#define AT_METRIC_LEVELS 6
+
+/**
+ * Number of shards each logger's counters are split into
+ */
+#define AT_METRIC_SHARDS 8
+
+namespace logging {
+
+/**
+ * Counts for one level bucket of one logger
+ */
+struct LevelMetrics {
+    
+    /**
+     * Records logged to the logger at or above its effective level
+     */
+    ulong emitted = 0;
+    
+    /**
+     * Records logged to the logger below its effective level, and so dropped
+     */
+    ulong filtered = 0;
+    
+    /**
+     * Bytes of formatted text passed to the logger's handlers
+     */
+    ulong bytes = 0;
+    
+    /**
+     * Nanoseconds spent formatting records for the logger's handlers and passing records to them. Only counted while
+     * handler timing is on, see set_handler_timing
+     */
+    ulong handler_ns = 0;
+    
+    /**
+     * Add another set of counts to this one
+     *
+     * \param other Counts to add
+     * \return Reference to this
+     */
+    LevelMetrics& operator+=(const LevelMetrics& other);
+    
+};
+
+/**
+ * A snapshot of the counters of one logger. Emitted and filtered records are counted by the logger they were
+ * logged to, bytes and handler time by the logger whose handlers received them.
+ */
+struct LoggerMetrics {
+    
+    std::string name;
+    LevelMetrics levels[AT_METRIC_LEVELS];
+    
+    /**
+     * Get the counts summed over every level
+     *
+     * \return Total counts
+     */
+    LevelMetrics total() const;
+    
+};
+
+/**
+ * Get the bucket a level is counted in. Default levels each have their own bucket, custom levels are counted with
+ * the highest default level at or below their priority
+ *
+ * \param level Level to find the bucket of
+ * \return Index into LoggerMetrics::levels
+ */
+ulong metric_index(const Level* level);
+
+/**
+ * Get the name of a level bucket
+ *
+ * \param index Index into LoggerMetrics::levels
+ * \return Name of the default level counted in that bucket
+ */
+const char* metric_level_name(ulong index);
+
+/**
+ * Turn timing of handlers on or off for every logger. Timing costs two clock reads per record a logger hands to its
+ * handlers, so it's off by default, and only on while it's enabled here or while any MetricsHandler exists
+ *
+ * \param enabled Whether to time handlers even with no MetricsHandler
+ */
+void set_handler_timing(bool enabled);
+
+/**
+ * Check whether loggers are timing their handlers
+ *
+ * \return Whether timing was enabled with set_handler_timing, or a MetricsHandler exists
+ */
+bool get_handler_timing();
+
+/**
+ * \internal
+ *
+ * One shard of a logger's counters, padded so no two shards share a cache line
+ */
+struct alignas(64) __MetricShard {
+    std::atomic<ulong> emitted[AT_METRIC_LEVELS];
+    std::atomic<ulong> filtered[AT_METRIC_LEVELS];
+    std::atomic<ulong> bytes[AT_METRIC_LEVELS];
+    std::atomic<ulong> handler_ns[AT_METRIC_LEVELS];
+};
+
+/**
+ * \internal
+ *
+ * The counters of one logger. Each thread always adds to the same shard
+ */
+class __MetricCounters {
+    
+    __MetricShard shards[AT_METRIC_SHARDS];
+    
+public:
+    
+    /**
+     * Start with every counter at zero
+     */
+    __MetricCounters();
+    
+    /**
+     * Count a record that passed the logger's level
+     *
+     * \param level Level of the record
+     */
+    void count_emitted(const Level* level);
+    
+    /**
+     * Count a record dropped by the logger's level
+     *
+     * \param level Level of the record
+     */
+    void count_filtered(const Level* level);
+    
+    /**
+     * Count a record passed to the logger's handlers
+     *
+     * \param level Level of the record
+     * \param bytes Length of the formatted text given to the handlers, summed over each handler
+     * \param nanos Time the handlers took, or 0 if they weren't timed
+     */
+    void count_handled(const Level* level, ulong bytes, ulong nanos);
+    
+    /**
+     * Sum every shard into a snapshot
+     *
+     * \param out Snapshot to fill the level counts of
+     */
+    void snapshot(LoggerMetrics& out) const;
+    
+};
+
+/**
+ * A handler that passes records through to another handler, and periodically sends it a report of every logger's
+ * counters. Each report has one record per logger that did anything since the last report, logged at INFO by
+ * "metrics", with fields giving the change in each count since then. Reports are sent from handle, once at least
+ * the report interval has passed, or whenever report is called. Handler timing is on for as long as any
+ * MetricsHandler exists, so reports include the time spent in handlers.
+ */
+class MetricsHandler : public Handler {
+    
+    Handler* inner;
+    std::atomic<ulong> interval;
+    std::atomic<ulong> last_report;
+    
+    std::mutex report_mutex;
+    std::unordered_map<std::string, LevelMetrics> previous;
+    
+public:
+    
+    /**
+     * Construct a new MetricsHandler in front of a handler
+     *
+     * \param inner Handler to pass records and reports to. Not owned by this handler
+     * \param interval Minimum time between automatic reports
+     */
+    MetricsHandler(Handler* inner, std::chrono::milliseconds interval);
+    
+    /**
+     * Deconstruct a MetricsHandler, turning handler timing back off if nothing else needs it
+     */
+    ~MetricsHandler() override;
+    
+    /**
+     * Send a report of every logger that changed since the last report to the wrapped handler now
+     *
+     * \return Number of loggers reported
+     */
+    ulong report();
+    
+    bool accepts(const Record& record) override;
+    
+    bool needs_text() const override;
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
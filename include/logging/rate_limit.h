@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+#include "handler.h"
+
+/**
+ * \file rate_limit.h
+ * \brief Bounding log volume under load
+ *
+ * Contains a handler that sits in front of another handler and drops records before they are formatted, either by
+ * rate limiting each call site or by sampling each level. Dropped records are counted, and reported periodically as
+ * summary lines so nothing disappears silently.
+ */
+
+/**
+ * Number of call sites a RateLimitHandler tracks separately. Sites beyond this share budgets
+ */
+#define AT_RATE_LIMIT_SITES 1024
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * Rate limiting state for a single call site. Uses the generic cell rate algorithm, so the whole token bucket is a
+ * single atomic timestamp
+ */
+struct __RateSite {
+    std::atomic<ulong> key {0};
+    std::atomic<ulong> arrival {0};
+    std::atomic<ulong> suppressed {0};
+    std::atomic<const char*> file {nullptr};
+    std::atomic<uint> line {0};
+};
+
+/**
+ * \internal
+ *
+ * Sampling state for a single level
+ */
+struct __SampleRate {
+    const Level* level;
+    ulong threshold;
+    std::atomic<ulong> dropped {0};
+};
+
+/**
+ * A handler that limits how many records reach another handler. Each call site gets a token bucket allowing a
+ * sustained rate with some burst, and each level can be sampled with a fixed probability. Decisions are made in
+ * accepts, before the message is formatted, and take no locks. Call sites are identified by source location when
+ * the record has one (see AT_LOG), or by the message text otherwise.
+ *
+ * Suppressed and sampled-out records are counted, and summary lines reporting them are sent to the wrapped handler
+ * at most once per summary interval, or whenever flush_summary is called.
+ */
+class RateLimitHandler : public Handler {
+    
+    Handler* inner;
+    ulong interval;
+    ulong tolerance;
+    __RateSite* sites;
+    std::vector<__SampleRate*> samples;
+    
+    std::atomic<ulong> summary_interval;
+    std::atomic<ulong> last_summary;
+    
+    /**
+     * Find the rate limiting state for a record's call site
+     *
+     * \param record Record to find the site of
+     * \return Site state
+     */
+    __RateSite& find_site(const Record& record);
+    
+    /**
+     * Send a summary line to the wrapped handler
+     *
+     * \param text Summary text
+     */
+    void emit_summary(const std::string& text);
+    
+public:
+    
+    /**
+     * Construct a new RateLimitHandler in front of a handler, allowing each call site a sustained rate of
+     * records per second, plus a burst of records above that rate
+     *
+     * \param inner Handler to pass allowed records to. Not owned by this handler
+     * \param rate Records allowed per second, per call site
+     * \param burst Records allowed at once before the rate applies
+     */
+    RateLimitHandler(Handler* inner, double rate, ulong burst = 1);
+    
+    /**
+     * Deconstruct a RateLimitHandler, releasing its site table
+     */
+    ~RateLimitHandler() override;
+    
+    /**
+     * Set the probability that records at a given level are kept, independent of rate limiting. Must be set before
+     * the handler is shared between threads.
+     *
+     * \param level Level to sample
+     * \param probability Chance between 0 and 1 that a record is kept
+     */
+    void set_sample_rate(const Level* level, double probability);
+    
+    /**
+     * Set the minimum time between automatic summaries of dropped records
+     *
+     * \param interval New summary interval
+     */
+    void set_summary_interval(std::chrono::milliseconds interval);
+    
+    /**
+     * Send summaries of all records dropped since the last summary to the wrapped handler now
+     */
+    void flush_summary();
+    
+    /**
+     * Get the number of records dropped and not yet reported in a summary
+     *
+     * \return Unreported dropped records
+     */
+    ulong get_dropped() const;
+    
+    bool accepts(const Record& record) override;
+    
+    bool needs_text() const override;
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include "types.h"
+#include "level.h"
+#include "field.h"
+
+/**
+ * \file record.h
+ * \brief The unit of output passed from loggers to handlers
+ */
+
+/**
+ * Construct a SourceLocation for the place this macro is used
+ */
+#define AT_SOURCE_LOCATION (logging::SourceLocation {__FILE__, __LINE__, __func__})
+
+namespace logging {
+
+/**
+ * The place in source code a record was logged from. Unknown locations have a null file and function, and line 0.
+ * The strings are expected to be literals, so they stay valid for the life of the program.
+ */
+struct SourceLocation {
+    const char* file = nullptr;
+    uint line = 0;
+    const char* function = nullptr;
+};
+
+/**
+ * A single log record, as delivered to a handler. Records are built on the stack of the logging thread and only
+ * live for the duration of the handle call, so handlers that keep any part of one must copy it. When a record is
+ * passed to Handler::accepts it has not been formatted yet, and its text is null. It is also null when passed to
+ * handlers that report they don't need text.
+ */
+struct Record {
+    
+    /**
+     * Level the record was logged at
+     */
+    const Level* level;
+    
+    /**
+     * Name of the logger the record was originally logged to
+     */
+    const std::string* name;
+    
+    /**
+     * The message as passed to the logger, before any formatting
+     */
+    const std::string* message;
+    
+    /**
+     * The message formatted with the pattern of the logger delivering it, or null if not formatted
+     */
+    const std::string* text;
+    
+    /**
+     * Where the record was logged from, if known
+     */
+    SourceLocation location;
+    
+    /**
+     * Structured fields attached to the record, or null if it has none
+     */
+    const Field* fields = nullptr;
+    
+    /**
+     * Number of structured fields attached to the record
+     */
+    ulong field_count = 0;
+    
+    /**
+     * Wall clock time the record was logged at, in nanoseconds since the Unix epoch. Zero until the record reaches
+     * a logger with handlers, so disabled records never read the clock
+     */
+    ulong timestamp = 0;
+    
+    /**
+     * Raw return addresses of the stack the record was logged from, innermost first, or null if no stack was
+     * captured. See stack.h
+     */
+    const void* const* stack = nullptr;
+    
+    /**
+     * Number of captured stack addresses
+     */
+    uint stack_depth = 0;
+    
+};
+
+}
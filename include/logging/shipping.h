@@ -0,0 +1,292 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+#include "types.h"
+#include "level.h"
+#include "record.h"
+#include "handler.h"
+#include "network/socket.h"
+
+/**
+ * \file shipping.h
+ * \brief Shipping log records to a collector process
+ *
+ * Contains a handler that sends records in batches to a collector over TCP or a Unix domain socket, and the reading
+ * side used by collectors. Batches are sent as frames of the form
+ *
+ * ```
+ * uint32  length of the rest of the frame
+ * uint8   flags, bit 0 set if the payload is compressed
+ * uint32  number of records
+ * uint32  uncompressed payload length
+ * ...     payload
+ * ```
+ *
+ * with all integers little endian. The payload holds each record as a one byte level name length, the level name,
+ * a four byte text length, and the formatted text.
+ */
+
+/**
+ * Default number of records in a shipped batch
+ */
+#define AT_SHIP_BATCH_RECORDS 512
+
+/**
+ * Default number of payload bytes in a shipped batch
+ */
+#define AT_SHIP_BATCH_BYTES (64 * 1024)
+
+/**
+ * Number of sealed batches a ShippingHandler queues before dropping new ones
+ */
+#define AT_SHIP_QUEUE_BATCHES 64
+
+namespace logging {
+
+/**
+ * Statistics for a ShippingHandler, counted over the life of the handler
+ */
+struct ShipStats {
+    ulong records = 0;
+    ulong batches = 0;
+    ulong raw_bytes = 0;
+    ulong sends = 0;
+    ulong sent_bytes = 0;
+    ulong connects = 0;
+    ulong failures = 0;
+    ulong spilled_bytes = 0;
+    ulong replayed_bytes = 0;
+    ulong dropped = 0;
+};
+
+/**
+ * \internal
+ *
+ * Delivery settings of a ShippingHandler. The setters change one copy under the handler lock, and the sending thread
+ * works from its own copy, taken under the lock before each batch
+ */
+struct __ShipSettings {
+    bool compressed;
+    std::chrono::milliseconds min_backoff;
+    std::chrono::milliseconds max_backoff;
+    std::string spill_path;
+    ulong spill_limit;
+};
+
+/**
+ * A single record read from a shipped batch
+ */
+struct ShippedRecord {
+    const Level* level;
+    std::string text;
+};
+
+/**
+ * A handler that ships formatted records to a collector. Records are appended to a batch in memory, which is handed
+ * to a background thread once it reaches a record or byte limit, or has been open for longer than the batch delay.
+ * The background thread compresses each batch and sends it as a single frame, so logging threads never block on
+ * the network and each send carries many records.
+ *
+ * If the collector can't be reached, batches are appended to a spill file, and reconnects are attempted with
+ * exponential backoff. Once a connection succeeds, the spill file is sent before any new batches. Delivery is at
+ * least once, as a batch being sent when the connection drops is also spilled.
+ */
+class ShippingHandler : public Handler {
+    
+    std::string host;
+    ushort port;
+    std::string path;
+    
+    ulong batch_records;
+    ulong batch_bytes;
+    std::chrono::milliseconds batch_delay;
+    
+    __ShipSettings settings;
+    bool settings_changed;
+    bool backoff_changed;
+    bool spill_changed;
+    
+    __ShipSettings current;
+    network::Socket* socket;
+    std::chrono::milliseconds backoff;
+    std::chrono::steady_clock::time_point next_attempt;
+    ulong spill_size;
+    
+    std::string batch;
+    ulong batch_count;
+    std::chrono::steady_clock::time_point batch_started;
+    std::deque<std::pair<std::string, ulong>> pending;
+    bool sending;
+    bool stopping;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread sender;
+    
+    ShipStats stats;
+    ShipStats sender_stats;
+    ShipStats published_stats;
+    
+    /**
+     * Move the open batch to the send queue. Must be called with the handler lock held
+     */
+    void seal();
+    
+    /**
+     * Copy changed settings to the sending thread's own, resetting the backoff or reading the size of a new spill
+     * file if those changed. Must be called on the sending thread with the handler lock held
+     */
+    void apply_settings();
+    
+    /**
+     * Body of the background sending thread. Only this thread touches the connection, backoff and spill file, and
+     * it reads settings from its own copy, so nothing it uses changes while it sends without the lock
+     */
+    void run();
+    
+    /**
+     * Send a framed batch to the collector, or spill it if that fails. Called without the handler lock held
+     *
+     * \param data Framed batch
+     * \param records Number of records in the batch
+     */
+    void deliver(const std::string& data, ulong records);
+    
+    /**
+     * Connect to the collector if not connected and the backoff allows, replaying the spill file on success
+     *
+     * \return Whether a connection is available
+     */
+    bool ensure_connected();
+    
+    /**
+     * Drop the current connection, and push back the next reconnect attempt
+     */
+    void disconnect();
+    
+    /**
+     * Append a frame to the spill file, if there's room
+     *
+     * \param frame Frame to spill
+     * \param records Number of records in the frame
+     */
+    void spill(const std::string& frame, ulong records);
+    
+    /**
+     * Send the spill file to the collector, and remove it once sent
+     *
+     * \return Whether the whole spill file was sent
+     */
+    bool replay();
+    
+    /**
+     * Build the frame for a batch payload
+     *
+     * \param payload Batch payload
+     * \param records Number of records in the batch
+     * \return Framed batch, compressed if enabled
+     */
+    std::string frame(const std::string& payload, ulong records);
+    
+    /**
+     * Start the background sending thread, with default settings
+     */
+    void start();
+    
+public:
+    
+    /**
+     * Construct a new ShippingHandler sending to a collector over TCP
+     *
+     * \param host IP address of the collector, of the format "XXX.XXX.XXX.XXX"
+     * \param port Port the collector listens on
+     */
+    ShippingHandler(const std::string& host, ushort port);
+    
+    /**
+     * Construct a new ShippingHandler sending to a collector over a Unix domain socket
+     *
+     * \param path Path of the collector's socket
+     */
+    explicit ShippingHandler(const std::string& path);
+    
+    /**
+     * Deconstruct a ShippingHandler, shipping or spilling every record it was given and stopping its thread
+     */
+    ~ShippingHandler() override;
+    
+    /**
+     * Set when a batch is sealed and sent. A batch is sent once it holds max_records records or max_bytes bytes,
+     * or once it has been open for max_delay
+     *
+     * \param max_records Most records in a batch
+     * \param max_bytes Most payload bytes in a batch
+     * \param max_delay Longest a record waits before its batch is sent
+     */
+    void set_batching(ulong max_records, ulong max_bytes, std::chrono::milliseconds max_delay);
+    
+    /**
+     * Set the delays between reconnect attempts. The delay starts at the minimum, doubles after each failure up to
+     * the maximum, and resets once a connection succeeds
+     *
+     * \param min_delay Delay after the first failure
+     * \param max_delay Longest delay between attempts
+     */
+    void set_backoff(std::chrono::milliseconds min_delay, std::chrono::milliseconds max_delay);
+    
+    /**
+     * Set the file batches are spilled to while the collector is unreachable. Batches that would grow the file past
+     * max_bytes are dropped. With no spill file, batches that can't be sent are dropped
+     *
+     * \param path File to spill to, or an empty string to disable spilling
+     * \param max_bytes Largest the spill file may grow
+     */
+    void set_spill(const std::string& path, ulong max_bytes);
+    
+    /**
+     * Set whether batches are compressed before sending. Enabled by default
+     *
+     * \param enabled Whether to compress batches
+     */
+    void set_compression(bool enabled);
+    
+    /**
+     * Seal the open batch, and wait until every queued batch has been sent or spilled
+     */
+    void flush();
+    
+    /**
+     * Get the shipping statistics for this handler
+     *
+     * \return Current statistics
+     */
+    ShipStats get_stats();
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+/**
+ * Read one shipped batch from a socket, appending its records to a list. Levels are matched by name against the
+ * built-in levels, with unknown names read as INFO
+ *
+ * \param socket Socket to read from
+ * \param records List to append the batch's records to
+ * \return Whether a batch was read, false if the connection closed cleanly before one started
+ */
+bool read_batch(network::Socket& socket, std::vector<ShippedRecord>& records);
+
+/**
+ * Parse one shipped frame, without its leading length, appending its records to a list
+ *
+ * \param data Frame contents after the length
+ * \param length Length of the frame contents
+ * \param records List to append the frame's records to
+ */
+void parse_batch(const char* data, ulong length, std::vector<ShippedRecord>& records);
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include "types.h"
+#include "level.h"
+
+/**
+ * \file stack.h
+ * \brief Capturing and symbolizing stack traces for log records
+ *
+ * Contains the functions loggers use to attach a backtrace to serious records. Capturing only walks the stack and
+ * copies raw return addresses, so it costs about as much as formatting a short message. Turning addresses into
+ * names is left until a record is rendered, and both the symbol found for each address and each demangled name are
+ * cached, so a trace that repeats is only symbolized once.
+ */
+
+/**
+ * Maximum number of frames captured for a record
+ */
+#define AT_STACK_DEPTH 32
+
+namespace logging {
+
+/**
+ * Set the lowest level at which loggers capture a stack trace for each record they log, or nullptr to never
+ * capture. Defaults to nullptr
+ *
+ * \param level New capture level
+ */
+void set_stack_level(Level* level);
+
+/**
+ * Get the lowest level at which loggers capture stack traces
+ *
+ * \return Current capture level, or nullptr if capturing is disabled
+ */
+Level* get_stack_level();
+
+/**
+ * Capture the return addresses of the calling thread's stack
+ *
+ * \param frames Array to fill with addresses
+ * \param max Size of the array
+ * \param skip Number of innermost frames to leave out, not counting this function
+ * \return Number of addresses captured
+ */
+uint capture_stack(void** frames, uint max, uint skip);
+
+/**
+ * Get a readable description of a code address, as the demangled function name and offset into it, along with the
+ * module it lives in. Falls back to the module and offset into it when the function isn't exported. Results are
+ * cached for the life of the program
+ *
+ * \param address Address to describe
+ * \return Description of the address
+ */
+std::string symbolize(const void* address);
+
+/**
+ * Append a captured stack trace, one frame per line, each line starting with a newline and indented
+ *
+ * \param out String to append to
+ * \param frames Captured addresses
+ * \param depth Number of addresses
+ */
+void render_stack(std::string& out, const void* const* frames, uint depth);
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include "types.h"
+#include "level.h"
+#include "field.h"
+#include "record.h"
+#include "handler.h"
+
+/**
+ * \file structured.h
+ * \brief Rendering structured log records
+ *
+ * Contains renderers that turn a record and its fields into text, JSON lines, or a compact binary form, and a
+ * handler that writes records to a stream in any of those forms. Field values are only converted when a renderer
+ * asks for them, so handlers that don't need text never pay for it.
+ */
+
+namespace logging {
+
+/**
+ * The output form of a StreamHandler
+ */
+enum class RecordFormat {
+    TEXT, JSON, BINARY
+};
+
+/**
+ * Append fields as space separated `key=value` pairs. String values containing spaces, quotes, equals signs or
+ * control characters are quoted and escaped
+ *
+ * \param out String to append to
+ * \param fields Fields to render
+ * \param count Number of fields
+ */
+void render_fields(std::string& out, const Field* fields, ulong count);
+
+/**
+ * Append a record as a single line JSON object, without the trailing newline. The object holds the UTC time if the
+ * record has one, the level, logger name, message, source location if known, every field under its own key, and
+ * the symbolized stack trace as an array of frames if one was captured. Vectors become three element arrays, and
+ * non-finite doubles become null
+ *
+ * \param out String to append to
+ * \param record Record to render
+ */
+void render_json(std::string& out, const Record& record);
+
+/**
+ * Append a record in a compact little endian binary form. Each record is prefixed by its length as a 32 bit
+ * unsigned int, followed by the level priority and name, logger name, message, source file and line, and the
+ * fields, each as a key, a one byte FieldType tag, and its raw value
+ *
+ * \param out String to append to
+ * \param record Record to render
+ */
+void render_binary(std::string& out, const Record& record);
+
+/**
+ * A handler that writes records to any output stream, as text, JSON lines, or binary. Text output uses the
+ * formatted text from the logger, while JSON and binary output are rendered directly from the record, so the
+ * logger doesn't format text for them. The stream is not owned by the handler.
+ */
+class StreamHandler : public Handler {
+    
+    std::ostream* stream;
+    RecordFormat format;
+    std::string buffer;
+    
+public:
+    
+    /**
+     * Construct a new StreamHandler writing to a stream in the given format
+     *
+     * \param stream Stream to write to
+     * \param format Form to write records in
+     */
+    explicit StreamHandler(std::ostream& stream, RecordFormat format = RecordFormat::TEXT);
+    
+    /**
+     * Get the form records are written in
+     *
+     * \return Current record format
+     */
+    RecordFormat get_format() const;
+    
+    bool needs_text() const override;
+    
+    void handle(const Record& record) override;
+    
+    void log(const std::string& message, const Level* level) override;
+    
+};
+
+}
@@ -0,0 +1,202 @@
+#pragma once
+
+#include "types.h"
+#include "socket.h"
+
+/**
+ * \file datagram.h
+ * \brief Batched datagram I/O with segmentation offload
+ *
+ * Contains a preallocated batch of datagrams, and functions that receive or send a whole batch with one system call
+ * using recvmmsg and sendmmsg. Where the kernel supports UDP segmentation offload, one large buffer can also be sent
+ * as many equally sized datagrams in a single call, and with UDP_GRO enabled on a socket, received datagrams from
+ * the same flow may arrive coalesced into one slot along with their segment size. On platforms without the batched
+ * calls, the same functions loop over single sends and receives, so callers never need to check.
+ */
+
+/**
+ * Default number of datagrams in a DatagramBatch
+ */
+#define AT_DATAGRAM_BATCH 64
+
+/**
+ * Largest UDP payload that fits in one IPv4 datagram, and so the most one segmented send can carry per call
+ */
+#define AT_DATAGRAM_MAX 65507
+
+namespace network {
+
+/**
+ * \internal
+ *
+ * The message headers, address and control buffers for each slot of a DatagramBatch
+ */
+struct __DatagramSlots;
+
+/**
+ * A fixed number of datagram slots, each with its own buffer and address, allocated once and reused for every batch.
+ * The same batch can be used to receive, filling slots from the start, or to send, by pushing datagrams into it.
+ * Datagram data is read and written in place, so nothing is copied beyond what the kernel does.
+ */
+class DatagramBatch {
+    
+    ulong capacity;
+    ulong slot_size;
+    char* storage;
+    __DatagramSlots* slots;
+    ulong count;
+    ulong sent;
+    
+    friend IOResult recv_batch(Socket& socket, DatagramBatch& batch, int flags);
+    friend IOResult send_batch(Socket& socket, DatagramBatch& batch, int flags);
+    
+public:
+    
+    /**
+     * Construct a new DatagramBatch, allocating every slot up front
+     *
+     * \param capacity Number of datagrams the batch holds
+     * \param slot_size Bytes each slot holds. Longer received datagrams are truncated. Use AT_DATAGRAM_MAX with
+     *                  UDP_GRO enabled, so coalesced datagrams fit
+     */
+    explicit DatagramBatch(ulong capacity = AT_DATAGRAM_BATCH, ulong slot_size = 2048);
+    
+    /**
+     * Deconstruct a DatagramBatch, freeing every slot
+     */
+    ~DatagramBatch();
+    
+    DatagramBatch(const DatagramBatch&) = delete;
+    DatagramBatch& operator=(const DatagramBatch&) = delete;
+    
+    /**
+     * Get the number of datagrams the batch can hold
+     *
+     * \return Slot count
+     */
+    ulong get_capacity() const;
+    
+    /**
+     * Get the number of bytes each slot holds
+     *
+     * \return Slot size
+     */
+    ulong get_slot_size() const;
+    
+    /**
+     * Get the number of datagrams in the batch, either received or pushed
+     *
+     * \return Datagram count
+     */
+    ulong size() const;
+    
+    /**
+     * Get the number of pushed datagrams already sent by send_batch
+     *
+     * \return Sent datagram count
+     */
+    ulong get_sent() const;
+    
+    /**
+     * Empty the batch, so it can be received into or pushed to again
+     */
+    void clear();
+    
+    /**
+     * Get the data of a datagram in the batch, or the buffer of an empty slot to write into before commit
+     *
+     * \param index Index of the slot
+     * \return Start of the slot's buffer
+     * \throws std::out_of_range if the index is past the capacity
+     */
+    char* data(ulong index);
+    
+    /**
+     * Get the length of a datagram in the batch
+     *
+     * \param index Index of the datagram
+     * \return Length in bytes
+     * \throws std::out_of_range if the index is past the size
+     */
+    ulong length(ulong index) const;
+    
+    /**
+     * Get the address a received datagram came from, or a pushed one is going to
+     *
+     * \param index Index of the datagram
+     * \return Address of the peer
+     * \throws std::out_of_range if the index is past the size
+     */
+    Endpoint get_endpoint(ulong index) const;
+    
+    /**
+     * Get the segment size of a received datagram coalesced by UDP_GRO. The slot then holds several datagrams back
+     * to back, each this long except the last, which may be shorter
+     *
+     * \param index Index of the datagram
+     * \return Segment size, or 0 if the datagram wasn't coalesced
+     * \throws std::out_of_range if the index is past the size
+     */
+    ulong get_segment_size(ulong index) const;
+    
+    /**
+     * Copy a datagram into the next free slot, to be sent by send_batch
+     *
+     * \param bytes Bytes of the datagram
+     * \param length Number of bytes, up to the slot size
+     * \param to Address to send to
+     * \return Whether there was a free slot
+     * \throws std::out_of_range if the datagram is longer than the slot size
+     */
+    bool push(const char* bytes, ulong length, const Endpoint& to);
+    
+    /**
+     * Add a datagram already written in place to the next free slot, through data(size()), to be sent by
+     * send_batch. Avoids the copy made by push
+     *
+     * \param length Number of bytes written, up to the slot size
+     * \param to Address to send to
+     * \return Whether there was a free slot
+     * \throws std::out_of_range if the length is longer than the slot size
+     */
+    bool commit(ulong length, const Endpoint& to);
+    
+};
+
+/**
+ * Receive as many waiting datagrams as fit into an empty batch, with one recvmmsg call. A blocking socket waits for
+ * the first datagram only, then takes whatever else is already queued. The batch is cleared first
+ *
+ * \param socket Datagram socket to receive on
+ * \param batch Batch to receive into
+ * \param flags Flags to pass to the system call
+ * \return Total bytes received across all datagrams and errno. An error is only reported if nothing was received
+ */
+IOResult recv_batch(Socket& socket, DatagramBatch& batch, int flags = 0);
+
+/**
+ * Send every pushed datagram not yet sent, with as few sendmmsg calls as possible. On a non-blocking socket, stops
+ * with EAGAIN once the send buffer is full, and calling again resumes after the last datagram sent
+ *
+ * \param socket Datagram socket to send on
+ * \param batch Batch to send from
+ * \param flags Flags to pass to every system call
+ * \return Total bytes sent across all datagrams and errno
+ */
+IOResult send_batch(Socket& socket, DatagramBatch& batch, int flags = 0);
+
+/**
+ * Send a buffer to one address as a run of datagrams of equal size, except the last which may be shorter. With UDP
+ * segmentation offload, up to AT_DATAGRAM_MAX bytes go to the kernel in one call and are split there, or by the
+ * network card. Without it, each datagram is sent on its own
+ *
+ * \param socket Datagram socket to send on
+ * \param bytes Bytes to send
+ * \param length Number of bytes to send
+ * \param segment Size of each datagram
+ * \param to Address to send to
+ * \return Total bytes sent and errno
+ */
+IOResult send_segmented(Socket& socket, const char* bytes, ulong length, ulong segment, const Endpoint& to);
+
+}
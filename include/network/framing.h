@@ -0,0 +1,362 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "socket.h"
+
+/**
+ * \file framing.h
+ * \brief Length-prefixed message framing over a byte stream
+ *
+ * Contains an encoder and decoder for splitting a stream socket into messages. Each frame has the form
+ *
+ * ```
+ * prefix  payload length, as a varint or a fixed size little endian integer
+ * ...     payload
+ * uint32  crc32 of the payload, little endian, only if checksums are enabled
+ * ```
+ *
+ * The decoder reads from the socket straight into buffers taken from a BufferPool, parses frames as bytes arrive,
+ * however the reads split them, and hands each complete frame out as a view into the buffer it was read into, so
+ * payloads are never copied. The encoder gathers frames into one pending buffer so many small frames go out in a
+ * single send.
+ */
+
+/**
+ * Default size of each pooled receive buffer, and how many pending bytes a FrameEncoder holds before asking to flush
+ */
+#define AT_FRAME_BUFFER (64 * 1024)
+
+/**
+ * Default largest frame payload accepted
+ */
+#define AT_FRAME_MAX (16 * 1024 * 1024)
+
+namespace network {
+
+/**
+ * Exception thrown when a stream can't be framed, because a frame is too large, its length prefix is malformed, or
+ * its checksum doesn't match. The stream can't be resynchronised after one
+ */
+class frame_error : public socket_error {
+public:
+    
+    /**
+     * Construct a new frame_error with a message
+     *
+     * \param msg Message describing what's wrong with the frame
+     */
+    explicit frame_error(const std::string& msg);
+    
+};
+
+/**
+ * How the payload length at the start of each frame is encoded
+ */
+enum class LengthPrefix {
+    VARINT, FIXED16, FIXED32, FIXED64
+};
+
+/**
+ * Framing settings, which must match on both ends of a stream
+ */
+struct FrameOptions {
+    LengthPrefix prefix = LengthPrefix::VARINT;
+    bool checksum = false;
+    ulong max_frame = AT_FRAME_MAX;
+};
+
+class BufferPool;
+
+/**
+ * \internal
+ *
+ * A reference counted receive buffer, returned to its pool once the decoder and every frame viewing it let go
+ */
+struct __FrameBuffer {
+    char* data;
+    ulong capacity;
+    ulong refs;
+    BufferPool* pool;
+};
+
+/**
+ * A pool of equally sized receive buffers, reused so a steady stream of frames doesn't allocate. Buffers larger than
+ * the pool size are allocated for frames that don't fit, and freed rather than kept once released. Not thread safe,
+ * so frames from a pool must be released on the thread using it, and the pool must outlive them.
+ */
+class BufferPool {
+    
+    ulong buffer_size;
+    ulong max_free;
+    ulong allocated;
+    std::vector<__FrameBuffer*> free;
+    
+public:
+    
+    /**
+     * Construct a new BufferPool, with no buffers allocated yet
+     *
+     * \param buffer_size Size of each pooled buffer
+     * \param max_free Most released buffers kept for reuse, past which they are freed
+     */
+    explicit BufferPool(ulong buffer_size = AT_FRAME_BUFFER, ulong max_free = 16);
+    
+    /**
+     * Deconstruct a BufferPool, freeing every buffer kept for reuse
+     */
+    ~BufferPool();
+    
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    
+    /**
+     * Take a buffer with one reference, reusing a released one if possible
+     *
+     * \param size Least capacity needed. Sizes over the pool size get a buffer of their own
+     * \return Buffer with at least the requested capacity
+     */
+    __FrameBuffer* acquire(ulong size);
+    
+    /**
+     * Drop a reference to a buffer, keeping or freeing it once nothing refers to it
+     *
+     * \param buffer Buffer taken from this pool
+     */
+    void release(__FrameBuffer* buffer);
+    
+    /**
+     * Get the size of each pooled buffer
+     *
+     * \return Buffer size
+     */
+    ulong get_buffer_size() const;
+    
+    /**
+     * Get the number of buffers from this pool that are in use
+     *
+     * \return Buffers acquired and not yet released
+     */
+    ulong get_allocated() const;
+    
+    /**
+     * Get the number of released buffers kept for reuse
+     *
+     * \return Free buffer count
+     */
+    ulong get_free() const;
+    
+};
+
+/**
+ * A complete frame's payload, viewed in place in the receive buffer it arrived in. The buffer stays alive for as long
+ * as any frame viewing it does. Copying a frame shares the view rather than the bytes.
+ */
+class Frame {
+    
+    __FrameBuffer* buffer;
+    const char* bytes;
+    ulong length;
+    
+    friend class FrameDecoder;
+    
+    /**
+     * Construct a new Frame viewing part of a buffer, taking a reference to it
+     *
+     * \param buffer Buffer holding the payload
+     * \param bytes Start of the payload
+     * \param length Length of the payload
+     */
+    Frame(__FrameBuffer* buffer, const char* bytes, ulong length);
+    
+public:
+    
+    /**
+     * Construct an empty Frame, viewing nothing
+     */
+    Frame();
+    
+    Frame(const Frame& other);
+    Frame(Frame&& other) noexcept;
+    Frame& operator=(const Frame& other);
+    Frame& operator=(Frame&& other) noexcept;
+    
+    /**
+     * Deconstruct a Frame, releasing its buffer if it was the last view of it
+     */
+    ~Frame();
+    
+    /**
+     * Get the start of the payload
+     *
+     * \return Payload bytes, valid for as long as this frame is
+     */
+    const char* data() const;
+    
+    /**
+     * Get the length of the payload
+     *
+     * \return Payload length in bytes
+     */
+    ulong size() const;
+    
+    /**
+     * Copy the payload into a string
+     *
+     * \return Payload as a string
+     */
+    std::string str() const;
+    
+};
+
+/**
+ * Splits a byte stream into frames as it arrives. Bytes are read into the free end of the current buffer, and each
+ * complete frame is handed out as a view into it. When a partial frame reaches the end of the buffer, it is moved to
+ * the front if nothing else views the buffer, or to a fresh one that's large enough if something does.
+ */
+class FrameDecoder {
+    
+    BufferPool& pool;
+    FrameOptions options;
+    __FrameBuffer* current;
+    ulong begin;
+    ulong end;
+    ulong expected;
+    
+public:
+    
+    /**
+     * Construct a new FrameDecoder, with nothing buffered
+     *
+     * \param pool Pool to take receive buffers from. Must outlive the decoder and its frames
+     * \param options Framing settings of the stream
+     */
+    explicit FrameDecoder(BufferPool& pool, FrameOptions options = FrameOptions());
+    
+    /**
+     * Deconstruct a FrameDecoder, releasing its buffer. Frames already handed out stay valid
+     */
+    ~FrameDecoder();
+    
+    FrameDecoder(const FrameDecoder&) = delete;
+    FrameDecoder& operator=(const FrameDecoder&) = delete;
+    
+    /**
+     * Get space to read more of the stream into, making room for the frame in progress if needed
+     *
+     * \return Free end of the current buffer
+     */
+    MutableBuffer prepare();
+    
+    /**
+     * Add bytes written into the space from prepare to the stream
+     *
+     * \param bytes Number of bytes written
+     */
+    void commit(ulong bytes);
+    
+    /**
+     * Add bytes to the stream by copying them in, for data not read straight from a socket
+     *
+     * \param bytes Bytes to add
+     * \param length Number of bytes
+     */
+    void feed(const char* bytes, ulong length);
+    
+    /**
+     * Make one receive from a socket into the stream
+     *
+     * \param socket Socket to receive on
+     * \return Bytes received and errno, no bytes and no error if the peer closed the connection
+     */
+    IOResult read_from(Socket& socket);
+    
+    /**
+     * Take the next complete frame from the stream
+     *
+     * \param frame Set to the frame, if there is one
+     * \return Whether a complete frame was buffered
+     * \throws frame_error if the frame is too large, its prefix is malformed, or its checksum doesn't match
+     */
+    bool next(Frame& frame);
+    
+    /**
+     * Get the number of bytes received but not yet taken as frames
+     *
+     * \return Buffered byte count
+     */
+    ulong get_buffered() const;
+    
+};
+
+/**
+ * Encodes frames into one pending buffer, so many small frames can go out in a single send. Pending bytes are kept
+ * across flushes that would block, and sent first next time.
+ */
+class FrameEncoder {
+    
+    FrameOptions options;
+    ulong flush_size;
+    std::vector<char> pending;
+    ulong flushed;
+    
+public:
+    
+    /**
+     * Construct a new FrameEncoder, with nothing pending
+     *
+     * \param options Framing settings of the stream
+     * \param flush_size Pending bytes past which should_flush is true
+     */
+    explicit FrameEncoder(FrameOptions options = FrameOptions(), ulong flush_size = AT_FRAME_BUFFER);
+    
+    /**
+     * Encode a frame onto the end of the pending buffer
+     *
+     * \param bytes Payload of the frame
+     * \param length Length of the payload
+     * \throws frame_error if the payload is larger than the maximum frame size
+     */
+    void write(const char* bytes, ulong length);
+    
+    /**
+     * Check whether enough is pending that it should be sent
+     *
+     * \return Whether the pending bytes have reached the flush size
+     */
+    bool should_flush() const;
+    
+    /**
+     * Get the number of encoded bytes not yet sent
+     *
+     * \return Pending byte count
+     */
+    ulong get_pending() const;
+    
+    /**
+     * Get the encoded bytes not yet sent, for sending by other means than flush, such as a UringReactor
+     *
+     * \return Pending bytes, valid until the next write or consume
+     */
+    ConstBuffer peek() const;
+    
+    /**
+     * Mark bytes from the start of peek as sent
+     *
+     * \param bytes Number of bytes sent, up to the pending count
+     */
+    void consume(ulong bytes);
+    
+    /**
+     * Send everything pending. On a non-blocking socket, stops with EAGAIN once the send buffer is full, keeping the
+     * rest pending
+     *
+     * \param socket Socket to send on
+     * \return Bytes sent and errno
+     */
+    IOResult flush(Socket& socket);
+    
+};
+
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include "types.h"
+#include "socket.h"
+
+/**
+ * \file reactor.h
+ * \brief Event loop for non-blocking sockets
+ *
+ * Contains a single-threaded event loop that waits on many file descriptors at once, calling back when they become
+ * readable or writable, and runs timers on the same thread. Uses edge-triggered epoll, so a callback is only made
+ * when a descriptor changes state, and must read or write until the operation would block before waiting again.
+ * The loop interface is shared with the io_uring backend in uring.h. Only available on Linux, other platforms throw
+ * on construction.
+ */
+
+/**
+ * Maximum number of events a Reactor handles per wait
+ */
+#define AT_REACTOR_EVENTS 256
+
+namespace network {
+
+/**
+ * Bit flags for the events a Reactor watches for and reports
+ */
+enum IOEvent : uint {
+    IO_READ = 1,
+    IO_WRITE = 2,
+    IO_HANGUP = 4,
+    IO_ERROR = 8
+};
+
+/**
+ * Called with the IOEvent flags that occurred on a watched descriptor
+ */
+typedef std::function<void(uint events)> IOCallback;
+
+/**
+ * Called when a timer expires
+ */
+typedef std::function<void()> TimerCallback;
+
+/**
+ * \internal
+ *
+ * A descriptor watched by a Reactor, and its callback
+ */
+struct __ReactorWatch {
+    ulong fd;
+    uint events;
+    IOCallback callback;
+    bool removed;
+};
+
+/**
+ * \internal
+ *
+ * A scheduled run of a timer. Cancelled timers leave their entries in the queue, to be skipped when they come up
+ */
+struct __TimerEntry {
+    
+    std::chrono::steady_clock::time_point deadline;
+    ulong id;
+    
+    bool operator>(const __TimerEntry& other) const;
+    
+};
+
+/**
+ * \internal
+ *
+ * A timer registered with a Reactor
+ */
+struct __ReactorTimer {
+    TimerCallback callback;
+    std::chrono::milliseconds repeat;
+};
+
+/**
+ * Interface shared by the event loop backends, so applications can switch between them. Descriptors and timers are
+ * added with callbacks, then run or run_once waits for and dispatches their events on the calling thread. All
+ * methods except stop must be called from the thread running the loop, or while it isn't running. Callbacks may add,
+ * change and remove watches and timers, including their own. Timers are handled here, the same for every backend.
+ */
+class EventLoop {
+    
+    std::priority_queue<__TimerEntry, std::vector<__TimerEntry>, std::greater<__TimerEntry>> timer_queue;
+    std::unordered_map<ulong, __ReactorTimer> timers;
+    ulong next_timer;
+    
+    std::atomic<bool> stopping;
+    
+protected:
+    
+    /**
+     * Run every timer whose deadline has passed
+     *
+     * \return Number of timers run
+     */
+    ulong run_timers();
+    
+    /**
+     * Get how long to wait for events before the next timer is due
+     *
+     * \param timeout Longest wait wanted by the caller, or negative to wait indefinitely
+     * \return Milliseconds to wait, or -1 to wait indefinitely
+     */
+    int wait_time(std::chrono::milliseconds timeout);
+    
+    /**
+     * Interrupt a wait in progress on the loop thread. Called by stop, possibly from another thread
+     */
+    virtual void wake() = 0;
+    
+public:
+    
+    /**
+     * Construct a new EventLoop, with no timers
+     */
+    EventLoop();
+    
+    /**
+     * Deconstruct an EventLoop
+     */
+    virtual ~EventLoop();
+    
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+    
+    /**
+     * Watch a descriptor for events. The descriptor should be non-blocking, as callbacks must drain it
+     *
+     * \param fd Descriptor to watch
+     * \param events IOEvent flags to watch for. Hangups and errors are always reported
+     * \param callback Function to call with the events that occurred
+     */
+    virtual void add(ulong fd, uint events, IOCallback callback) = 0;
+    
+    /**
+     * Watch a socket for events, switching it to non-blocking mode first
+     *
+     * \param socket Socket to watch. Must outlive the watch
+     * \param events IOEvent flags to watch for. Hangups and errors are always reported
+     * \param callback Function to call with the events that occurred
+     */
+    void add(Socket& socket, uint events, IOCallback callback);
+    
+    /**
+     * Change the events a watched descriptor is watched for. Because watches are edge-triggered, adding IO_WRITE
+     * to a writable descriptor reports it as writable straight away
+     *
+     * \param fd Watched descriptor
+     * \param events New IOEvent flags to watch for
+     */
+    virtual void modify(ulong fd, uint events) = 0;
+    
+    /**
+     * Stop watching a descriptor. Must be called before the descriptor is closed. Pending events for it in the
+     * current batch are dropped
+     *
+     * \param fd Watched descriptor
+     * \return Whether the descriptor was being watched
+     */
+    virtual bool remove(ulong fd) = 0;
+    
+    /**
+     * Run a callback after a delay, and optionally repeatedly after that
+     *
+     * \param delay Time until the first run
+     * \param callback Function to run
+     * \param repeat Time between later runs, or zero to run once
+     * \return Id of the timer, for cancel_timer
+     */
+    ulong add_timer(std::chrono::milliseconds delay, TimerCallback callback,
+                    std::chrono::milliseconds repeat = std::chrono::milliseconds(0));
+    
+    /**
+     * Cancel a timer, so it won't run again
+     *
+     * \param id Id of the timer
+     * \return Whether the timer was still scheduled
+     */
+    bool cancel_timer(ulong id);
+    
+    /**
+     * Wait for one batch of events and run their callbacks, along with any timers that are due
+     *
+     * \param timeout Longest time to wait, or negative to wait until something happens
+     * \return Number of callbacks run
+     */
+    virtual ulong run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) = 0;
+    
+    /**
+     * Run the loop until stop is called
+     */
+    void run();
+    
+    /**
+     * Make run return after its current batch. Safe to call from any thread, or a callback
+     */
+    void stop();
+    
+    /**
+     * Get the number of descriptors being watched
+     *
+     * \return Watched descriptor count
+     */
+    virtual ulong get_watched() const = 0;
+    
+};
+
+/**
+ * The epoll event loop backend. Watches are edge-triggered, so a callback is only made when a descriptor changes
+ * state. Works on any Linux kernel
+ */
+class Reactor : public EventLoop {
+    
+    int epoll_fd;
+    int wake_fd;
+    
+    std::unordered_map<ulong, __ReactorWatch*> watches;
+    std::vector<__ReactorWatch*> retired;
+    
+protected:
+    
+    void wake() override;
+    
+public:
+    
+    /**
+     * Construct a new Reactor, with nothing to watch
+     */
+    Reactor();
+    
+    /**
+     * Deconstruct a Reactor. Watched descriptors are not closed
+     */
+    ~Reactor() override;
+    
+    using EventLoop::add;
+    
+    void add(ulong fd, uint events, IOCallback callback) override;
+    
+    void modify(ulong fd, uint events) override;
+    
+    bool remove(ulong fd) override;
+    
+    ulong run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) override;
+    
+    ulong get_watched() const override;
+    
+};
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "types.h"
+#include "socket.h"
+#include "uring.h"
+
+/**
+ * \file sharded_server.h
+ * \brief Multi-threaded TCP server with a listener per thread
+ *
+ * Contains a server that runs one event loop per worker thread, each with its own listening socket bound to the
+ * same port with SO_REUSEPORT. The kernel spreads incoming connections across the listeners, so accepting scales
+ * with the number of workers instead of being limited by one shared accept loop. Each worker is pinned to its own
+ * core, and a connection is served entirely by the worker that accepted it.
+ */
+
+namespace network {
+
+/**
+ * Called on a worker thread for each connection it accepts, with the worker's event loop. The handler takes
+ * ownership of the socket, and should add it to the loop to serve it
+ */
+typedef std::function<void(EventLoop& loop, Socket socket)> ConnectionHandler;
+
+/**
+ * Pin the calling thread to one of the CPUs the process may run on. Does nothing where affinity isn't supported
+ *
+ * \param index Index into the CPUs available to the process, wrapping around if there are fewer
+ * \return Whether the thread was pinned
+ */
+bool pin_thread(uint index);
+
+/**
+ * \internal
+ *
+ * One worker of a ShardedServer, and the listener and loop it owns
+ */
+struct __ServerWorker {
+    Socket listener;
+    EventLoop* loop = nullptr;
+    std::thread thread;
+    std::atomic<ulong> accepted {0};
+};
+
+/**
+ * A TCP server that shards accepting across worker threads. Every worker opens its own SO_REUSEPORT listener on the
+ * port and runs an event loop on its own pinned core, and the kernel balances new connections between them.
+ */
+class ShardedServer {
+    
+    ushort port;
+    uint workers;
+    LoopBackend backend;
+    uint backlog;
+    bool pin;
+    std::vector<__ServerWorker*> running;
+    
+public:
+    
+    /**
+     * Construct a new ShardedServer. Nothing is opened until start is called
+     *
+     * \param port Port to listen on
+     * \param workers Number of worker threads, or 0 for one per hardware thread
+     * \param backend Event loop backend each worker uses
+     */
+    explicit ShardedServer(ushort port, uint workers = 0, LoopBackend backend = LoopBackend::AUTO);
+    
+    /**
+     * Deconstruct a ShardedServer, stopping it if it's running
+     */
+    ~ShardedServer();
+    
+    ShardedServer(const ShardedServer&) = delete;
+    ShardedServer& operator=(const ShardedServer&) = delete;
+    
+    /**
+     * Set the listen backlog of each worker's listener. Must be called before start
+     *
+     * \param backlog Pending connections each listener holds
+     */
+    void set_backlog(uint backlog);
+    
+    /**
+     * Set whether each worker is pinned to a core. Must be called before start
+     *
+     * \param pin Whether to pin workers
+     */
+    void set_pinning(bool pin);
+    
+    /**
+     * Open every worker's listener and start the workers. All listeners are bound before any worker starts, so a
+     * failure leaves nothing running
+     *
+     * \param handler Function to call for each accepted connection, on the worker that accepted it
+     * \throws socket_error if a listener can't be opened, or SO_REUSEPORT isn't supported
+     */
+    void start(ConnectionHandler handler);
+    
+    /**
+     * Stop every worker, waiting for them to finish, and close the listeners. Connections still owned by handlers
+     * must be released by them, as the worker loops are deleted
+     */
+    void stop();
+    
+    /**
+     * Get the number of worker threads
+     *
+     * \return Worker count
+     */
+    uint get_workers() const;
+    
+    /**
+     * Get how many connections each worker has accepted, to see how evenly they are balanced
+     *
+     * \return Accepted connection count per worker
+     */
+    std::vector<ulong> get_accepted() const;
+    
+};
+
+}
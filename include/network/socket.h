@@ -8,10 +8,15 @@
 #include <arpa/inet.h>
 #else
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #endif
 
 #include <string>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <initializer_list>
 #include <stdexcept>
 #include "types.h"
 
@@ -20,6 +25,26 @@
  * \brief Generic cross-platform sockets for C++
  */
 
+/**
+ * Flag for send calls saying more data follows straight after, so the kernel holds back a partial segment until the
+ * last part is sent without it. Zero where unsupported
+ */
+#ifdef MSG_MORE
+#define AT_MSG_MORE MSG_MORE
+#else
+#define AT_MSG_MORE 0
+#endif
+
+/**
+ * Most buffers passed to the kernel in one vectored send or receive. Longer lists are transferred partially
+ */
+#define AT_IOV_BATCH 64
+
+/**
+ * Most descriptors passed in one send_fds call, matching the Linux limit
+ */
+#define AT_MAX_FDS 253
+
 namespace network {
 
 /**
@@ -56,22 +81,28 @@ public:
     
 };
 
+template<typename T>
+struct TypedSockOpt;
+
 /**
- * A struct representing a socket option
+ * A struct representing a socket option, at any protocol level. The library defines the common options statically,
+ * each typed with the value it takes. Options it doesn't cover can be constructed directly. Options the platform
+ * doesn't support have a negative sock_name, and throw when used
  */
 struct SockOpt {
     
     std::string name;
+    int level;
     int sock_name;
     socklen_t length;
     
-    static const SockOpt DEBUG, BROADCAST, REUSEADDR, KEEPALIVE, LINGER, OOBINLINE, SNDBUF, RCVBUF, DONTROUTE,
-            RCVLOWAT, RCVTIMEO, SNDLOWAT, SNDTIMEO;
-    
-protected:
+    static const TypedSockOpt<int> DEBUG, BROADCAST, REUSEADDR, KEEPALIVE, OOBINLINE, SNDBUF, RCVBUF, DONTROUTE,
+            RCVLOWAT, SNDLOWAT, REUSEPORT, BUSY_POLL, NODELAY, QUICKACK, FASTOPEN, SEGMENT, GRO;
+    static const TypedSockOpt<linger> LINGER;
+    static const TypedSockOpt<timeval> RCVTIMEO, SNDTIMEO;
     
     /**
-     * Construct a new SockOpt instance. Protected as all options are constructed by the library statically.
+     * Construct a new SockOpt instance at the socket level
      *
      * \param name Human-readable name of the option
      * \param sock_name Actual value of the option
@@ -79,8 +110,35 @@ protected:
      */
     SockOpt(const char* name, int sock_name, socklen_t length) noexcept;
     
+    /**
+     * Construct a new SockOpt instance at a given protocol level, such as IPPROTO_TCP
+     *
+     * \param name Human-readable name of the option
+     * \param level Protocol level of the option
+     * \param sock_name Actual value of the option, or negative if unsupported
+     * \param length Size of pointer passed to the option
+     */
+    SockOpt(const char* name, int level, int sock_name, socklen_t length) noexcept;
+    
 };
 
+/**
+ * A socket option along with the type of value it takes, so Socket::set and Socket::get can check values at compile
+ * time
+ */
+template<typename T>
+struct TypedSockOpt : public SockOpt {
+    
+    /**
+     * Construct a new TypedSockOpt at a given protocol level
+     *
+     * \param name Human-readable name of the option
+     * \param level Protocol level of the option
+     * \param sock_name Actual value of the option, or negative if unsupported
+     */
+    TypedSockOpt(const char* name, int level, int sock_name) noexcept;
+    
+};
 
 /**
  * A struct representing an IP address
@@ -105,7 +163,80 @@ struct IPAddr {
 };
 
 /**
- * A low level socket. In most cases, shouldn't use this
+ * An IPv4 address and port, naming where a datagram came from or is going to
+ */
+struct Endpoint {
+    IPAddr ip;
+    ushort port;
+    
+    /**
+     * Construct an Endpoint for any address and port 0
+     */
+    Endpoint();
+    
+    /**
+     * Construct an Endpoint from an address and port
+     *
+     * \param ip Address of the endpoint
+     * \param port Port of the endpoint
+     */
+    Endpoint(const IPAddr& ip, ushort port);
+    
+    /**
+     * Construct an Endpoint from an address in dotted text form and port
+     *
+     * \param ip Address of the endpoint, such as "127.0.0.1"
+     * \param port Port of the endpoint
+     */
+    Endpoint(const std::string& ip, ushort port);
+    
+};
+
+/**
+ * Result of a socket read or write that reports failure by status rather than by throwing. Holds the number of bytes
+ * actually transferred, and the errno of the failure that stopped the operation, if any. A receive that returns no
+ * bytes and no error means the peer closed the connection.
+ */
+struct IOResult {
+    
+    ulong bytes = 0;
+    int error = 0;
+    
+    /**
+     * Check whether the operation finished without an error
+     *
+     * \return Whether error is zero
+     */
+    bool ok() const;
+    
+    /**
+     * Check whether the operation stopped because a non-blocking socket wasn't ready, rather than failing
+     *
+     * \return Whether error is EAGAIN or EWOULDBLOCK
+     */
+    bool would_block() const;
+    
+};
+
+/**
+ * A region of memory to send from, one part of a vectored send
+ */
+struct ConstBuffer {
+    const char* data;
+    ulong length;
+};
+
+/**
+ * A region of memory to receive into, one part of a vectored receive
+ */
+struct MutableBuffer {
+    char* data;
+    ulong length;
+};
+
+/**
+ * A low level socket. In most cases, shouldn't use this. Sockets own their file descriptor, which is closed when
+ * the socket is destroyed, so they can be moved but not copied.
  */
 class Socket {
     
@@ -115,6 +246,8 @@ class Socket {
     
     sockaddr* addr;
     
+    friend class UringReactor;
+    
     /**
      * Protected constructor for a socket with an existing file descriptor
      *
@@ -123,7 +256,7 @@ class Socket {
      * \param type Type of the socket, defaults to Stream
      */
     explicit Socket(ulong sockfd, ushort domain = AF_INET, uint type = SOCK_STREAM);
-
+    
 public:
     
     /**
@@ -135,15 +268,67 @@ public:
     explicit Socket(ushort domain = AF_INET, uint type = SOCK_STREAM);
     
     /**
-     * Destruct a socket correctly
+     * Move a socket, leaving the original without a file descriptor
+     *
+     * \param other Socket to move from
+     */
+    Socket(Socket&& other) noexcept;
+    
+    /**
+     * Move a socket into this one, closing the file descriptor this socket held
+     *
+     * \param other Socket to move from
+     * \return Reference to this
+     */
+    Socket& operator=(Socket&& other) noexcept;
+    
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    
+    /**
+     * Destruct a socket correctly, closing its file descriptor
      */
     ~Socket();
     
+    /**
+     * Create a pair of connected Unix domain sockets, for talking to a thread or a child process
+     *
+     * \param type SOCK_STREAM, SOCK_SEQPACKET or SOCK_DGRAM
+     * \return Both ends of the connection
+     * \throws socket_error if the sockets can't be created
+     */
+    static std::pair<Socket, Socket> pair(uint type = SOCK_STREAM);
+    
+    /**
+     * Take ownership of an existing socket descriptor, such as one received with recv_fds. Its domain and type are
+     * looked up where the platform allows, and otherwise assumed to be AF_INET and SOCK_STREAM
+     *
+     * \param fd Open socket descriptor. Closed when the returned Socket is destroyed
+     * \return Socket owning the descriptor
+     */
+    static Socket adopt(ulong fd);
+    
+    /**
+     * Get the file descriptor this socket owns, for use with system calls or a Reactor
+     *
+     * \return Underlying file descriptor
+     */
+    ulong get_fd() const;
+    
+    /**
+     * Set whether operations on this socket block. Non-blocking operations that can't complete immediately fail
+     * with EAGAIN or EWOULDBLOCK instead of waiting
+     *
+     * \param blocking Whether operations should block
+     */
+    void set_blocking(bool blocking);
+    
     /**
      * Set a socket option, with option type and the new value
      *
      * \param option Option to set
      * \param val Value to set to
+     * \throws socket_error if the option is unsupported or can't be set
      */
     void setopt(SockOpt option, const void* val);
     
@@ -152,9 +337,32 @@ public:
      *
      * \param option Option to retrieve
      * \param val Pointer to store value in
+     * \throws socket_error if the option is unsupported or can't be read
      */
     void getopt(SockOpt option, void* val);
     
+    /**
+     * Set a typed socket option, such as `socket.set(SockOpt::NODELAY, 1)`
+     *
+     * \tparam T Type of the option value
+     * \param option Option to set
+     * \param value Value to set to
+     * \throws socket_error if the option is unsupported or can't be set
+     */
+    template<typename T>
+    void set(const TypedSockOpt<T>& option, const T& value);
+    
+    /**
+     * Get the value of a typed socket option
+     *
+     * \tparam T Type of the option value
+     * \param option Option to retrieve
+     * \return Current value of the option
+     * \throws socket_error if the option is unsupported or can't be read
+     */
+    template<typename T>
+    T get(const TypedSockOpt<T>& option);
+    
     /**
      * Bind this socket to a port
      *
@@ -162,6 +370,15 @@ public:
      */
     void bind(ushort port);
     
+    /**
+     * Bind this Unix domain socket to a filesystem path. The path must not already exist. A path starting with a null
+     * byte, such as one from abstract_name, is a Linux abstract name instead, which has no file and disappears once
+     * the last socket bound to it is closed
+     *
+     * \param path Path to bind to
+     */
+    void bind(const std::string& path);
+    
     /**
      * Connect to an IP address by string on a given port
      *
@@ -178,6 +395,14 @@ public:
      */
     void connect(IPAddr ip, ushort port);
     
+    /**
+     * Connect this Unix domain socket to a socket bound at a filesystem path, or at an abstract name if the path
+     * starts with a null byte
+     *
+     * \param path Path of the socket to connect to
+     */
+    void connect(const std::string& path);
+    
     /**
      * Set this socket up to listen for incoming connections, with parameter for
      * allowed number of unaccepted connections
@@ -195,24 +420,199 @@ public:
     Socket accept();
     
     /**
-     * Receive some number of bytes on this socket, defaults to just one byte. Returned
-     * array must be deleted by the user
+     * Accept every connection currently waiting on this listening socket, up to a maximum, without blocking. Uses
+     * accept4 where available so each connection is accepted non-blocking and close-on-exec in one call. Meant for
+     * non-blocking listeners driven by a Reactor, which only report a listener as readable again once more
+     * connections arrive
+     *
+     * \param out Vector to append accepted connections to
+     * \param max Maximum number of connections to accept
+     * \return Number of connections accepted
+     */
+    ulong accept_many(std::vector<Socket>& out, ulong max = ~(ulong)0);
+    
+    /**
+     * Receive some number of bytes on this socket, defaults to just one byte. Returned array must be deleted by the
+     * user. Makes a single receive, so fewer bytes than asked for may arrive, and doesn't say how many did.
+     * Deprecated, use recv_into or recv_exact with a reused buffer instead
      *
      * \param size Number of bytes to retrieve.
      * \return Array of retrieved bytes
      */
     const char* recv(uint size = 1);
     
+    /**
+     * Receive up to some number of bytes on this socket into an existing buffer
+     *
+     * \param buffer Buffer to receive into
+     * \param size Maximum number of bytes to receive
+     * \return Number of bytes received, or 0 if the peer closed the connection
+     */
+    uint recv(char* buffer, uint size);
+    
     /**
      * Send some number of bytes on this socket. Requires both the bytes array and
      * the length of the array, as there is no need for arrays to be null
-     * terminated. Does not delete the accepted array.
+     * terminated. Does not delete the accepted array. Partial sends are retried until
+     * every byte is sent, and a socket_error is thrown if the connection fails.
      *
      * \param bytes Bytes array to send
      * \param length Length of the array
      */
     void send(const char* bytes, uint length);
     
+    /**
+     * Make a single receive into an existing buffer, without throwing. Interrupted calls are retried
+     *
+     * \param buffer Buffer to receive into
+     * \param length Maximum number of bytes to receive
+     * \param flags Flags to pass to the system call, such as MSG_PEEK
+     * \return Bytes received and errno, no bytes and no error if the peer closed the connection
+     */
+    IOResult recv_into(char* buffer, ulong length, int flags = 0);
+    
+    /**
+     * Receive exactly some number of bytes, calling recv until the buffer is full, the peer closes the connection,
+     * or an error occurs. On a non-blocking socket, stops with EAGAIN once no more data is waiting
+     *
+     * \param buffer Buffer to receive into
+     * \param length Number of bytes to receive
+     * \return Bytes received and errno. Fewer bytes than asked for and no error means the peer closed
+     */
+    IOResult recv_exact(char* buffer, ulong length);
+    
+    /**
+     * Receive exactly some number of bytes, waiting for the socket to become readable whenever no data is waiting.
+     * Works on blocking and non-blocking sockets, and gives up with ETIMEDOUT once the timeout has passed in total
+     *
+     * \param buffer Buffer to receive into
+     * \param length Number of bytes to receive
+     * \param timeout Longest time to wait for all the bytes
+     * \return Bytes received and errno. Fewer bytes than asked for and no error means the peer closed
+     */
+    IOResult recv_exact(char* buffer, ulong length, std::chrono::milliseconds timeout);
+    
+    /**
+     * Make a single send of as much of a buffer as the socket will take, without throwing. Interrupted calls are
+     * retried, and a closed peer is reported as EPIPE rather than raising SIGPIPE
+     *
+     * \param bytes Bytes to send
+     * \param length Number of bytes to send
+     * \param flags Flags to pass to the system call, such as MSG_MORE
+     * \return Bytes sent and errno
+     */
+    IOResult send_some(const char* bytes, ulong length, int flags = 0);
+    
+    /**
+     * Send one datagram to an address, without throwing. Interrupted calls are retried
+     *
+     * \param bytes Bytes of the datagram
+     * \param length Number of bytes to send
+     * \param to Address to send to
+     * \param flags Flags to pass to the system call
+     * \return Bytes sent and errno
+     */
+    IOResult send_to(const char* bytes, ulong length, const Endpoint& to, int flags = 0);
+    
+    /**
+     * Receive one datagram and the address it came from, without throwing. Interrupted calls are retried. A
+     * datagram longer than the buffer is truncated, and the rest of it discarded
+     *
+     * \param buffer Buffer to receive into
+     * \param length Size of the buffer
+     * \param from Set to the address of the sender
+     * \param flags Flags to pass to the system call
+     * \return Bytes received and errno
+     */
+    IOResult recv_from(char* buffer, ulong length, Endpoint& from, int flags = 0);
+    
+    /**
+     * Send a whole buffer, calling send until every byte is sent or an error occurs, without throwing. On a
+     * non-blocking socket, stops with EAGAIN once the send buffer is full, and the count says where to resume
+     *
+     * \param bytes Bytes to send
+     * \param length Number of bytes to send
+     * \return Bytes sent and errno
+     */
+    IOResult send_all(const char* bytes, ulong length);
+    
+    /**
+     * Make a single vectored send, gathering several buffers into one system call as if they were contiguous.
+     * Interrupted calls are retried, and at most AT_IOV_BATCH buffers are sent per call
+     *
+     * \param buffers Buffers to send, in order
+     * \param count Number of buffers
+     * \param flags Flags to pass to the system call, such as AT_MSG_MORE
+     * \return Bytes sent across all buffers and errno
+     */
+    IOResult send_vectored(const ConstBuffer* buffers, ulong count, int flags = 0);
+    
+    /**
+     * Make a single vectored send from a list of buffers, such as `{{header, 8}, {payload, size}}`
+     *
+     * \param buffers Buffers to send, in order
+     * \param flags Flags to pass to the system call
+     * \return Bytes sent across all buffers and errno
+     */
+    IOResult send_vectored(std::initializer_list<ConstBuffer> buffers, int flags = 0);
+    
+    /**
+     * Send every byte of several buffers, making vectored sends until all are sent or an error occurs. On a
+     * non-blocking socket, stops with EAGAIN once the send buffer is full, and the count says where to resume
+     *
+     * \param buffers Buffers to send, in order
+     * \param count Number of buffers
+     * \param flags Flags to pass to every system call
+     * \return Bytes sent across all buffers and errno
+     */
+    IOResult send_all_vectored(const ConstBuffer* buffers, ulong count, int flags = 0);
+    
+    /**
+     * Make a single vectored receive, scattering the data across several buffers in order, filling each before
+     * moving to the next. Interrupted calls are retried, and at most AT_IOV_BATCH buffers are filled per call
+     *
+     * \param buffers Buffers to receive into
+     * \param count Number of buffers
+     * \param flags Flags to pass to the system call
+     * \return Bytes received across all buffers and errno, no bytes and no error if the peer closed
+     */
+    IOResult recv_vectored(const MutableBuffer* buffers, ulong count, int flags = 0);
+    
+    /**
+     * Send bytes along with copies of open descriptors over a Unix domain socket, using SCM_RIGHTS. The receiver gets
+     * new descriptors for the same open files, which stay valid after the sender closes its own. Interrupted calls
+     * are retried
+     *
+     * \param bytes Bytes to send with the descriptors. At least one byte is needed, and on a stream socket the
+     *              descriptors arrive with the first of them
+     * \param length Number of bytes to send
+     * \param fds Descriptors to pass
+     * \param count Number of descriptors, up to AT_MAX_FDS
+     * \return Bytes sent and errno
+     */
+    IOResult send_fds(const char* bytes, ulong length, const int* fds, ulong count);
+    
+    /**
+     * Receive bytes and any descriptors passed with them over a Unix domain socket. Received descriptors are set to
+     * close on exec, and are owned by the caller. Interrupted calls are retried
+     *
+     * \param buffer Buffer to receive into
+     * \param length Size of the buffer
+     * \param fds Received descriptors are appended to this
+     * \return Bytes received and errno, no bytes and no error if the peer closed the connection. EMSGSIZE if more
+     *         than AT_MAX_FDS descriptors were sent, in which case the extra ones were closed and the rest are still
+     *         appended
+     */
+    IOResult recv_fds(char* buffer, ulong length, std::vector<int>& fds);
+    
+    /**
+     * Set whether a TCP socket is corked. While corked, partial segments are held back so several sends go out
+     * together, until the socket is uncorked or a full segment is ready. Uses TCP_CORK, or TCP_NOPUSH on BSDs
+     *
+     * \param corked Whether to hold back partial segments
+     */
+    void set_cork(bool corked);
+    
     /**
      * Alias for shutdown with method 2
      */
@@ -232,4 +632,42 @@ public:
     
 };
 
+/**
+ * Build the Linux abstract Unix socket name for a string, to pass to bind or connect. Abstract names live outside
+ * the filesystem, so there is no file to clean up
+ *
+ * \param name Name of the socket
+ * \return Name with the leading null byte that marks it abstract
+ */
+std::string abstract_name(const std::string& name);
+
+/**
+ * Corks a TCP socket for as long as it exists, so a multi-part message built from several sends goes out in as few
+ * segments as possible once the guard is destroyed
+ */
+class CorkGuard {
+    
+    Socket& socket;
+    
+public:
+    
+    /**
+     * Cork a socket until this guard is destroyed
+     *
+     * \param socket Socket to cork
+     */
+    explicit CorkGuard(Socket& socket);
+    
+    /**
+     * Uncork the socket, sending anything held back
+     */
+    ~CorkGuard();
+    
+    CorkGuard(const CorkGuard&) = delete;
+    CorkGuard& operator=(const CorkGuard&) = delete;
+    
+};
+
 }
+
+#include "socket.tpp"
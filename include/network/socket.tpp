@@ -0,0 +1,20 @@
+
+namespace network {
+
+template<typename T>
+TypedSockOpt<T>::TypedSockOpt(const char* name, int level, int sock_name) noexcept :
+    SockOpt(name, level, sock_name, sizeof(T)) {}
+
+template<typename T>
+void Socket::set(const TypedSockOpt<T>& option, const T& value) {
+    setopt(option, &value);
+}
+
+template<typename T>
+T Socket::get(const TypedSockOpt<T>& option) {
+    T value {};
+    getopt(option, &value);
+    return value;
+}
+
+}
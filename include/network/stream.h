@@ -0,0 +1,102 @@
+#pragma once
+
+#include <istream>
+#include <streambuf>
+#include "types.h"
+#include "socket.h"
+
+/**
+ * \file stream.h
+ * \brief Standard streams over sockets
+ *
+ * Contains a stream buffer that reads and writes a connected socket, so anything written against std::istream or
+ * std::ostream, like the util::io readers and writers, works over the network unchanged. Reads fill a large buffer
+ * with as much as the socket has waiting, so many small reads cost one system call, and writes are gathered until the
+ * buffer fills or the stream is flushed. Reads and writes at least as large as the buffer skip it, going straight
+ * between the caller's memory and the socket.
+ */
+
+/**
+ * Default size of each of the read and write buffers of a SocketBuffer
+ */
+#define AT_STREAM_BUFFER (64 * 1024)
+
+namespace network {
+
+/**
+ * A std::streambuf over a connected, blocking stream socket, with separate read and write buffers. Written bytes are
+ * only sent once the write buffer fills, or the stream is flushed. The socket must outlive the buffer.
+ */
+class SocketBuffer : public std::streambuf {
+    
+    Socket& socket;
+    char* in_buffer;
+    ulong in_size;
+    char* out_buffer;
+    ulong out_size;
+    
+    /**
+     * Send everything in the write buffer
+     *
+     * \return Whether it was all sent
+     */
+    bool flush_out();
+    
+protected:
+    
+    int_type underflow() override;
+    
+    std::streamsize xsgetn(char* s, std::streamsize n) override;
+    
+    std::streamsize showmanyc() override;
+    
+    int_type overflow(int_type ch) override;
+    
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    
+    int sync() override;
+    
+public:
+    
+    /**
+     * Construct a new SocketBuffer over a socket
+     *
+     * \param socket Connected socket to read and write
+     * \param in_size Size of the read buffer. Reads this large or larger go straight to the caller
+     * \param out_size Size of the write buffer. Writes this large or larger are sent without copying
+     */
+    explicit SocketBuffer(Socket& socket, ulong in_size = AT_STREAM_BUFFER, ulong out_size = AT_STREAM_BUFFER);
+    
+    /**
+     * Deconstruct a SocketBuffer, sending anything still in the write buffer. Bytes read ahead and not consumed are
+     * discarded
+     */
+    ~SocketBuffer() override;
+    
+    SocketBuffer(const SocketBuffer&) = delete;
+    SocketBuffer& operator=(const SocketBuffer&) = delete;
+    
+};
+
+/**
+ * A std::iostream reading and writing a socket through its own SocketBuffer. A closed connection is the end of the
+ * stream, and a failed send sets badbit.
+ */
+class SocketStream : public std::iostream {
+    
+    SocketBuffer buffer;
+    
+public:
+    
+    /**
+     * Construct a new SocketStream over a socket
+     *
+     * \param socket Connected socket to read and write. Must outlive the stream
+     * \param in_size Size of the read buffer
+     * \param out_size Size of the write buffer
+     */
+    explicit SocketStream(Socket& socket, ulong in_size = AT_STREAM_BUFFER, ulong out_size = AT_STREAM_BUFFER);
+    
+};
+
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "socket.h"
+
+/**
+ * \file transfer.h
+ * \brief Zero-copy transfers between files, pipes and sockets
+ *
+ * Contains functions that move data to a socket without copying it through user memory. Files are sent with
+ * sendfile, and data is proxied between sockets by splicing it through a pipe. Where those calls aren't available,
+ * or sendfile or splice refuses the descriptors given, the same functions fall back to a read and write loop through
+ * user memory, so callers never need to check.
+ */
+
+/**
+ * Size of the stack buffer used when a transfer falls back to reading and writing
+ */
+#define AT_TRANSFER_CHUNK (64 * 1024)
+
+namespace network {
+
+/**
+ * A kernel pipe used as the in-flight buffer when splicing between descriptors. Data spliced in but not yet
+ * spliced out stays in the pipe between calls, so nothing is lost when the destination would block. On platforms
+ * without splice, or once splice refuses one of the descriptors, a user-space buffer of the same capacity stands in
+ * for the kernel pipe.
+ */
+class Pipe {
+    
+    int read_fd;
+    int write_fd;
+    ulong capacity;
+    ulong buffered;
+    
+    bool copying;
+    std::vector<char> fallback;
+    ulong fallback_start;
+    
+    friend IOResult splice(ulong from, ulong to, Pipe& pipe, ulong length);
+    
+    /**
+     * Move whatever is in the kernel pipe into the user-space buffer, and read and write through that from now on
+     *
+     * \return Whether everything in the kernel pipe was moved
+     */
+    bool start_copying();
+    
+    /**
+     * Pull bytes from a descriptor into the pipe
+     *
+     * \param from Descriptor to read from
+     * \param length Most bytes to pull, no more than the free space in the pipe
+     * \return Bytes pulled, 0 at the end of the source, or -1 on error
+     */
+    long fill(ulong from, ulong length);
+    
+    /**
+     * Push bytes from the pipe to a descriptor
+     *
+     * \param to Descriptor to write to
+     * \param length Most bytes to push, no more than are buffered
+     * \return Bytes pushed, or -1 on error
+     */
+    long drain(ulong to, ulong length);
+    
+public:
+    
+    /**
+     * Construct a new non-blocking Pipe, asking the kernel for a given capacity
+     *
+     * \param capacity Bytes the pipe should hold, or 0 for the system default
+     */
+    explicit Pipe(ulong capacity = 0);
+    
+    /**
+     * Deconstruct a Pipe, closing both ends and discarding anything still in it
+     */
+    ~Pipe();
+    
+    Pipe(const Pipe&) = delete;
+    Pipe& operator=(const Pipe&) = delete;
+    
+    /**
+     * Get how many bytes the pipe can hold
+     *
+     * \return Pipe capacity
+     */
+    ulong get_capacity() const;
+    
+    /**
+     * Get how many bytes have been spliced into the pipe but not yet out of it
+     *
+     * \return Bytes in flight
+     */
+    ulong get_buffered() const;
+    
+};
+
+/**
+ * Send a range of an open file to a socket, with sendfile where available. Loops until the whole range is sent or
+ * an error occurs. On a non-blocking socket, stops with EAGAIN once the send buffer is full, and the count says how
+ * far to advance the offset before resuming
+ *
+ * \param socket Socket to send to
+ * \param file_fd Descriptor of the file to send from. Its file position is not used or changed
+ * \param offset Byte offset in the file to start at
+ * \param length Number of bytes to send
+ * \return Bytes sent and errno. Fewer bytes than asked for and no error means the file ended early
+ */
+IOResult send_file(Socket& socket, int file_fd, ulong offset, ulong length);
+
+/**
+ * Send a whole file, or the rest of it from an offset, to a socket. Opens and closes the file
+ *
+ * \param socket Socket to send to
+ * \param path File to send
+ * \param offset Byte offset in the file to start at
+ * \return Bytes sent and errno
+ * \throws std::runtime_error if the file can't be opened
+ */
+IOResult send_file(Socket& socket, const std::string& path, ulong offset = 0);
+
+/**
+ * Move data from one descriptor to another through a pipe, without copying it to user memory. Either end may be a
+ * socket, file or pipe. Pulls no more from the source than is needed to deliver length bytes, counting what is
+ * already in the pipe, and keeps going until length bytes are delivered, the source ends, or neither side can make
+ * progress
+ *
+ * \param from Descriptor to read from
+ * \param to Descriptor to write to
+ * \param pipe Pipe holding data in flight between calls. Use one per direction of a connection
+ * \param length Most bytes to deliver to the destination
+ * \return Bytes delivered and errno. EAGAIN if either side would block. Fewer bytes than asked for and no error
+ *         means the source ended and the pipe is empty
+ */
+IOResult splice(ulong from, ulong to, Pipe& pipe, ulong length);
+
+/**
+ * Move data from one socket to another through a pipe, for proxying
+ *
+ * \param from Socket to read from
+ * \param to Socket to write to
+ * \param pipe Pipe holding data in flight between calls
+ * \param length Most bytes to deliver to the destination
+ * \return Bytes delivered and errno
+ */
+IOResult splice(Socket& from, Socket& to, Pipe& pipe, ulong length);
+
+}
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "types.h"
+#include "socket.h"
+#include "reactor.h"
+
+/**
+ * \file uring.h
+ * \brief Completion-based event loop using io_uring
+ *
+ * Contains an event loop backend built on io_uring. It talks to the kernel through the raw system calls, with no
+ * library needed. Operations are queued in the submission ring and sent to the kernel in one batch each time the
+ * loop waits, and their completions are delivered to callbacks. As well as readiness watches, it can accept,
+ * receive, send, read and write directly, including from buffers registered with the kernel once up front. The
+ * watch and timer interface is shared with Reactor, and make_event_loop picks io_uring when the kernel supports it,
+ * falling back to epoll when it doesn't.
+ */
+
+/**
+ * Default number of submission queue entries in a UringReactor
+ */
+#define AT_URING_ENTRIES 256
+
+struct io_uring_sqe;
+
+namespace network {
+
+/**
+ * Called when a completion-based operation finishes, with the bytes transferred and errno
+ */
+typedef std::function<void(IOResult result)> CompletionCallback;
+
+/**
+ * Called when an accept finishes, with the new connection and errno. The socket has no descriptor if the accept
+ * failed
+ */
+typedef std::function<void(Socket socket, int error)> AcceptCallback;
+
+/**
+ * \internal
+ *
+ * The memory-mapped submission and completion rings of a UringReactor
+ */
+struct __UringRings;
+
+/**
+ * \internal
+ *
+ * A descriptor watched by a UringReactor, and its callback
+ */
+struct __UringWatch {
+    ulong fd;
+    uint events;
+    IOCallback callback;
+    ulong op;
+};
+
+/**
+ * \internal
+ *
+ * An operation submitted to a UringReactor and not yet finished. Poll operations for a watch stay registered until
+ * cancelled, and are marked stale once their watch is removed or changed
+ */
+struct __UringOp {
+    uint kind;
+    bool stale;
+    __UringWatch* watch;
+    CompletionCallback on_complete;
+    AcceptCallback on_accept;
+    ushort domain;
+    uint type;
+};
+
+/**
+ * Which backend make_event_loop should create
+ */
+enum class LoopBackend {
+    AUTO, EPOLL, IO_URING
+};
+
+/**
+ * The io_uring event loop backend. Readiness watches use multishot polls, so like Reactor a callback is made each
+ * time a descriptor becomes ready rather than while it stays ready. Completion-based operations start the transfer
+ * in the kernel and call back once it's done. Their buffers must stay valid until then. Everything queued is
+ * submitted with a single system call per run_once, which also waits for completions. Needs Linux 5.13 or later,
+ * see supported.
+ */
+class UringReactor : public EventLoop {
+    
+    int ring_fd;
+    int wake_fd;
+    ulong wake_value;
+    __UringRings* rings;
+    uint queued;
+    
+    std::unordered_map<ulong, __UringOp*> ops;
+    ulong next_op;
+    std::unordered_map<ulong, __UringWatch*> watches;
+    std::vector<__UringWatch*> retired;
+    
+    char* buffers;
+    ulong buffer_count;
+    ulong buffer_size;
+    
+    /**
+     * Get the next free submission queue entry, submitting what is queued first if the ring is full
+     *
+     * \param op Operation the entry is for, whose id becomes its user data
+     * \return Cleared submission queue entry
+     */
+    io_uring_sqe* next_sqe(ulong op);
+    
+    /**
+     * Register an operation, giving it an id
+     *
+     * \param op New operation. Owned by this reactor from now on
+     * \return Id of the operation
+     */
+    ulong track(__UringOp* op);
+    
+    /**
+     * Queue a multishot poll for a watch
+     *
+     * \param watch Watch to poll for
+     */
+    void arm_poll(__UringWatch* watch);
+    
+    /**
+     * Cancel a watch's current poll, marking it stale
+     *
+     * \param watch Watch to cancel the poll of
+     */
+    void cancel_poll(__UringWatch* watch);
+    
+    /**
+     * Queue a read of the wake descriptor, so stop can interrupt a wait
+     */
+    void arm_wake();
+    
+    /**
+     * Submit every queued entry, optionally waiting for a completion
+     *
+     * \param wait Milliseconds to wait for a completion, 0 to not wait, or -1 to wait indefinitely
+     */
+    void submit(int wait);
+    
+    /**
+     * Handle one completion
+     *
+     * \param id User data of the completion
+     * \param res Result of the operation
+     * \param flags Completion flags
+     * \return Whether a callback was run
+     */
+    bool complete(ulong id, int res, uint flags);
+    
+protected:
+    
+    void wake() override;
+    
+public:
+    
+    /**
+     * Construct a new UringReactor, with nothing to watch
+     *
+     * \param entries Size of the submission queue. Rounded up to a power of two by the kernel
+     * \throws socket_error if io_uring isn't supported
+     */
+    explicit UringReactor(uint entries = AT_URING_ENTRIES);
+    
+    /**
+     * Deconstruct a UringReactor. Operations still in flight are cancelled without their callbacks, and watched
+     * descriptors are not closed
+     */
+    ~UringReactor() override;
+    
+    /**
+     * Check whether the running kernel supports everything this backend needs. The result is cached after the
+     * first call
+     *
+     * \return Whether a UringReactor can be constructed
+     */
+    static bool supported();
+    
+    using EventLoop::add;
+    
+    void add(ulong fd, uint events, IOCallback callback) override;
+    
+    void modify(ulong fd, uint events) override;
+    
+    bool remove(ulong fd) override;
+    
+    ulong run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1)) override;
+    
+    ulong get_watched() const override;
+    
+    /**
+     * Accept one connection on a listening socket
+     *
+     * \param listener Listening socket. Must outlive the operation
+     * \param callback Function to call with the accepted connection
+     */
+    void accept(Socket& listener, AcceptCallback callback);
+    
+    /**
+     * Receive up to some number of bytes on a socket
+     *
+     * \param socket Socket to receive on
+     * \param buffer Buffer to receive into. Must stay valid until the callback
+     * \param length Most bytes to receive
+     * \param callback Function to call with the result. No bytes and no error means the peer closed
+     */
+    void recv(Socket& socket, char* buffer, ulong length, CompletionCallback callback);
+    
+    /**
+     * Send some bytes on a socket. Like a single send call, may send only part of the buffer
+     *
+     * \param socket Socket to send on
+     * \param bytes Bytes to send. Must stay valid until the callback
+     * \param length Number of bytes to send
+     * \param callback Function to call with the result
+     */
+    void send(Socket& socket, const char* bytes, ulong length, CompletionCallback callback);
+    
+    /**
+     * Read from a descriptor at an offset
+     *
+     * \param fd Descriptor to read
+     * \param buffer Buffer to read into. Must stay valid until the callback
+     * \param length Most bytes to read
+     * \param offset Offset in the file, or ~0 to use and advance the file position
+     * \param callback Function to call with the result
+     */
+    void read(ulong fd, char* buffer, ulong length, ulong offset, CompletionCallback callback);
+    
+    /**
+     * Write to a descriptor at an offset
+     *
+     * \param fd Descriptor to write
+     * \param bytes Bytes to write. Must stay valid until the callback
+     * \param length Number of bytes to write
+     * \param offset Offset in the file, or ~0 to use and advance the file position
+     * \param callback Function to call with the result
+     */
+    void write(ulong fd, const char* bytes, ulong length, ulong offset, CompletionCallback callback);
+    
+    /**
+     * Allocate a set of equally sized buffers and register them with the kernel, so fixed reads and writes skip
+     * mapping the memory on every operation. Replaces any buffers registered before
+     *
+     * \param count Number of buffers
+     * \param size Size of each buffer
+     */
+    void register_buffers(ulong count, ulong size);
+    
+    /**
+     * Get one of the registered buffers
+     *
+     * \param index Index of the buffer
+     * \return Start of the buffer
+     */
+    char* get_buffer(ulong index) const;
+    
+    /**
+     * Get the size of each registered buffer
+     *
+     * \return Buffer size, or 0 if none are registered
+     */
+    ulong get_buffer_size() const;
+    
+    /**
+     * Read from a descriptor into a registered buffer
+     *
+     * \param fd Descriptor to read. Sockets and pipes ignore the offset
+     * \param index Index of the buffer to read into
+     * \param length Most bytes to read, up to the buffer size
+     * \param offset Offset in the file, or ~0 to use and advance the file position
+     * \param callback Function to call with the result
+     */
+    void read_fixed(ulong fd, ulong index, ulong length, ulong offset, CompletionCallback callback);
+    
+    /**
+     * Write to a descriptor from a registered buffer
+     *
+     * \param fd Descriptor to write. Sockets and pipes ignore the offset
+     * \param index Index of the buffer to write from
+     * \param length Number of bytes to write, up to the buffer size
+     * \param offset Offset in the file, or ~0 to use and advance the file position
+     * \param callback Function to call with the result
+     */
+    void write_fixed(ulong fd, ulong index, ulong length, ulong offset, CompletionCallback callback);
+    
+    /**
+     * Get the number of operations submitted or queued and not yet finished, not counting watches
+     *
+     * \return Operations in flight
+     */
+    ulong get_pending() const;
+    
+};
+
+/**
+ * Create an event loop with the requested backend. AUTO picks io_uring if the kernel supports it and epoll
+ * otherwise, and IO_URING also falls back to epoll if it isn't supported. Returned loop must be deleted by the user
+ *
+ * \param backend Backend to use
+ * \return New event loop
+ */
+EventLoop* make_event_loop(LoopBackend backend = LoopBackend::AUTO);
+
+}
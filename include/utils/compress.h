@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include "types.h"
+
+/**
+ * \file compress.h
+ * \brief Fast byte-oriented LZ77 compression
+ *
+ * A small LZ77 compressor in the style of LZ4, tuned for speed over ratio. Well suited to batches of log lines or
+ * other repetitive text, where it typically removes half or more of the bytes at memory-copy speeds. The compressed
+ * form doesn't record its uncompressed length, so callers must store it alongside.
+ */
+
+namespace util {
+
+/**
+ * Compress a block of bytes, appending the compressed form to a string
+ *
+ * \param data Bytes to compress
+ * \param length Number of bytes
+ * \param out String to append the compressed bytes to
+ */
+void compress(const char* data, ulong length, std::string& out);
+
+/**
+ * Decompress a block produced by compress, appending the original bytes to a string. Throws a std::runtime_error
+ * if the block is malformed or doesn't decompress to exactly the expected length
+ *
+ * \param data Compressed bytes
+ * \param length Number of compressed bytes
+ * \param out String to append the decompressed bytes to
+ * \param original Length of the uncompressed block
+ */
+void decompress(const char* data, ulong length, std::string& out, ulong original);
+
+}
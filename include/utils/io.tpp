@@ -103,9 +103,21 @@ std::string next_string(std::istream& file, const ulong length) {
 
 template<Endian E>
 void write_ulong(std::ostream& file, const ulong out, const ulong length) {
-    const uchar* to_write = ltob<E>(out, length);
+    if (length > sizeof(ulong)) {
+        const uchar* to_write = ltob<E>(out, length);
+        file.write((char*)to_write, length);
+        delete[] to_write;
+        return;
+    }
+    uchar to_write[sizeof(ulong)];
+    for (ulong i = 0; i < length; ++i) {
+        if constexpr (E == Endian::BIG) {
+            to_write[i] = (uchar)(out >> (8 * (length - i - 1)));
+        } else {
+            to_write[i] = (uchar)(out >> (8 * i));
+        }
+    }
     file.write((char*)to_write, length);
-    delete[] to_write;
 }
 
 template<Endian E>
@@ -125,9 +137,13 @@ void write_uchar(std::ostream& file, const uchar out, const ulong length) {
 
 template<Endian E>
 void write_long(std::ostream& file, const slong out, const ulong length) {
-    const char* to_write = ltob<E>(out, length);
-    file.write(to_write, length);
-    delete[] to_write;
+    if (length > sizeof(slong)) {
+        const char* to_write = ltob<E>(out, length);
+        file.write(to_write, length);
+        delete[] to_write;
+        return;
+    }
+    write_ulong<E>(file, (ulong)out, length);
 }
 
 template<Endian E>
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "types.h"
+
+/**
+ * \file rcu.h
+ * \brief Read-copy-update memory reclamation
+ *
+ * Lets data be read without locks while writers replace it with new copies. Readers mark the span they use shared
+ * data in with an RcuReadGuard. Writers publish a new copy with an atomic store, then retire the old copy, which is
+ * freed only once every reader that could have seen it has left its guard.
+ *
+ * Entering and leaving a guard is a thread-local counter and one atomic store each way. Guards may be nested.
+ */
+
+namespace util {
+
+/**
+ * Marks the calling thread as reading RCU protected data for as long as it exists. Any object retired while a guard
+ * is held won't be freed until the guard is released.
+ */
+class RcuReadGuard {
+public:
+    
+    /**
+     * Enter a read-side critical section
+     */
+    RcuReadGuard() noexcept;
+    
+    /**
+     * Leave a read-side critical section
+     */
+    ~RcuReadGuard();
+    
+    RcuReadGuard(const RcuReadGuard&) = delete;
+    RcuReadGuard& operator=(const RcuReadGuard&) = delete;
+    
+};
+
+/**
+ * Retire an object that has been unpublished, freeing it with the given deleter once no reader can still hold it.
+ * Frees any earlier retired objects that have become safe as well
+ *
+ * \param pointer Object to retire
+ * \param deleter Function that frees the object
+ */
+void rcu_retire(void* pointer, void (*deleter)(void*));
+
+/**
+ * Retire an object that has been unpublished, deleting it once no reader can still hold it
+ *
+ * \tparam T Type of the object
+ * \param pointer Object to retire
+ */
+template<typename T>
+void rcu_retire(const T* pointer);
+
+/**
+ * Wait until every reader that was in a critical section when this was called has left it, then free every retired
+ * object that has become safe. Readers on the calling thread are skipped, so calling this inside a guard can't
+ * deadlock, though objects that guard could see stay retired until later
+ */
+void rcu_synchronize();
+
+/**
+ * Get the number of retired objects not yet freed
+ *
+ * \return Number of objects waiting to be freed
+ */
+ulong rcu_pending();
+
+}
+
+#include "rcu.tpp"
@@ -0,0 +1,11 @@
+
+namespace util {
+
+template<typename T>
+void rcu_retire(const T* pointer) {
+    rcu_retire(const_cast<T*>(pointer), [](void* object) {
+        delete static_cast<T*>(object);
+    });
+}
+
+}
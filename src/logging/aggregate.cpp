@@ -0,0 +1,233 @@
+
+#include <algorithm>
+#include <functional>
+#include "logging/aggregate.h"
+
+namespace logging {
+
+static const std::string aggregate_name = "aggregate";
+
+AggregatingHandler::AggregatingHandler(Handler* inner, std::chrono::milliseconds window, ulong top_count) {
+    this->inner = inner;
+    this->window = window;
+    this->last_sweep = std::chrono::steady_clock::now();
+    this->top_count = top_count;
+    this->counter_limit = top_count * 4 < 16 ? 16 : top_count * 4;
+    this->suppressed_total = 0;
+    counters.reserve(counter_limit);
+    heap.reserve(counter_limit);
+}
+
+AggregatingHandler::~AggregatingHandler() {
+    flush();
+}
+
+ulong AggregatingHandler::key(const Record& record) {
+    ulong hash = (ulong)std::hash<std::string>()(*record.message);
+    hash ^= (ulong)std::hash<std::string>()(*record.name) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+    hash ^= (ulong)std::hash<const void*>()(record.level) + 0x9E3779B97F4A7C15 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+std::unordered_multimap<ulong, __AggregateEntry>::iterator AggregatingHandler::find_entry(ulong hash,
+                                                                                          const Record& record) {
+    auto range = entries.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const __AggregateEntry& entry = it->second;
+        if (entry.level == record.level && entry.name == *record.name && entry.message == *record.message) {
+            return it;
+        }
+    }
+    return entries.end();
+}
+
+void AggregatingHandler::sift_down(__TopCounter* counter) {
+    ulong position = counter->position;
+    while (true) {
+        ulong smallest = position;
+        ulong left = position * 2 + 1;
+        if (left < heap.size() && heap[left]->count < heap[smallest]->count) {
+            smallest = left;
+        }
+        if (left + 1 < heap.size() && heap[left + 1]->count < heap[smallest]->count) {
+            smallest = left + 1;
+        }
+        if (smallest == position) {
+            break;
+        }
+        heap[position] = heap[smallest];
+        heap[position]->position = position;
+        heap[smallest] = counter;
+        position = smallest;
+    }
+    counter->position = position;
+}
+
+void AggregatingHandler::sift_up(__TopCounter* counter) {
+    ulong position = counter->position;
+    while (position > 0 && heap[(position - 1) / 2]->count > counter->count) {
+        heap[position] = heap[(position - 1) / 2];
+        heap[position]->position = position;
+        position = (position - 1) / 2;
+    }
+    heap[position] = counter;
+    counter->position = position;
+}
+
+void AggregatingHandler::count(ulong hash, const Record& record) {
+    auto range = counter_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        __TopCounter* counter = it->second;
+        if (counter->level == record.level && counter->message == *record.message && counter->name == *record.name) {
+            counter->count++;
+            sift_down(counter);
+            return;
+        }
+    }
+    
+    if (counters.size() < counter_limit) {
+        counters.push_back(__TopCounter {record.level, *record.name, *record.message, 1, 0, hash, heap.size()});
+        __TopCounter* counter = &counters.back();
+        heap.push_back(counter);
+        sift_up(counter);
+        counter_index.emplace(hash, counter);
+        return;
+    }
+    
+    __TopCounter* smallest = heap[0];
+    range = counter_index.equal_range(smallest->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == smallest) {
+            counter_index.erase(it);
+            break;
+        }
+    }
+    smallest->level = record.level;
+    smallest->name = *record.name;
+    smallest->message = *record.message;
+    smallest->error = smallest->count;
+    smallest->count++;
+    smallest->hash = hash;
+    counter_index.emplace(hash, smallest);
+    sift_down(smallest);
+}
+
+void AggregatingHandler::summarize(const __AggregateEntry& entry, std::vector<__AggregateEntry>& out) {
+    if (entry.suppressed == 0) {
+        return;
+    }
+    out.push_back(entry);
+    out.back().text += " (repeated " + std::to_string(entry.suppressed) + " more times)";
+}
+
+void AggregatingHandler::sweep(std::chrono::steady_clock::time_point now, bool all,
+                               std::vector<__AggregateEntry>& out) {
+    last_sweep = now;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (all || now - it->second.start >= window) {
+            summarize(it->second, out);
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void AggregatingHandler::emit(const std::vector<__AggregateEntry>& summaries) {
+    for (const auto& summary : summaries) {
+        Record record = {summary.level, &summary.name, &summary.text, &summary.text, SourceLocation()};
+        if (inner->accepts(record)) {
+            inner->handle(record);
+        }
+    }
+}
+
+void AggregatingHandler::flush() {
+    std::vector<__AggregateEntry> summaries;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        sweep(std::chrono::steady_clock::now(), true, summaries);
+    }
+    emit(summaries);
+}
+
+std::vector<MessageCount> AggregatingHandler::get_top() {
+    std::vector<MessageCount> top;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (const auto& counter : counters) {
+            top.push_back(MessageCount {counter.name, counter.level, counter.message, counter.count});
+        }
+    }
+    std::sort(top.begin(), top.end(), [](const MessageCount& a, const MessageCount& b) {
+        return a.count > b.count;
+    });
+    if (top.size() > top_count) {
+        top.resize(top_count);
+    }
+    return top;
+}
+
+ulong AggregatingHandler::get_suppressed() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return suppressed_total;
+}
+
+bool AggregatingHandler::accepts(const Record& record) {
+    if (*record.level < *this->level || !inner->accepts(record)) {
+        return false;
+    }
+    
+    ulong hash = key(record);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<__AggregateEntry> summaries;
+    bool first;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (now - last_sweep >= window) {
+            sweep(now, false, summaries);
+        }
+        count(hash, record);
+        
+        auto found = find_entry(hash, record);
+        first = found == entries.end() || now - found->second.start >= window;
+        if (!first) {
+            found->second.suppressed++;
+            suppressed_total++;
+        } else if (found != entries.end()) {
+            summarize(found->second, summaries);
+            found->second.start = now;
+            found->second.suppressed = 0;
+        } else {
+            entries.emplace(hash, __AggregateEntry {record.level, *record.name, *record.message, *record.message, now,
+                                                    0});
+        }
+    }
+    
+    emit(summaries);
+    return first;
+}
+
+bool AggregatingHandler::needs_text() const {
+    return inner->needs_text();
+}
+
+void AggregatingHandler::handle(const Record& record) {
+    if (record.text != nullptr) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto found = find_entry(key(record), record);
+        if (found != entries.end()) {
+            found->second.text = *record.text;
+        }
+    }
+    inner->handle(record);
+}
+
+void AggregatingHandler::log(const std::string& message, const Level* level) {
+    Record record = {level, &aggregate_name, &message, &message, SourceLocation()};
+    if (accepts(record)) {
+        handle(record);
+    }
+}
+
+}
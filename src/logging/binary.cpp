@@ -0,0 +1,232 @@
+
+#include <mutex>
+#include <ctime>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include "logging/binary.h"
+#include "logging/logging.h"
+
+namespace logging {
+
+static const char binary_magic[] = {'A', 'T', 'B', 'L'};
+static const uchar binary_version = 1;
+
+static std::mutex binary_mutex;
+static std::vector<BinaryFormat> binary_formats;
+static std::ostream* binary_out = nullptr;
+static ulong formats_written = 0;
+
+__BinaryBuffer::__BinaryBuffer() {
+    data.reserve(AT_BINARY_FLUSH_SIZE * 2);
+}
+
+__BinaryBuffer::int_type __BinaryBuffer::overflow(int_type ch) {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        data.push_back(traits_type::to_char_type(ch));
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize __BinaryBuffer::xsputn(const char* s, std::streamsize n) {
+    data.insert(data.end(), s, s + n);
+    return n;
+}
+
+ulong __BinaryBuffer::size() const {
+    return data.size();
+}
+
+const char* __BinaryBuffer::bytes() const {
+    return data.data();
+}
+
+void __BinaryBuffer::reset() {
+    data.clear();
+}
+
+/**
+ * \internal
+ *
+ * Write any formats registered since the last flush to the binary output. Must be called with the binary mutex held
+ */
+static void __write_new_formats() {
+    for (; formats_written < binary_formats.size(); ++formats_written) {
+        const BinaryFormat& format = binary_formats[formats_written];
+        util::write_uchar<Endian::LITTLE>(*binary_out, (uchar)BinaryTag::FORMAT);
+        util::write_uint<Endian::LITTLE>(*binary_out, (uint)formats_written);
+        for (const std::string* str : {&format.level, &format.logger, &format.format}) {
+            util::write_uint<Endian::LITTLE>(*binary_out, (uint)str->size());
+            binary_out->write(str->data(), str->size());
+        }
+    }
+}
+
+/**
+ * \internal
+ *
+ * Write a staging buffer to the binary output, preceded by any formats registered since the last flush
+ *
+ * \param buffer Buffer to flush
+ */
+static void __flush_buffer(__BinaryBuffer& buffer) {
+    if (buffer.size() == 0) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> guard(binary_mutex);
+    if (binary_out != nullptr) {
+        __write_new_formats();
+        binary_out->write(buffer.bytes(), buffer.size());
+    }
+    buffer.reset();
+}
+
+__BinaryThreadBuffer::__BinaryThreadBuffer() : buffer(), stream(&buffer) {}
+
+__BinaryThreadBuffer::~__BinaryThreadBuffer() {
+    __flush_buffer(buffer);
+}
+
+__BinaryThreadBuffer& __binary_thread_buffer() {
+    static thread_local __BinaryThreadBuffer local;
+    return local;
+}
+
+BinarySite register_format(const Level* level, const std::string& logger, const std::string& format) {
+    Logger* log = get_logger(logger);
+    
+    std::lock_guard<std::mutex> guard(binary_mutex);
+    BinarySite site = {(uint)binary_formats.size(), level, log};
+    binary_formats.push_back(BinaryFormat {(std::string)*level, logger, format});
+    return site;
+}
+
+std::vector<BinaryFormat> get_binary_formats() {
+    std::lock_guard<std::mutex> guard(binary_mutex);
+    return binary_formats;
+}
+
+void set_binary_output(std::ostream* out) {
+    std::lock_guard<std::mutex> guard(binary_mutex);
+    binary_out = out;
+    formats_written = 0;
+    if (binary_out != nullptr) {
+        binary_out->write(binary_magic, sizeof(binary_magic));
+        util::write_uchar<Endian::LITTLE>(*binary_out, binary_version);
+    }
+}
+
+void flush_binary() {
+    __flush_buffer(__binary_thread_buffer().buffer);
+}
+
+/**
+ * \internal
+ *
+ * Render a nanosecond timestamp as a UTC date and time string
+ *
+ * \param timestamp Nanoseconds since the epoch
+ * \return Rendered timestamp
+ */
+static std::string __render_timestamp(ulong timestamp) {
+    std::time_t seconds = (std::time_t)(timestamp / 1000000000);
+    std::tm parts {};
+#ifdef _WIN32
+    gmtime_s(&parts, &seconds);
+#else
+    gmtime_r(&seconds, &parts);
+#endif
+    std::stringstream out;
+    out << std::put_time(&parts, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(9) << std::setfill('0')
+        << timestamp % 1000000000;
+    return out.str();
+}
+
+ulong decode_binary(std::istream& in, std::ostream& out) {
+    char magic[sizeof(binary_magic)];
+    in.read(magic, sizeof(magic));
+    if (!in || std::memcmp(magic, binary_magic, sizeof(magic)) != 0) {
+        throw std::runtime_error("Stream is not a binary log");
+    }
+    if (util::next_uchar<Endian::LITTLE>(in) != binary_version) {
+        throw std::runtime_error("Unsupported binary log version");
+    }
+    
+    std::vector<BinaryFormat> formats;
+    std::vector<std::string> args;
+    ulong decoded = 0;
+    
+    while (in.peek() != std::istream::traits_type::eof()) {
+        BinaryTag tag = (BinaryTag)util::next_uchar<Endian::LITTLE>(in);
+        uint id = util::next_uint<Endian::LITTLE>(in);
+        
+        if (tag == BinaryTag::FORMAT) {
+            BinaryFormat format;
+            for (std::string* str : {&format.level, &format.logger, &format.format}) {
+                str->resize(util::next_uint<Endian::LITTLE>(in));
+                in.read(&(*str)[0], str->size());
+            }
+            if (formats.size() <= id) {
+                formats.resize(id + 1);
+            }
+            formats[id] = format;
+            continue;
+        } else if (tag != BinaryTag::MESSAGE) {
+            throw std::runtime_error("Unrecognized binary log entry");
+        }
+        
+        ulong timestamp = util::next_ulong<Endian::LITTLE>(in);
+        uchar argc = util::next_uchar<Endian::LITTLE>(in);
+        args.clear();
+        for (uchar i = 0; i < argc; ++i) {
+            std::stringstream arg;
+            switch ((BinaryArg)util::next_uchar<Endian::LITTLE>(in)) {
+                case BinaryArg::INT:
+                    arg << util::next_long<Endian::LITTLE>(in);
+                    break;
+                case BinaryArg::UINT:
+                    arg << util::next_ulong<Endian::LITTLE>(in);
+                    break;
+                case BinaryArg::DOUBLE:
+                    arg << util::next_double<Endian::LITTLE>(in);
+                    break;
+                case BinaryArg::STRING: {
+                    std::string str(util::next_uint<Endian::LITTLE>(in), '\0');
+                    in.read(&str[0], str.size());
+                    arg << str;
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Unrecognized binary log argument type");
+            }
+            args.push_back(arg.str());
+        }
+        if (!in) {
+            throw std::runtime_error("Binary log ended mid-record");
+        }
+        if (id >= formats.size()) {
+            throw std::runtime_error("Binary log message references an unknown format");
+        }
+        
+        const BinaryFormat& format = formats[id];
+        out << __render_timestamp(timestamp) << ' ' << format.level << ' ' << format.logger << ": ";
+        ulong next_arg = 0;
+        for (ulong i = 0; i < format.format.size(); ++i) {
+            if (format.format[i] == '{' && i + 1 < format.format.size() && format.format[i + 1] == '}' &&
+                next_arg < args.size()) {
+                out << args[next_arg++];
+                ++i;
+            } else {
+                out << format.format[i];
+            }
+        }
+        out << '\n';
+        ++decoded;
+    }
+    
+    return decoded;
+}
+
+}
@@ -0,0 +1,108 @@
+
+#include <ctime>
+#include <chrono>
+#include <atomic>
+#include <charconv>
+#include "logging/clock.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace logging {
+
+static const std::chrono::steady_clock::time_point load_time = std::chrono::steady_clock::now();
+
+static const ulong powers_of_ten[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/**
+ * \internal
+ *
+ * The formatted date and time of the last second a thread rendered
+ */
+struct __TimestampCache {
+    slong second = -1;
+    char prefix[32];
+    ulong length = 0;
+};
+
+/**
+ * \internal
+ *
+ * Append a decimal point and the leading digits of a count of nanoseconds
+ *
+ * \param out String to append to
+ * \param nanos Nanoseconds within a second
+ * \param precision Number of digits to append
+ */
+static void __append_fraction(std::string& out, ulong nanos, uint precision) {
+    if (precision == 0) {
+        return;
+    }
+    if (precision > 9) {
+        precision = 9;
+    }
+    char digits[10];
+    digits[0] = '.';
+    ulong value = nanos / powers_of_ten[9 - precision];
+    for (uint i = precision; i > 0; --i) {
+        digits[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    out.append(digits, precision + 1);
+}
+
+ulong wall_time() {
+    return (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+ulong elapsed_time() {
+    return (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - load_time
+    ).count();
+}
+
+ulong thread_id() {
+    static thread_local ulong id = 0;
+    if (id == 0) {
+#ifdef __linux__
+        id = (ulong)::syscall(SYS_gettid);
+#else
+        static std::atomic<ulong> next_id {1};
+        id = next_id.fetch_add(1);
+#endif
+    }
+    return id;
+}
+
+void render_timestamp(std::string& out, ulong timestamp, uint precision) {
+    static thread_local __TimestampCache cache;
+    slong second = (slong)(timestamp / 1000000000);
+    if (second != cache.second) {
+        std::time_t seconds = (std::time_t)second;
+        std::tm parts {};
+#ifdef _WIN32
+        gmtime_s(&parts, &seconds);
+#else
+        gmtime_r(&seconds, &parts);
+#endif
+        cache.length = std::strftime(cache.prefix, sizeof(cache.prefix), "%Y-%m-%d %H:%M:%S", &parts);
+        cache.second = second;
+    }
+    out.append(cache.prefix, cache.length);
+    __append_fraction(out, timestamp % 1000000000, precision);
+}
+
+void render_duration(std::string& out, ulong nanos, uint precision) {
+    char buffer[24];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), nanos / 1000000000);
+    out.append(buffer, result.ptr - buffer);
+    __append_fraction(out, nanos % 1000000000, precision);
+}
+
+}
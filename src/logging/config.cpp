@@ -0,0 +1,218 @@
+
+#include <csignal>
+#include <fstream>
+#include <vector>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "logging/config.h"
+#include "logging/logging.h"
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * A single parsed configuration line, waiting to be applied
+ */
+struct __ConfigSetting {
+    std::string logger;
+    std::string key;
+    std::string value;
+    Level* level;
+};
+
+/**
+ * \internal
+ *
+ * Count of reload signals received by the process, across every signal registered with a ConfigWatcher
+ */
+static std::atomic<ulong> reload_signals {0};
+
+/**
+ * \internal
+ *
+ * Signal handler that requests every watcher reload. Only touches a lock-free atomic, so is async-signal-safe
+ *
+ * \param signum Signal received
+ */
+static void __reload_signal_handler(int) {
+    reload_signals.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * \internal
+ *
+ * Strip leading and trailing whitespace from a string
+ *
+ * \param text String to trim
+ * \return Trimmed string
+ */
+static std::string __trim(const std::string& text) {
+    const char* space = " \t\r\n";
+    ulong start = text.find_first_not_of(space);
+    if (start == std::string::npos) {
+        return "";
+    }
+    return text.substr(start, text.find_last_not_of(space) - start + 1);
+}
+
+/**
+ * \internal
+ *
+ * Parse one non-empty configuration line
+ *
+ * \param line Line to parse, without comments
+ * \param number Line number, for error messages
+ * \return Parsed setting
+ */
+static __ConfigSetting __parse_line(const std::string& line, ulong number) {
+    std::string where = "Logging config line " + std::to_string(number) + ": ";
+    ulong equals = line.find('=');
+    if (equals == std::string::npos) {
+        throw std::runtime_error(where + "expected '<logger>.<setting> = <value>'");
+    }
+    std::string target = __trim(line.substr(0, equals));
+    ulong dot = target.find_last_of('.');
+    if (dot == std::string::npos || dot == 0) {
+        throw std::runtime_error(where + "expected a logger name before the setting");
+    }
+    
+    __ConfigSetting setting = {target.substr(0, dot), target.substr(dot + 1), __trim(line.substr(equals + 1)),
+                               nullptr};
+    if (setting.value.size() >= 2 && setting.value.front() == '"' && setting.value.back() == '"') {
+        setting.value = setting.value.substr(1, setting.value.size() - 2);
+    }
+    
+    if (setting.key == "level") {
+        setting.level = setting.value == "NONE" ? NO_LEVEL : find_level(setting.value);
+        if (setting.level == nullptr) {
+            throw std::runtime_error(where + "unknown level " + setting.value);
+        }
+        if (setting.level == NO_LEVEL && setting.logger == "root") {
+            throw std::runtime_error(where + "root logger must have a level");
+        }
+    } else if (setting.key == "propagate") {
+        if (setting.value != "true" && setting.value != "false") {
+            throw std::runtime_error(where + "propagate must be true or false");
+        }
+    } else if (setting.key != "pattern") {
+        throw std::runtime_error(where + "unknown setting " + setting.key);
+    }
+    return setting;
+}
+
+ulong apply_config(std::istream& input) {
+    __ensure_loggers();
+    std::vector<__ConfigSetting> settings;
+    std::string line;
+    for (ulong number = 1; std::getline(input, line); ++number) {
+        line = __trim(line.substr(0, line.find('#')));
+        if (!line.empty()) {
+            settings.push_back(__parse_line(line, number));
+        }
+    }
+    
+    for (auto& setting : settings) {
+        Logger* logger = get_logger(setting.logger);
+        if (setting.key == "level") {
+            logger->set_level(setting.level);
+        } else if (setting.key == "pattern") {
+            logger->set_pattern(setting.value);
+        } else {
+            logger->set_propagation(setting.value == "true");
+        }
+    }
+    return settings.size();
+}
+
+ulong load_config(const std::string& filename) {
+    std::ifstream input(filename);
+    if (!input) {
+        throw std::runtime_error("Failed to open logging config " + filename);
+    }
+    return apply_config(input);
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& filename, std::chrono::milliseconds interval) {
+    this->filename = filename;
+    this->interval = interval;
+    this->modified = -1;
+    this->size = -1;
+    this->seen_modified = -1;
+    this->seen_size = -1;
+    this->signals_seen = reload_signals.load();
+    this->reloads = 0;
+    this->stopping = false;
+    changed();
+    modified = seen_modified;
+    size = seen_size;
+    load_config(filename);
+    reloads++;
+    watcher = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    watcher.join();
+}
+
+bool ConfigWatcher::changed() {
+    struct stat info {};
+    if (stat(filename.c_str(), &info) != 0) {
+        return false;
+    }
+#ifdef __linux__
+    long current = (long)info.st_mtim.tv_sec * 1000000000 + (long)info.st_mtim.tv_nsec;
+#else
+    long current = (long)info.st_mtime;
+#endif
+    long current_size = (long)info.st_size;
+    bool stable = current == seen_modified && current_size == seen_size;
+    seen_modified = current;
+    seen_size = current_size;
+    if (!stable || (current == modified && current_size == size)) {
+        return false;
+    }
+    modified = current;
+    size = current_size;
+    return true;
+}
+
+void ConfigWatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wake.wait_for(lock, interval, [this]() { return stopping; })) {
+        ulong signals = reload_signals.load();
+        bool signalled = signals != signals_seen;
+        signals_seen = signals;
+        if (changed() || signalled) {
+            lock.unlock();
+            reload();
+            lock.lock();
+        }
+    }
+}
+
+bool ConfigWatcher::reload() {
+    try {
+        load_config(filename);
+    } catch (std::runtime_error& e) {
+        get_root_logger()->error(std::string("Failed to reload logging config: ") + e.what());
+        return false;
+    }
+    reloads++;
+    return true;
+}
+
+void ConfigWatcher::reload_on_signal(int signum) {
+    std::signal(signum, __reload_signal_handler);
+}
+
+ulong ConfigWatcher::get_reloads() const {
+    return reloads;
+}
+
+}
@@ -0,0 +1,72 @@
+
+#include <charconv>
+#include "logging/field.h"
+
+namespace logging {
+
+void __render_double(std::string& out, double value) {
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr - buffer);
+}
+
+Field::Field(const char* key, double value) noexcept {
+    this->key = key;
+    type = FieldType::DOUBLE;
+    double_value = value;
+}
+
+Field::Field(const char* key, const char* value) noexcept {
+    this->key = key;
+    type = FieldType::STRING;
+    string_value = __FieldString {value, std::char_traits<char>::length(value)};
+}
+
+Field::Field(const char* key, const std::string& value) noexcept {
+    this->key = key;
+    type = FieldType::STRING;
+    string_value = __FieldString {value.data(), value.size()};
+}
+
+Field::Field(const char* key, const math::Vector& value) noexcept {
+    this->key = key;
+    type = FieldType::VECTOR;
+    vector_value = __FieldVector {value.x, value.y, value.z};
+}
+
+void Field::render_value(std::string& out) const {
+    switch (type) {
+        case FieldType::INT: {
+            char buffer[24];
+            std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), int_value);
+            out.append(buffer, result.ptr - buffer);
+            break;
+        }
+        case FieldType::UINT: {
+            char buffer[24];
+            std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), uint_value);
+            out.append(buffer, result.ptr - buffer);
+            break;
+        }
+        case FieldType::DOUBLE:
+            __render_double(out, double_value);
+            break;
+        case FieldType::BOOL:
+            out += bool_value ? "true" : "false";
+            break;
+        case FieldType::STRING:
+            out.append(string_value.data, string_value.length);
+            break;
+        case FieldType::VECTOR:
+            out += '(';
+            __render_double(out, vector_value.x);
+            out += ',';
+            __render_double(out, vector_value.y);
+            out += ',';
+            __render_double(out, vector_value.z);
+            out += ')';
+            break;
+    }
+}
+
+}
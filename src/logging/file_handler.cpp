@@ -0,0 +1,329 @@
+
+#include <cstdio>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "logging/file_handler.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * A single span of bytes to write, so the vectored write path can be shared across platforms
+ */
+struct __WriteSpan {
+    const char* data;
+    ulong length;
+};
+
+/**
+ * \internal
+ *
+ * Write every span to a file descriptor, retrying partial writes. Uses writev where available
+ *
+ * \param fd File descriptor to write to
+ * \param spans Spans to write, modified as they're consumed
+ * \return Number of write syscalls made
+ */
+static ulong __write_spans(int fd, std::vector<__WriteSpan>& spans) {
+    ulong calls = 0;
+    ulong first = 0;
+    while (first < spans.size()) {
+#ifdef _WIN32
+        long written = _write(fd, spans[first].data, (unsigned int)spans[first].length);
+#else
+        iovec iov[IOV_MAX];
+        int count = 0;
+        for (ulong i = first; i < spans.size() && count < IOV_MAX; ++i, ++count) {
+            iov[count].iov_base = const_cast<char*>(spans[i].data);
+            iov[count].iov_len = spans[i].length;
+        }
+        long written = ::writev(fd, iov, count);
+#endif
+        ++calls;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write to log file");
+        }
+        
+        ulong remaining = (ulong)written;
+        while (first < spans.size() && remaining >= spans[first].length) {
+            remaining -= spans[first].length;
+            ++first;
+        }
+        if (remaining > 0) {
+            spans[first].data += remaining;
+            spans[first].length -= remaining;
+        }
+    }
+    return calls;
+}
+
+BufferedFileHandler::BufferedFileHandler(const std::string& filename, ulong chunk_size, ulong chunk_count) {
+    if (chunk_size == 0 || chunk_count == 0) {
+        throw std::invalid_argument("BufferedFileHandler needs a non-empty buffer");
+    }
+    this->filename = filename;
+    this->fd = -1;
+    this->chunks = std::vector<std::vector<char>>(chunk_count, std::vector<char>(chunk_size));
+    this->chunk_used = std::vector<ulong>(chunk_count, 0);
+    this->current_chunk = 0;
+    this->max_bytes = 0;
+    this->max_age = std::chrono::milliseconds(0);
+    this->backups = 0;
+    this->sync_policy = SyncPolicy::NEVER;
+    this->sync_amount = 0;
+    this->unsynced_bytes = 0;
+    this->last_sync = std::chrono::steady_clock::now();
+    this->index = nullptr;
+    this->index_interval = 0;
+    open_file();
+}
+
+BufferedFileHandler::~BufferedFileHandler() {
+    try {
+        if (index != nullptr) {
+            index->close_block(logical_size());
+        }
+        do_flush();
+        if (index != nullptr) {
+            index->write_pending();
+        }
+    } catch (std::runtime_error&) {}
+    delete index;
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+void BufferedFileHandler::open_file() {
+#ifdef _WIN32
+    fd = _open(filename.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open log file " + filename);
+    }
+    struct stat info {};
+    file_size = fstat(fd, &info) == 0 ? (ulong)info.st_size : 0;
+    opened = std::chrono::steady_clock::now();
+    if (index_interval != 0) {
+        delete index;
+        index = new __IndexWriter(filename + ".idx", index_interval, file_size);
+    }
+}
+
+void BufferedFileHandler::write_out(const char* extra, ulong extra_length) {
+    std::vector<__WriteSpan> spans;
+    ulong total = extra_length;
+    for (ulong i = 0; i <= current_chunk; ++i) {
+        if (chunk_used[i] > 0) {
+            spans.push_back(__WriteSpan {chunks[i].data(), chunk_used[i]});
+            total += chunk_used[i];
+        }
+        chunk_used[i] = 0;
+    }
+    current_chunk = 0;
+    if (extra != nullptr) {
+        spans.push_back(__WriteSpan {extra, extra_length});
+    }
+    if (spans.empty()) {
+        return;
+    }
+    
+    stats.writes += __write_spans(fd, spans);
+    if (index != nullptr) {
+        index->write_pending();
+    }
+    stats.bytes += total;
+    file_size += total;
+    unsynced_bytes += total;
+}
+
+ulong BufferedFileHandler::logical_size() const {
+    ulong size = file_size;
+    for (ulong i = 0; i <= current_chunk; ++i) {
+        size += chunk_used[i];
+    }
+    return size;
+}
+
+void BufferedFileHandler::check_policies(ulong length) {
+    bool timed = max_age.count() > 0 || sync_policy == SyncPolicy::INTERVAL;
+    std::chrono::steady_clock::time_point now {};
+    if (timed) {
+        now = std::chrono::steady_clock::now();
+    }
+    
+    ulong buffered = 0;
+    for (ulong i = 0; i <= current_chunk; ++i) {
+        buffered += chunk_used[i];
+    }
+    if ((max_bytes > 0 && file_size + buffered + length > max_bytes && file_size + buffered > 0) ||
+        (max_age.count() > 0 && now - opened >= max_age)) {
+        do_rotate();
+    }
+    
+    if (sync_policy == SyncPolicy::INTERVAL && now - last_sync >= std::chrono::milliseconds(sync_amount)) {
+        do_sync();
+    } else if (sync_policy == SyncPolicy::BYTES && unsynced_bytes + buffered >= sync_amount) {
+        do_sync();
+    }
+}
+
+void BufferedFileHandler::set_rotation(ulong max_bytes, std::chrono::milliseconds max_age, uint backups) {
+    this->max_bytes = max_bytes;
+    this->max_age = max_age;
+    this->backups = backups;
+}
+
+void BufferedFileHandler::set_sync_policy(SyncPolicy policy, ulong amount) {
+    this->sync_policy = policy;
+    this->sync_amount = amount;
+}
+
+void BufferedFileHandler::do_flush() {
+    write_out(nullptr, 0);
+}
+
+void BufferedFileHandler::do_sync() {
+    do_flush();
+#ifdef _WIN32
+    _commit(fd);
+#elif defined(__linux__)
+    ::fdatasync(fd);
+#else
+    ::fsync(fd);
+#endif
+    stats.syncs++;
+    unsynced_bytes = 0;
+    last_sync = std::chrono::steady_clock::now();
+}
+
+void BufferedFileHandler::do_rotate() {
+    if (index != nullptr) {
+        index->close_block(logical_size());
+    }
+    do_flush();
+    if (index != nullptr) {
+        index->write_pending();
+    }
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    
+    std::vector<std::string> suffixes = {""};
+    if (index != nullptr) {
+        suffixes.push_back(".idx");
+    }
+    for (auto& suffix : suffixes) {
+        if (backups == 0) {
+            std::remove((filename + suffix).c_str());
+            continue;
+        }
+        std::remove((filename + "." + std::to_string(backups) + suffix).c_str());
+        for (uint i = backups - 1; i > 0; --i) {
+            std::rename((filename + "." + std::to_string(i) + suffix).c_str(),
+                        (filename + "." + std::to_string(i + 1) + suffix).c_str());
+        }
+        std::rename((filename + suffix).c_str(), (filename + ".1" + suffix).c_str());
+    }
+    
+    open_file();
+    stats.rotations++;
+}
+
+void BufferedFileHandler::set_index(ulong interval) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (interval == 0) {
+        throw std::invalid_argument("Log index interval must be positive");
+    }
+    if (index != nullptr) {
+        index->close_block(logical_size());
+        do_flush();
+        index->write_pending();
+        delete index;
+    }
+    index_interval = interval;
+    index = new __IndexWriter(filename + ".idx", interval, logical_size());
+}
+
+void BufferedFileHandler::flush() {
+    std::lock_guard<std::mutex> guard(mutex);
+    do_flush();
+}
+
+void BufferedFileHandler::sync() {
+    std::lock_guard<std::mutex> guard(mutex);
+    do_sync();
+}
+
+void BufferedFileHandler::rotate() {
+    std::lock_guard<std::mutex> guard(mutex);
+    do_rotate();
+}
+
+FileStats BufferedFileHandler::get_stats() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return stats;
+}
+
+void BufferedFileHandler::handle(const Record& record) {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (index == nullptr || *record.level < *this->level) {
+        log(*record.text, record.level);
+        return;
+    }
+    log(*record.text, record.level);
+    ulong length = record.text->size() + 1;
+    index->add(record, logical_size() - length, length);
+}
+
+void BufferedFileHandler::log(const std::string& message, const Level* level) {
+    if (*level < *this->level) {
+        return;
+    }
+    
+    ulong length = message.size() + 1;
+    check_policies(length);
+    stats.records++;
+    
+    ulong chunk_size = chunks[0].size();
+    if (length > chunk_size) {
+        std::string line = message + '\n';
+        write_out(line.data(), line.size());
+        return;
+    }
+    
+    if (chunk_used[current_chunk] + length > chunk_size) {
+        if (current_chunk + 1 == chunks.size()) {
+            do_flush();
+        } else {
+            current_chunk++;
+        }
+    }
+    
+    char* out = chunks[current_chunk].data() + chunk_used[current_chunk];
+    message.copy(out, message.size());
+    out[message.size()] = '\n';
+    chunk_used[current_chunk] += length;
+}
+
+}
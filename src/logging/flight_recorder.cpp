@@ -0,0 +1,291 @@
+
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+#include "logging/flight_recorder.h"
+#include "logging/clock.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace logging {
+
+static std::atomic<FlightRecorder*> signal_recorders[AT_FLIGHT_SIGNAL_RECORDERS];
+
+/**
+ * \internal
+ *
+ * Write a whole buffer to a file descriptor using only async-signal-safe calls
+ *
+ * \param fd File descriptor to write to
+ * \param data Bytes to write
+ * \param length Number of bytes
+ */
+static void __write_all(int fd, const char* data, ulong length) {
+    while (length > 0) {
+#ifdef _WIN32
+        long written = _write(fd, data, (unsigned int)length);
+#else
+        long written = ::write(fd, data, length);
+#endif
+        if (written <= 0) {
+            return;
+        }
+        data += written;
+        length -= (ulong)written;
+    }
+}
+
+/**
+ * \internal
+ *
+ * Write a zero padded decimal number into a buffer
+ *
+ * \param out Buffer to write to
+ * \param value Number to write
+ * \param width Number of digits to write
+ * \return Pointer past the written digits
+ */
+static char* __put_digits(char* out, ulong value, uint width) {
+    for (uint i = width; i > 0; --i) {
+        out[i - 1] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+/**
+ * \internal
+ *
+ * Format a timestamp as a UTC `YYYY-MM-DD HH:MM:SS.uuuuuu` string without calling into the C library, so it can run
+ * in a signal handler
+ *
+ * \param out Buffer of at least 26 characters to write to
+ * \param timestamp Nanoseconds since the Unix epoch
+ * \return Pointer past the written timestamp
+ */
+static char* __put_timestamp(char* out, ulong timestamp) {
+    ulong seconds = timestamp / 1000000000;
+    slong days = (slong)(seconds / 86400) + 719468;
+    ulong day_seconds = seconds % 86400;
+    
+    slong era = days / 146097;
+    ulong day_of_era = (ulong)(days - era * 146097);
+    ulong year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    ulong day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    ulong month_index = (5 * day_of_year + 2) / 153;
+    ulong day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    ulong month = month_index < 10 ? month_index + 3 : month_index - 9;
+    ulong year = year_of_era + (ulong)era * 400 + (month <= 2 ? 1 : 0);
+    
+    out = __put_digits(out, year, 4);
+    *out++ = '-';
+    out = __put_digits(out, month, 2);
+    *out++ = '-';
+    out = __put_digits(out, day, 2);
+    *out++ = ' ';
+    out = __put_digits(out, day_seconds / 3600, 2);
+    *out++ = ':';
+    out = __put_digits(out, day_seconds / 60 % 60, 2);
+    *out++ = ':';
+    out = __put_digits(out, day_seconds % 60, 2);
+    *out++ = '.';
+    return __put_digits(out, timestamp % 1000000000 / 1000, 6);
+}
+
+/**
+ * \internal
+ *
+ * Copy a string into a buffer, truncated to a maximum length
+ *
+ * \param out Buffer to write to
+ * \param text String to copy
+ * \param length Length of the string
+ * \param max Most characters to copy
+ * \return Pointer past the copied characters
+ */
+static char* __put_text(char* out, const char* text, ulong length, ulong max) {
+    if (length > max) {
+        length = max;
+    }
+    std::memcpy(out, text, length);
+    return out + length;
+}
+
+/**
+ * \internal
+ *
+ * Signal handler that dumps every registered flight recorder, then runs the default action for crash signals
+ *
+ * \param signum Signal raised
+ */
+static void __flight_signal_handler(int signum) {
+    for (auto& entry : signal_recorders) {
+        FlightRecorder* recorder = entry.load(std::memory_order_acquire);
+        if (recorder != nullptr) {
+            recorder->dump();
+        }
+    }
+    if (signum == SIGSEGV || signum == SIGABRT || signum == SIGILL || signum == SIGFPE) {
+        std::signal(signum, SIG_DFL);
+        std::raise(signum);
+    }
+}
+
+FlightRecorder::FlightRecorder(ulong capacity, ulong slot_size) {
+    if (capacity == 0 || slot_size == 0) {
+        throw std::invalid_argument("FlightRecorder needs room for at least one record");
+    }
+    this->capacity = capacity;
+    this->slot_size = slot_size;
+    this->slots = new __FlightSlot[capacity];
+    this->storage = new char[capacity * (slot_size + AT_FLIGHT_NAME_SIZE)];
+    this->scratch = new char[slot_size + AT_FLIGHT_NAME_SIZE + 128];
+    for (ulong i = 0; i < capacity; ++i) {
+        slots[i].name = storage + i * (slot_size + AT_FLIGHT_NAME_SIZE);
+        slots[i].text = slots[i].name + AT_FLIGHT_NAME_SIZE;
+    }
+    this->trigger = FATAL;
+    this->output = 2;
+}
+
+FlightRecorder::~FlightRecorder() {
+    for (auto& entry : signal_recorders) {
+        FlightRecorder* self = this;
+        entry.compare_exchange_strong(self, nullptr);
+    }
+    delete[] slots;
+    delete[] storage;
+    delete[] scratch;
+}
+
+void FlightRecorder::store(const std::string& message, const Level* level, const std::string* name,
+                           ulong timestamp) {
+    ulong ticket = next.fetch_add(1, std::memory_order_relaxed);
+    __FlightSlot& slot = slots[ticket % capacity];
+    slot.sequence.store(ticket * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    ulong length = message.size() > slot_size ? slot_size : message.size();
+    ulong name_length = name == nullptr ? 0 : name->size() > AT_FLIGHT_NAME_SIZE ? AT_FLIGHT_NAME_SIZE : name->size();
+    slot.level = level;
+    slot.timestamp = timestamp;
+    slot.name_length = (uint)name_length;
+    slot.length = (uint)length;
+    slot.truncated = length < message.size();
+    if (name_length > 0) {
+        std::memcpy(slot.name, name->data(), name_length);
+    }
+    std::memcpy(slot.text, message.data(), length);
+    
+    slot.sequence.store(ticket * 2 + 2, std::memory_order_release);
+}
+
+void FlightRecorder::set_trigger(const Level* level) {
+    trigger = level;
+}
+
+void FlightRecorder::set_output(int fd) {
+    output = fd;
+}
+
+void FlightRecorder::dump_on_signal(int signum) {
+    bool registered = false;
+    for (auto& entry : signal_recorders) {
+        FlightRecorder* current = entry.load();
+        if (current == this) {
+            registered = true;
+            break;
+        }
+    }
+    for (auto& entry : signal_recorders) {
+        FlightRecorder* empty = nullptr;
+        if (registered || entry.compare_exchange_strong(empty, this)) {
+            registered = true;
+            break;
+        }
+    }
+    if (!registered) {
+        throw std::runtime_error("Too many flight recorders registered for signals");
+    }
+    std::signal(signum, __flight_signal_handler);
+}
+
+ulong FlightRecorder::dump() {
+    return dump(output.load());
+}
+
+ulong FlightRecorder::dump(int fd) {
+    if (dumping.exchange(true, std::memory_order_acquire)) {
+        return 0;
+    }
+    
+    ulong end = next.load(std::memory_order_acquire);
+    ulong start = end > capacity ? end - capacity : 0;
+    ulong written = 0;
+    for (ulong ticket = start; ticket < end; ++ticket) {
+        __FlightSlot& slot = slots[ticket % capacity];
+        if (slot.sequence.load(std::memory_order_acquire) != ticket * 2 + 2) {
+            continue;
+        }
+        
+        char* out = __put_timestamp(scratch, slot.timestamp);
+        *out++ = ' ';
+        const char* level = slot.level->get_c_name();
+        out = __put_text(out, level, std::strlen(level), 32);
+        if (slot.name_length > 0) {
+            *out++ = ' ';
+            out = __put_text(out, slot.name, slot.name_length, AT_FLIGHT_NAME_SIZE);
+        }
+        *out++ = ':';
+        *out++ = ' ';
+        out = __put_text(out, slot.text, slot.length, slot_size);
+        bool truncated = slot.truncated;
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != ticket * 2 + 2) {
+            continue;
+        }
+        if (truncated) {
+            out = __put_text(out, "...", 3, 3);
+        }
+        *out++ = '\n';
+        __write_all(fd, scratch, (ulong)(out - scratch));
+        written++;
+    }
+    
+    dumping.store(false, std::memory_order_release);
+    return written;
+}
+
+ulong FlightRecorder::get_recorded() const {
+    return next.load(std::memory_order_relaxed);
+}
+
+bool FlightRecorder::needs_text() const {
+    return false;
+}
+
+void FlightRecorder::handle(const Record& record) {
+    store(*record.message, record.level, record.name, record.timestamp != 0 ? record.timestamp : wall_time());
+    const Level* trigger_level = trigger.load(std::memory_order_relaxed);
+    if (trigger_level != nullptr && *record.level >= *trigger_level) {
+        dump();
+    }
+}
+
+void FlightRecorder::log(const std::string& message, const Level* level) {
+    if (*level < *this->level) {
+        return;
+    }
+    store(message, level, nullptr, wall_time());
+    const Level* trigger_level = trigger.load(std::memory_order_relaxed);
+    if (trigger_level != nullptr && *level >= *trigger_level) {
+        dump();
+    }
+}
+
+}
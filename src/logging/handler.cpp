@@ -13,6 +13,19 @@ void Handler::set_level(Level* level) {
     this->level = level;
 }
 
+bool Handler::accepts(const Record& record) {
+    return *record.level >= *this->level;
+}
+
+bool Handler::needs_text() const {
+    return true;
+}
+
+void Handler::handle(const Record& record) {
+    std::lock_guard<std::mutex> guard(mutex);
+    log(*record.text, record.level);
+}
+
 void ConsoleHandler::log(const std::string& message, const Level* level) {
     if (*level >= *this->level) {
         std::cout << message << std::endl;
@@ -1,4 +1,5 @@
 
+#include <mutex>
 #include "logging/level.h"
 
 namespace logging {
@@ -41,11 +42,15 @@ Level::operator std::string() const {
     return name;
 }
 
-std::string Level::get_name() {
+std::string Level::get_name() const {
     return name;
 }
 
-int Level::get_priority() {
+const char* Level::get_c_name() const noexcept {
+    return name;
+}
+
+int Level::get_priority() const {
     return priority;
 }
 
@@ -57,17 +62,28 @@ Level* WARN;
 Level* ERROR;
 Level* FATAL;
 
-void __ensure_levels() {
-    if (NO_LEVEL != nullptr) {
-        return;
+Level* find_level(const std::string& name) {
+    __ensure_levels();
+    for (Level* level : {TRACE, DEBUG, INFO, WARN, ERROR, FATAL}) {
+        if (name == level->get_c_name()) {
+            return level;
+        }
     }
-    NO_LEVEL = new Level();
-    TRACE = new Level(0, "TRACE");
-    DEBUG = new Level(10, "DEBUG");
-    INFO = new Level(20, "INFO");
-    ERROR = new Level(40, "ERROR");
-    WARN = new Level(30, "WARN");
-    FATAL = new Level(50, "FATAL");
+    return nullptr;
+}
+
+static std::once_flag levels_flag;
+
+void __ensure_levels() {
+    std::call_once(levels_flag, []() {
+        NO_LEVEL = new Level();
+        TRACE = new Level(0, "TRACE");
+        DEBUG = new Level(10, "DEBUG");
+        INFO = new Level(20, "INFO");
+        ERROR = new Level(40, "ERROR");
+        WARN = new Level(30, "WARN");
+        FATAL = new Level(50, "FATAL");
+    });
 }
 
 }
\ No newline at end of file
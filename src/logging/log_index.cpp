@@ -0,0 +1,275 @@
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "logging/log_index.h"
+#include "logging/metrics.h"
+#include "logging/clock.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace logging {
+
+static const char index_magic[] = "ATLIDX01";
+static const ulong magic_size = 8;
+static const ulong entry_size = 48;
+
+/**
+ * \internal
+ *
+ * Append an integer to a string as little-endian bytes
+ *
+ * \param out String to append to
+ * \param value Value to append
+ * \param bytes Number of bytes to write
+ */
+static void __put_le(std::string& out, ulong value, uint bytes) {
+    for (uint i = 0; i < bytes; ++i) {
+        out += (char)(value >> (8 * i));
+    }
+}
+
+/**
+ * \internal
+ *
+ * Read a little-endian integer from a buffer
+ *
+ * \param data Buffer to read from
+ * \param bytes Number of bytes to read
+ * \return Value read
+ */
+static ulong __get_le(const char* data, uint bytes) {
+    ulong value = 0;
+    for (uint i = 0; i < bytes; ++i) {
+        value |= (ulong)(uchar)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * \internal
+ *
+ * Get the bloom filter bits of a logger name. Uses FNV-1a, so indexes stay readable across builds and platforms
+ *
+ * \param name Logger name
+ * \return Two bits to set or test in the filter
+ */
+static ulong __logger_bits(const std::string& name) {
+    ulong hash = 0xCBF29CE484222325;
+    for (char c : name) {
+        hash = (hash ^ (uchar)c) * 0x100000001B3;
+    }
+    return ((ulong)1 << (hash & 63)) | ((ulong)1 << ((hash >> 6) & 63));
+}
+
+__IndexWriter::__IndexWriter(const std::string& filename, ulong interval, ulong start) {
+    this->filename = filename;
+    this->interval = interval;
+    this->block_open = false;
+    this->block.offset = start;
+#ifdef _WIN32
+    fd = _open(filename.c_str(), _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open log index " + filename);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && info.st_size == 0) {
+        pending.append(index_magic, magic_size);
+    }
+}
+
+__IndexWriter::~__IndexWriter() {
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+void __IndexWriter::add(const Record& record, ulong offset, ulong length) {
+    if (!block_open) {
+        block.length = 0;
+        block.first_time = ~(ulong)0;
+        block.last_time = 0;
+        block.loggers = 0;
+        block.levels = 0;
+        block_open = true;
+    }
+    ulong timestamp = record.timestamp != 0 ? record.timestamp : wall_time();
+    block.first_time = timestamp < block.first_time ? timestamp : block.first_time;
+    block.last_time = timestamp > block.last_time ? timestamp : block.last_time;
+    block.levels |= (uchar)(1 << metric_index(record.level));
+    if (record.name != nullptr) {
+        block.loggers |= __logger_bits(*record.name);
+    }
+    if (offset + length - block.offset >= interval) {
+        close_block(offset + length);
+    }
+}
+
+void __IndexWriter::close_block(ulong end) {
+    if (!block_open) {
+        block.offset = end;
+        return;
+    }
+    block.length = end - block.offset;
+    __put_le(pending, block.offset, 8);
+    __put_le(pending, block.length, 8);
+    __put_le(pending, block.first_time, 8);
+    __put_le(pending, block.last_time, 8);
+    __put_le(pending, block.loggers, 8);
+    __put_le(pending, block.levels, 1);
+    pending.append(7, '\0');
+    block.offset = end;
+    block_open = false;
+}
+
+void __IndexWriter::write_pending() {
+    ulong done = 0;
+    while (done < pending.size()) {
+#ifdef _WIN32
+        long written = _write(fd, pending.data() + done, (unsigned int)(pending.size() - done));
+#else
+        long written = ::write(fd, pending.data() + done, pending.size() - done);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write log index " + filename);
+        }
+        done += (ulong)written;
+    }
+    pending.clear();
+}
+
+LogIndex::LogIndex(const std::string& filename) {
+    this->filename = filename;
+    this->data = nullptr;
+    this->size = 0;
+    
+    std::ifstream index(filename + ".idx", std::ios::binary);
+    if (index) {
+        std::ostringstream buffer;
+        buffer << index.rdbuf();
+        std::string raw = buffer.str();
+        if (raw.size() < magic_size || raw.compare(0, magic_size, index_magic) != 0) {
+            throw std::runtime_error("Not a log index: " + filename + ".idx");
+        }
+        for (ulong pos = magic_size; pos + entry_size <= raw.size(); pos += entry_size) {
+            const char* entry = raw.data() + pos;
+            IndexEntry parsed;
+            parsed.offset = __get_le(entry, 8);
+            parsed.length = __get_le(entry + 8, 8);
+            parsed.first_time = __get_le(entry + 16, 8);
+            parsed.last_time = __get_le(entry + 24, 8);
+            parsed.loggers = __get_le(entry + 32, 8);
+            parsed.levels = (uchar)entry[40];
+            entries.push_back(parsed);
+        }
+    }
+
+#ifdef _WIN32
+    std::ifstream log(filename, std::ios::binary);
+    if (!log) {
+        throw std::runtime_error("Failed to open log file " + filename);
+    }
+    std::ostringstream buffer;
+    buffer << log.rdbuf();
+    contents = buffer.str();
+    data = contents.data();
+    size = contents.size();
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open log file " + filename);
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to read log file " + filename);
+    }
+    size = (ulong)info.st_size;
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map log file " + filename);
+        }
+        data = (const char*)mapped;
+    }
+    ::close(fd);
+#endif
+}
+
+LogIndex::~LogIndex() {
+#ifndef _WIN32
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+        data = nullptr;
+    }
+#endif
+}
+
+const std::vector<IndexEntry>& LogIndex::get_entries() const {
+    return entries;
+}
+
+ulong LogIndex::get_size() const {
+    return size;
+}
+
+std::vector<LogRegion> LogIndex::find(const IndexQuery& query) const {
+    uchar levels = 0xFF;
+    if (query.min_level != nullptr) {
+        levels = (uchar)(0xFF << metric_index(query.min_level));
+    }
+    ulong loggers = query.logger.empty() ? ~(ulong)0 : __logger_bits(query.logger);
+    
+    std::vector<LogRegion> regions;
+    auto add_region = [&](ulong offset, ulong end) {
+        end = end < size ? end : size;
+        if (offset >= end) {
+            return;
+        }
+        if (!regions.empty() && regions.back().offset + regions.back().length == offset) {
+            regions.back().length += end - offset;
+        } else {
+            regions.push_back(LogRegion {offset, data + offset, end - offset});
+        }
+    };
+    
+    ulong indexed = 0;
+    for (auto& entry : entries) {
+        if (entry.offset > indexed) {
+            add_region(indexed, entry.offset);
+        }
+        indexed = entry.offset + entry.length;
+        if (entry.last_time < query.start_time || entry.first_time > query.end_time) {
+            continue;
+        }
+        if ((entry.levels & levels) == 0) {
+            continue;
+        }
+        if (!query.logger.empty() && (entry.loggers & loggers) != loggers) {
+            continue;
+        }
+        add_region(entry.offset, entry.offset + entry.length);
+    }
+    add_region(indexed, size);
+    return regions;
+}
+
+}
@@ -2,15 +2,73 @@
 #include <stdexcept>
 #include <sstream>
 #include <cctype>
+#include <mutex>
 #include "logging/logger.h"
+#include "logging/structured.h"
+#include "logging/clock.h"
+#include "logging/stack.h"
+#include "utils/rcu.h"
 
 namespace logging {
 
+/**
+ * \internal
+ *
+ * The staging buffers of one thread, which messages are formatted into before being passed to handlers. Kept as a
+ * stack, so a handler that logs while handling a record doesn't overwrite the record being handled.
+ */
+struct __StagingBuffers {
+    
+    std::vector<std::string*> buffers;
+    ulong depth = 0;
+    
+    ~__StagingBuffers() {
+        for (auto buffer : buffers) {
+            delete buffer;
+        }
+    }
+    
+};
+
+static thread_local __StagingBuffers staging;
+
+/**
+ * \internal
+ *
+ * Holds a staging buffer of the current thread for as long as it exists
+ */
+struct __StagingGuard {
+    
+    std::string* text;
+    
+    __StagingGuard() {
+        if (staging.depth == staging.buffers.size()) {
+            staging.buffers.push_back(new std::string());
+        }
+        text = staging.buffers[staging.depth++];
+        text->clear();
+    }
+    
+    ~__StagingGuard() {
+        staging.depth--;
+    }
+    
+};
+
 Logger::Logger(const std::string& name) {
     this->name = name;
     this->level = NO_LEVEL;
     this->stream_level = AT_DEFAULT_LOGGER_LEVEL;
-    this->handlers = std::vector<Handler*>();
+    this->config = new __LoggerConfig();
+}
+
+Logger::~Logger() {
+    delete config.load();
+}
+
+void Logger::publish(const __LoggerConfig* next) {
+    const __LoggerConfig* old = config.exchange(next, std::memory_order_acq_rel);
+    util::rcu_retire(old);
 }
 
 Logger& Logger::operator<<(Level* level) {
@@ -24,47 +82,93 @@ Logger& Logger::operator<<(const std::string& input) {
 }
 
 Level* Logger::get_effective_level() const {
-    if (level == NO_LEVEL) {
-        return parent->get_effective_level();
+    Level* own = level.load(std::memory_order_acquire);
+    if (own == NO_LEVEL) {
+        return parent.load(std::memory_order_acquire)->get_effective_level();
     }
-    return level;
+    return own;
 }
 
 std::string Logger::get_effective_pattern() const {
-    if (pattern.empty()) {
-        return parent->get_effective_pattern();
+    util::RcuReadGuard guard;
+    const Logger* owner = this;
+    const __LoggerConfig* current = config.load(std::memory_order_acquire);
+    while (current->pattern.empty() && owner->parent.load(std::memory_order_acquire) != nullptr) {
+        owner = owner->parent.load(std::memory_order_acquire);
+        current = owner->config.load(std::memory_order_acquire);
     }
-    return pattern;
+    return current->pattern;
 }
 
-std::string Logger::format_instruct(const std::string& instruct, std::string message, const Level* level) {
-    std::stringstream out;
+/**
+ * \internal
+ *
+ * Get the precision digit following a format instruction, if it has one
+ *
+ * \param instruct Format instruction
+ * \param fallback Precision if the instruction has none
+ * \return Number of sub-second digits to render
+ */
+static uint __instruct_precision(const std::string& instruct, uint fallback) {
+    if (instruct.size() > 1 && std::isdigit(instruct[1])) {
+        return (uint)(instruct[1] - '0');
+    }
+    return fallback;
+}
+
+void Logger::format_instruct(std::string& out, const std::string& instruct, const Record& record) {
     if (instruct[0] == 'l') {
-        out << (std::string)*level;
+        out += (std::string)*record.level;
     } else if (instruct[0] == 'm') {
-        out << message;
+        out += *record.message;
     } else if (instruct[0] == 'n') {
-        out << name;
+        out += name;
+    } else if (instruct[0] == 'k') {
+        render_fields(out, record.fields, record.field_count);
+    } else if (instruct[0] == 't') {
+        render_timestamp(out, record.timestamp != 0 ? record.timestamp : wall_time(),
+                         __instruct_precision(instruct, 3));
+    } else if (instruct[0] == 'e') {
+        render_duration(out, elapsed_time(), __instruct_precision(instruct, 6));
+    } else if (instruct[0] == 'T') {
+        out += std::to_string(thread_id());
+    } else if (instruct[0] == 's') {
+        if (record.location.file == nullptr) {
+            out += '?';
+        } else {
+            out += record.location.file;
+            out += ':';
+            out += std::to_string(record.location.line);
+        }
+    } else if (instruct[0] == 'F') {
+        out += record.location.function != nullptr ? record.location.function : "?";
+    } else if (instruct[0] == 'S') {
+        render_stack(out, record.stack, record.stack_depth);
     } else {
         throw std::runtime_error("Unrecognized log format instruction");
     }
-    return out.str();
 }
 
-std::string Logger::log_format(const std::string& message, const Level* level) {
+void Logger::log_format(std::string& out, const Record& record) {
+    const __LoggerConfig* current = config.load(std::memory_order_acquire);
+    for (Logger* up = parent.load(std::memory_order_acquire); current->pattern.empty() && up != nullptr;
+         up = up->parent.load(std::memory_order_acquire)) {
+        current = up->config.load(std::memory_order_acquire);
+    }
+    const std::string& pattern = current->pattern;
+    
     bool escaped = false, in_pat = false;
-    std::stringstream out;
-    std::string instruct, eff_pattern = get_effective_pattern();
-    for (char c : eff_pattern) {
+    std::string instruct;
+    for (char c : pattern) {
         if (escaped) {
-            out << c;
+            out += c;
         } else if (in_pat) {
             if (!std::isalnum(c)) {
-                out << format_instruct(instruct, message, level);
+                format_instruct(out, instruct, record);
                 instruct = "";
                 if (c != '%') {
                     in_pat = false;
-                    out << c;
+                    out += c;
                 }
             } else {
                 instruct += c;
@@ -77,13 +181,23 @@ std::string Logger::log_format(const std::string& message, const Level* level) {
         } else if (c == '%') {
             in_pat = true;
         } else {
-            out << c;
+            out += c;
         }
     }
     if (!instruct.empty()) {
-        out << format_instruct(instruct, message, level);
+        format_instruct(out, instruct, record);
+    }
+    
+    if (record.field_count > 0 && pattern.find("%k") == std::string::npos) {
+        if (!out.empty()) {
+            out += ' ';
+        }
+        render_fields(out, record.fields, record.field_count);
+    }
+    
+    if (record.stack_depth > 0 && pattern.find("%S") == std::string::npos) {
+        render_stack(out, record.stack, record.stack_depth);
     }
-    return out.str();
 }
 
 void Logger::set_level(Level* level) {
@@ -97,12 +211,20 @@ Level* Logger::get_level() const {
     return level;
 }
 
+bool Logger::is_enabled_for(const Level* level) const {
+    return *level >= *get_effective_level();
+}
+
 void Logger::set_pattern(const std::string& pattern) {
-    this->pattern = pattern;
+    std::lock_guard<std::mutex> lock(config_mutex);
+    __LoggerConfig* next = new __LoggerConfig(*config.load(std::memory_order_acquire));
+    next->pattern = pattern;
+    publish(next);
 }
 
 std::string Logger::get_pattern() const {
-    return pattern;
+    util::RcuReadGuard guard;
+    return config.load(std::memory_order_acquire)->pattern;
 }
 
 void Logger::set_parent(Logger* parent) {
@@ -114,53 +236,160 @@ Logger* Logger::get_parent() const {
 }
 
 void Logger::log(const std::string& message, const Level* level) {
-    if (propagate && parent != nullptr) {
-        parent->log(message, level);
+    log(message, level, SourceLocation());
+}
+
+void Logger::log(const std::string& message, const Level* level, const SourceLocation& location) {
+    Record record = {level, &name, &message, nullptr, location};
+    void* frames[AT_STACK_DEPTH];
+    Level* stack_level = get_stack_level();
+    if (stack_level != nullptr && *level >= *stack_level && is_enabled_for(level)) {
+        record.stack_depth = capture_stack(frames, AT_STACK_DEPTH, 1);
+        record.stack = frames;
+    }
+    dispatch(record);
+}
+
+void Logger::log(const std::string& message, const Level* level, std::initializer_list<Field> fields,
+                 const SourceLocation& location) {
+    Record record = {level, &name, &message, nullptr, location, fields.begin(), fields.size()};
+    void* frames[AT_STACK_DEPTH];
+    Level* stack_level = get_stack_level();
+    if (stack_level != nullptr && *level >= *stack_level && is_enabled_for(level)) {
+        record.stack_depth = capture_stack(frames, AT_STACK_DEPTH, 1);
+        record.stack = frames;
+    }
+    dispatch(record);
+}
+
+void Logger::dispatch(Record& record) {
+    Logger* up = parent.load(std::memory_order_acquire);
+    if (propagate && up != nullptr) {
+        up->dispatch(record);
     }
     
-    if (*level >= *get_effective_level()) {
-        for (auto handler : handlers) {
-            handler->log(log_format(message, level), level);
+    bool origin = record.name == &name;
+    if (*record.level < *get_effective_level()) {
+        if (origin) {
+            metrics.count_filtered(record.level);
+        }
+        return;
+    }
+    if (origin) {
+        metrics.count_emitted(record.level);
+    }
+    
+    util::RcuReadGuard guard;
+    const __LoggerConfig* current = config.load(std::memory_order_acquire);
+    if (current->handlers.empty()) {
+        return;
+    }
+    if (record.timestamp == 0) {
+        record.timestamp = wall_time();
+    }
+    
+    Record local = record;
+    __StagingGuard staged;
+    bool timed = get_handler_timing();
+    ulong start = timed ? elapsed_time() : 0;
+    ulong bytes = 0;
+    bool handled = false;
+    for (auto handler : current->handlers) {
+        if (!handler->accepts(local)) {
+            continue;
+        }
+        if (local.text == nullptr && handler->needs_text()) {
+            log_format(*staged.text, local);
+            local.text = staged.text;
         }
+        handler->handle(local);
+        bytes += local.text != nullptr ? local.text->size() : 0;
+        handled = true;
     }
+    if (handled) {
+        metrics.count_handled(local.level, bytes, timed ? elapsed_time() - start : 0);
+    }
+}
+
+LoggerMetrics Logger::get_metrics() const {
+    LoggerMetrics out;
+    out.name = name;
+    metrics.snapshot(out);
+    return out;
 }
 
 void Logger::trace(const std::string& message) {
     log(message, TRACE);
 }
 
+void Logger::trace(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, TRACE, fields);
+}
+
 void Logger::debug(const std::string& message) {
     log(message, DEBUG);
 }
 
+void Logger::debug(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, DEBUG, fields);
+}
+
 void Logger::info(const std::string& message) {
     log(message, INFO);
 }
 
+void Logger::info(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, INFO, fields);
+}
+
 void Logger::warn(const std::string& message) {
     log(message, WARN);
 }
 
+void Logger::warn(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, WARN, fields);
+}
+
 void Logger::error(const std::string& message) {
     log(message, ERROR);
 }
 
+void Logger::error(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, ERROR, fields);
+}
+
 void Logger::fatal(const std::string& message) {
     log(message, FATAL);
 }
 
+void Logger::fatal(const std::string& message, std::initializer_list<Field> fields) {
+    log(message, FATAL, fields);
+}
+
 void Logger::add_handler(Handler* handler) {
-    handlers.push_back(handler);
+    std::lock_guard<std::mutex> lock(config_mutex);
+    __LoggerConfig* next = new __LoggerConfig(*config.load(std::memory_order_acquire));
+    next->handlers.push_back(handler);
+    publish(next);
 }
 
 bool Logger::remove_handler(Handler* handler) {
-    for (std::size_t i = 0; i < handlers.size(); ++i) {
-        if (handlers[i] == handler) {
-            handlers.erase(handlers.begin() + i);
-            return true;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex);
+        const __LoggerConfig* current = config.load(std::memory_order_acquire);
+        ulong i = 0;
+        while (i < current->handlers.size() && current->handlers[i] != handler) {
+            ++i;
+        }
+        if (i == current->handlers.size()) {
+            return false;
         }
+        __LoggerConfig* next = new __LoggerConfig(*current);
+        next->handlers.erase(next->handlers.begin() + i);
+        publish(next);
     }
-    return false;
+    util::rcu_synchronize();
+    return true;
 }
 
 void Logger::set_propagation(bool propagate) {
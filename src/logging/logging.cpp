@@ -1,39 +1,77 @@
-#include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
 
 #include "types.h"
 #include "logging/logging.h"
 
 namespace logging {
 
-static std::map<std::string, Logger*>* loggers;
+/**
+ * \internal
+ *
+ * A single entry in the logger registry. Entries are never removed, so once published they can be read without
+ * any synchronization beyond the acquire load of the pointer leading to them.
+ */
+struct __LoggerEntry {
+    ulong hash;
+    std::string name;
+    Logger* logger;
+    __LoggerEntry* next;
+};
 
-void __ensure_loggers() {
-    __ensure_levels();
-    if (loggers == nullptr) {
-        loggers = new std::map<std::string, Logger*>();
-    }
-}
+static std::atomic<__LoggerEntry*> loggers[AT_LOGGER_BUCKETS];
+static std::atomic<Logger*> root_logger;
+static std::mutex registry_mutex;
 
-void set_default_level(Level* level) {
-    get_root_logger()->set_level(level);
-}
-
-void add_default_handler(Handler* handler) {
-    get_root_logger()->add_handler(handler);
+/**
+ * \internal
+ *
+ * Find a logger in the registry without taking any locks
+ *
+ * \param name Name of the logger to find
+ * \param hash Hash of the name
+ * \return Logger with the given name, or nullptr if it doesn't exist yet
+ */
+static Logger* __find_logger(const std::string& name, ulong hash) {
+    __LoggerEntry* entry = loggers[hash % AT_LOGGER_BUCKETS].load(std::memory_order_acquire);
+    for (; entry != nullptr; entry = entry->next) {
+        if (entry->hash == hash && entry->name == name) {
+            return entry->logger;
+        }
+    }
+    return nullptr;
 }
 
-bool remove_default_handler(Handler* handler) {
-    return get_root_logger()->remove_handler(handler);
+/**
+ * \internal
+ *
+ * Publish a fully configured logger to the registry. Must be called with the registry mutex held
+ *
+ * \param name Name of the logger
+ * \param hash Hash of the name
+ * \param logger Logger to publish
+ */
+static void __publish_logger(const std::string& name, ulong hash, Logger* logger) {
+    std::atomic<__LoggerEntry*>& bucket = loggers[hash % AT_LOGGER_BUCKETS];
+    __LoggerEntry* entry = new __LoggerEntry {hash, name, logger, bucket.load(std::memory_order_relaxed)};
+    bucket.store(entry, std::memory_order_release);
 }
 
-Logger* get_root_logger() {
-    __ensure_loggers();
-    if (loggers->count("root")) {
-        return loggers->at("root");
+/**
+ * \internal
+ *
+ * Create the root logger if it doesn't exist yet. Must be called with the registry mutex held
+ *
+ * \return Pointer to the root logger
+ */
+static Logger* __create_root_logger() {
+    Logger* log = root_logger.load(std::memory_order_acquire);
+    if (log != nullptr) {
+        return log;
     }
-    Logger* log = new Logger("root");
-    loggers->emplace("root", log);
     
+    log = new Logger("root");
     log->set_level(AT_DEFAULT_LOGGER_LEVEL);
     log->set_pattern("%l: %m");
     
@@ -42,31 +80,90 @@ Logger* get_root_logger() {
     log->add_handler(ch);
     log->add_handler(eh);
     
+    __publish_logger("root", std::hash<std::string>()("root"), log);
+    root_logger.store(log, std::memory_order_release);
     return log;
 }
 
-Logger* get_logger(const std::string& name, bool auto_parent) {
-    __ensure_loggers();
-    if (loggers->count(name)) {
-        return loggers->at(name);
-    } else if (name == "root") {
-        return get_root_logger();
+/**
+ * \internal
+ *
+ * Find or create a logger, creating its parents first so it is never visible without one. Must be called with the
+ * registry mutex held
+ *
+ * \param name Name of the logger
+ * \param auto_parent Whether to automatically resolve the logger namespace
+ * \return Logger with the given name
+ */
+static Logger* __create_logger(const std::string& name, bool auto_parent) {
+    if (name == "root") {
+        return __create_root_logger();
+    }
+    ulong hash = std::hash<std::string>()(name);
+    Logger* log = __find_logger(name, hash);
+    if (log != nullptr) {
+        return log;
     }
     
-    Logger* log = new Logger(name);
-    loggers->emplace(name, log);
-    
+    Logger* parent = __create_root_logger();
     if (auto_parent) {
-        std::string parent_name = "root";
         ulong pos = name.find_last_of('.');
         if (pos != std::string::npos)
-            parent_name = name.substr(0, pos);
-        Logger* parent = get_logger(parent_name, true);
-        log->set_parent(parent);
-    } else {
-        log->set_parent(get_root_logger());
+            parent = __create_logger(name.substr(0, pos), true);
     }
+    
+    log = new Logger(name);
+    log->set_parent(parent);
+    __publish_logger(name, hash, log);
     return log;
 }
 
+void __ensure_loggers() {
+    __ensure_levels();
+}
+
+void set_default_level(Level* level) {
+    get_root_logger()->set_level(level);
+}
+
+void add_default_handler(Handler* handler) {
+    get_root_logger()->add_handler(handler);
+}
+
+bool remove_default_handler(Handler* handler) {
+    return get_root_logger()->remove_handler(handler);
+}
+
+Logger* get_root_logger() {
+    Logger* log = root_logger.load(std::memory_order_acquire);
+    if (log != nullptr) {
+        return log;
+    }
+    
+    __ensure_loggers();
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    return __create_root_logger();
+}
+
+Logger* get_logger(const std::string& name, bool auto_parent) {
+    Logger* log = __find_logger(name, std::hash<std::string>()(name));
+    if (log != nullptr) {
+        return log;
+    }
+    
+    __ensure_loggers();
+    std::lock_guard<std::mutex> guard(registry_mutex);
+    return __create_logger(name, auto_parent);
+}
+
+std::vector<LoggerMetrics> snapshot_metrics() {
+    std::vector<LoggerMetrics> out;
+    for (auto& bucket : loggers) {
+        for (__LoggerEntry* entry = bucket.load(std::memory_order_acquire); entry; entry = entry->next) {
+            out.push_back(entry->logger->get_metrics());
+        }
+    }
+    return out;
+}
+
 }
@@ -0,0 +1,170 @@
+
+#include <vector>
+#include "logging/metrics.h"
+#include "logging/logging.h"
+#include "logging/structured.h"
+#include "logging/clock.h"
+
+namespace logging {
+
+static const std::string metrics_name = "metrics";
+static const std::string metrics_message = "logging metrics";
+
+static std::atomic<ulong> next_shard {0};
+static std::atomic<bool> timing_enabled {false};
+static std::atomic<ulong> timing_handlers {0};
+
+/**
+ * \internal
+ *
+ * Get the counter shard the calling thread adds to, assigned round robin the first time a thread counts anything
+ *
+ * \return Index of the thread's shard
+ */
+static ulong __thread_shard() {
+    static thread_local ulong shard = next_shard.fetch_add(1, std::memory_order_relaxed) % AT_METRIC_SHARDS;
+    return shard;
+}
+
+LevelMetrics& LevelMetrics::operator+=(const LevelMetrics& other) {
+    emitted += other.emitted;
+    filtered += other.filtered;
+    bytes += other.bytes;
+    handler_ns += other.handler_ns;
+    return *this;
+}
+
+LevelMetrics LoggerMetrics::total() const {
+    LevelMetrics sum;
+    for (const auto& level : levels) {
+        sum += level;
+    }
+    return sum;
+}
+
+ulong metric_index(const Level* level) {
+    int priority = level->get_priority();
+    if (priority < 0) {
+        return 0;
+    }
+    ulong index = (ulong)priority / 10;
+    return index < AT_METRIC_LEVELS ? index : AT_METRIC_LEVELS - 1;
+}
+
+const char* metric_level_name(ulong index) {
+    static const char* names[AT_METRIC_LEVELS] = {"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"};
+    return index < AT_METRIC_LEVELS ? names[index] : "UNKNOWN";
+}
+
+void set_handler_timing(bool enabled) {
+    timing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool get_handler_timing() {
+    return timing_enabled.load(std::memory_order_relaxed) || timing_handlers.load(std::memory_order_relaxed) != 0;
+}
+
+__MetricCounters::__MetricCounters() {
+    for (auto& shard : shards) {
+        for (ulong i = 0; i < AT_METRIC_LEVELS; ++i) {
+            shard.emitted[i] = 0;
+            shard.filtered[i] = 0;
+            shard.bytes[i] = 0;
+            shard.handler_ns[i] = 0;
+        }
+    }
+}
+
+void __MetricCounters::count_emitted(const Level* level) {
+    shards[__thread_shard()].emitted[metric_index(level)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void __MetricCounters::count_filtered(const Level* level) {
+    shards[__thread_shard()].filtered[metric_index(level)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void __MetricCounters::count_handled(const Level* level, ulong bytes, ulong nanos) {
+    __MetricShard& shard = shards[__thread_shard()];
+    ulong index = metric_index(level);
+    shard.bytes[index].fetch_add(bytes, std::memory_order_relaxed);
+    shard.handler_ns[index].fetch_add(nanos, std::memory_order_relaxed);
+}
+
+void __MetricCounters::snapshot(LoggerMetrics& out) const {
+    for (ulong i = 0; i < AT_METRIC_LEVELS; ++i) {
+        out.levels[i] = LevelMetrics();
+        for (const auto& shard : shards) {
+            out.levels[i].emitted += shard.emitted[i].load(std::memory_order_relaxed);
+            out.levels[i].filtered += shard.filtered[i].load(std::memory_order_relaxed);
+            out.levels[i].bytes += shard.bytes[i].load(std::memory_order_relaxed);
+            out.levels[i].handler_ns += shard.handler_ns[i].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+MetricsHandler::MetricsHandler(Handler* inner, std::chrono::milliseconds interval) {
+    this->inner = inner;
+    this->interval = (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+    this->last_report = elapsed_time();
+    timing_handlers.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsHandler::~MetricsHandler() {
+    timing_handlers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+ulong MetricsHandler::report() {
+    std::lock_guard<std::mutex> guard(report_mutex);
+    last_report = elapsed_time();
+    ulong reported = 0;
+    for (auto& metrics : snapshot_metrics()) {
+        LevelMetrics total = metrics.total();
+        LevelMetrics& seen = previous[metrics.name];
+        if (total.emitted == seen.emitted && total.filtered == seen.filtered && total.bytes == seen.bytes) {
+            continue;
+        }
+        
+        Field fields[] = {
+            {"logger", metrics.name},
+            {"emitted", total.emitted - seen.emitted},
+            {"filtered", total.filtered - seen.filtered},
+            {"bytes", total.bytes - seen.bytes},
+            {"handler_ns", total.handler_ns - seen.handler_ns}
+        };
+        seen = total;
+        std::string text = metrics_message + ' ';
+        render_fields(text, fields, 5);
+        Record record = {INFO, &metrics_name, &metrics_message, &text, SourceLocation(), fields, 5, wall_time()};
+        if (inner->accepts(record)) {
+            inner->handle(record);
+        }
+        reported++;
+    }
+    return reported;
+}
+
+bool MetricsHandler::accepts(const Record& record) {
+    return *record.level >= *this->level && inner->accepts(record);
+}
+
+bool MetricsHandler::needs_text() const {
+    return inner->needs_text();
+}
+
+void MetricsHandler::handle(const Record& record) {
+    ulong now = elapsed_time();
+    ulong last = last_report.load(std::memory_order_relaxed);
+    if (now - last >= interval && last_report.compare_exchange_strong(last, now)) {
+        report();
+    }
+    inner->handle(record);
+}
+
+void MetricsHandler::log(const std::string& message, const Level* level) {
+    Record record = {level, &metrics_name, &message, &message, SourceLocation()};
+    if (accepts(record)) {
+        handle(record);
+    }
+}
+
+}
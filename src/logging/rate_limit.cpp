@@ -0,0 +1,199 @@
+
+#include <ctime>
+#include <functional>
+#include <stdexcept>
+#include "logging/rate_limit.h"
+
+namespace logging {
+
+static const std::string limiter_name = "rate_limit";
+
+/**
+ * \internal
+ *
+ * Read a cheap monotonic clock, in nanoseconds. Uses the coarse clock where available, as rate limiting doesn't need
+ * better than millisecond precision
+ *
+ * \return Current monotonic time
+ */
+static ulong __monotonic_now() {
+#ifdef CLOCK_MONOTONIC_COARSE
+    timespec now {};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (ulong)now.tv_sec * 1000000000 + (ulong)now.tv_nsec;
+#else
+    return (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Get a random 64-bit number from a per-thread xorshift generator
+ *
+ * \return Random number
+ */
+static ulong __random() {
+    static thread_local ulong state = (ulong)std::hash<const void*>()(&state) ^ __monotonic_now() ^
+                                      0x9E3779B97F4A7C15;
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1D;
+}
+
+RateLimitHandler::RateLimitHandler(Handler* inner, double rate, ulong burst) {
+    if (rate <= 0 || burst == 0) {
+        throw std::invalid_argument("Rate limit must allow at least some records");
+    }
+    this->inner = inner;
+    this->interval = (ulong)(1000000000 / rate);
+    this->tolerance = interval * (burst - 1);
+    this->sites = new __RateSite[AT_RATE_LIMIT_SITES];
+    this->summary_interval = 10000000000;
+    this->last_summary = __monotonic_now();
+}
+
+RateLimitHandler::~RateLimitHandler() {
+    delete[] sites;
+    for (auto sample : samples) {
+        delete sample;
+    }
+}
+
+__RateSite& RateLimitHandler::find_site(const Record& record) {
+    ulong key;
+    if (record.location.file != nullptr) {
+        key = (ulong)std::hash<const void*>()(record.location.file) * 31 + record.location.line;
+    } else {
+        key = (ulong)std::hash<std::string>()(*record.message);
+    }
+    key |= 1;
+    
+    ulong index = key % AT_RATE_LIMIT_SITES;
+    for (uint probe = 0; probe < 8; ++probe) {
+        __RateSite& site = sites[(index + probe) % AT_RATE_LIMIT_SITES];
+        ulong current = site.key.load(std::memory_order_acquire);
+        if (current == 0 && site.key.compare_exchange_strong(current, key)) {
+            site.file = record.location.file;
+            site.line = record.location.line;
+            return site;
+        }
+        if (current == key) {
+            return site;
+        }
+    }
+    return sites[(index + 7) % AT_RATE_LIMIT_SITES];
+}
+
+void RateLimitHandler::emit_summary(const std::string& text) {
+    Record record = {WARN, &limiter_name, &text, &text, SourceLocation()};
+    if (inner->accepts(record)) {
+        inner->handle(record);
+    }
+}
+
+void RateLimitHandler::set_sample_rate(const Level* level, double probability) {
+    ulong threshold = probability >= 1 ? ~(ulong)0 : (ulong)(probability * 18446744073709551615.0);
+    for (auto sample : samples) {
+        if (sample->level == level) {
+            sample->threshold = threshold;
+            return;
+        }
+    }
+    __SampleRate* sample = new __SampleRate();
+    sample->level = level;
+    sample->threshold = threshold;
+    samples.push_back(sample);
+}
+
+void RateLimitHandler::set_summary_interval(std::chrono::milliseconds interval) {
+    summary_interval = (ulong)std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+}
+
+void RateLimitHandler::flush_summary() {
+    last_summary = __monotonic_now();
+    for (ulong i = 0; i < AT_RATE_LIMIT_SITES; ++i) {
+        ulong count = sites[i].suppressed.exchange(0);
+        if (count == 0) {
+            continue;
+        }
+        std::string text = "Suppressed " + std::to_string(count) + " messages";
+        const char* file = sites[i].file;
+        if (file != nullptr) {
+            text += " from " + std::string(file) + ":" + std::to_string(sites[i].line);
+        }
+        emit_summary(text);
+    }
+    for (auto sample : samples) {
+        ulong count = sample->dropped.exchange(0);
+        if (count != 0) {
+            emit_summary("Sampled out " + std::to_string(count) + " " + (std::string)*sample->level + " messages");
+        }
+    }
+}
+
+ulong RateLimitHandler::get_dropped() const {
+    ulong total = 0;
+    for (ulong i = 0; i < AT_RATE_LIMIT_SITES; ++i) {
+        total += sites[i].suppressed;
+    }
+    for (auto sample : samples) {
+        total += sample->dropped;
+    }
+    return total;
+}
+
+bool RateLimitHandler::accepts(const Record& record) {
+    if (*record.level < *this->level || !inner->accepts(record)) {
+        return false;
+    }
+    
+    for (auto sample : samples) {
+        if (sample->level == record.level) {
+            if (sample->threshold != ~(ulong)0 && __random() > sample->threshold) {
+                sample->dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            break;
+        }
+    }
+    
+    __RateSite& site = find_site(record);
+    ulong now = __monotonic_now();
+    ulong arrival = site.arrival.load(std::memory_order_relaxed);
+    while (true) {
+        ulong start = arrival > now ? arrival : now;
+        if (start - now > tolerance) {
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (site.arrival.compare_exchange_weak(arrival, start + interval, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool RateLimitHandler::needs_text() const {
+    return inner->needs_text();
+}
+
+void RateLimitHandler::handle(const Record& record) {
+    ulong now = __monotonic_now();
+    ulong last = last_summary.load(std::memory_order_relaxed);
+    if (now - last >= summary_interval && last_summary.compare_exchange_strong(last, now)) {
+        flush_summary();
+    }
+    inner->handle(record);
+}
+
+void RateLimitHandler::log(const std::string& message, const Level* level) {
+    Record record = {level, &limiter_name, &message, &message, SourceLocation()};
+    if (accepts(record)) {
+        handle(record);
+    }
+}
+
+}
@@ -0,0 +1,464 @@
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "logging/shipping.h"
+#include "utils/compress.h"
+
+namespace logging {
+
+static const ulong frame_header = 13;
+static const ulong max_frame = 256 * 1024 * 1024;
+
+/**
+ * \internal
+ *
+ * Write a uint into four bytes, little endian
+ *
+ * \param out Bytes to write to
+ * \param value Value to write
+ */
+static void __put_le32(char* out, ulong value) {
+    for (uint i = 0; i < 4; ++i) {
+        out[i] = (char)(value >> (i * 8));
+    }
+}
+
+/**
+ * \internal
+ *
+ * Read a little endian uint from four bytes
+ *
+ * \param data Bytes to read
+ * \return Value read
+ */
+static ulong __get_le32(const char* data) {
+    ulong value = 0;
+    for (uint i = 0; i < 4; ++i) {
+        value |= (ulong)(uchar)data[i] << (i * 8);
+    }
+    return value;
+}
+
+/**
+ * \internal
+ *
+ * Receive exactly some number of bytes from a socket
+ *
+ * \param socket Socket to read from
+ * \param buffer Buffer to fill
+ * \param size Number of bytes to read
+ * \return Number of bytes read, less than size only if the connection closed
+ */
+static ulong __recv_exact(network::Socket& socket, char* buffer, ulong size) {
+    ulong total = 0;
+    while (total < size) {
+        uint received = socket.recv(buffer + total, (uint)(size - total));
+        if (received == 0) {
+            break;
+        }
+        total += received;
+    }
+    return total;
+}
+
+ShippingHandler::ShippingHandler(const std::string& host, ushort port) {
+    this->host = host;
+    this->port = port;
+    start();
+}
+
+ShippingHandler::ShippingHandler(const std::string& path) {
+    this->port = 0;
+    this->path = path;
+    start();
+}
+
+void ShippingHandler::start() {
+    socket = nullptr;
+    batch_records = AT_SHIP_BATCH_RECORDS;
+    batch_bytes = AT_SHIP_BATCH_BYTES;
+    batch_delay = std::chrono::milliseconds(100);
+    settings.compressed = true;
+    settings.min_backoff = std::chrono::milliseconds(100);
+    settings.max_backoff = std::chrono::milliseconds(10000);
+    settings.spill_limit = 0;
+    settings_changed = false;
+    backoff_changed = false;
+    spill_changed = false;
+    current = settings;
+    backoff = current.min_backoff;
+    next_attempt = std::chrono::steady_clock::now();
+    spill_size = 0;
+    batch_count = 0;
+    sending = false;
+    stopping = false;
+    sender = std::thread(&ShippingHandler::run, this);
+}
+
+ShippingHandler::~ShippingHandler() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        seal();
+        stopping = true;
+    }
+    wake.notify_all();
+    sender.join();
+    delete socket;
+}
+
+void ShippingHandler::seal() {
+    if (batch_count == 0) {
+        return;
+    }
+    if (pending.size() >= AT_SHIP_QUEUE_BATCHES) {
+        stats.dropped += batch_count;
+    } else {
+        stats.batches++;
+        stats.raw_bytes += batch.size();
+        pending.emplace_back(std::move(batch), batch_count);
+        wake.notify_one();
+    }
+    batch = std::string();
+    batch.reserve(batch_bytes + batch_bytes / 8);
+    batch_count = 0;
+}
+
+void ShippingHandler::apply_settings() {
+    current = settings;
+    if (backoff_changed) {
+        backoff = current.min_backoff;
+    }
+    if (spill_changed) {
+        spill_size = 0;
+        if (!current.spill_path.empty()) {
+            std::ifstream existing(current.spill_path, std::ios::binary | std::ios::ate);
+            if (existing) {
+                spill_size = (ulong)existing.tellg();
+            }
+        }
+    }
+    settings_changed = false;
+    backoff_changed = false;
+    spill_changed = false;
+}
+
+void ShippingHandler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (settings_changed) {
+            apply_settings();
+        }
+        if (pending.empty()) {
+            if (stopping) {
+                break;
+            }
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (batch_count > 0 && now >= batch_started + batch_delay) {
+                seal();
+                continue;
+            }
+            if (spill_size > 0 && socket == nullptr && now >= next_attempt) {
+                sending = true;
+                lock.unlock();
+                ensure_connected();
+                lock.lock();
+                sending = false;
+                published_stats = sender_stats;
+                continue;
+            }
+            
+            bool deadline = false;
+            std::chrono::steady_clock::time_point until;
+            if (batch_count > 0) {
+                until = batch_started + batch_delay;
+                deadline = true;
+            }
+            if (spill_size > 0 && socket == nullptr && (!deadline || next_attempt < until)) {
+                until = next_attempt;
+                deadline = true;
+            }
+            bool had_batch = batch_count > 0;
+            auto ready = [this, had_batch]() {
+                return stopping || settings_changed || !pending.empty() || (!had_batch && batch_count > 0);
+            };
+            if (deadline) {
+                wake.wait_until(lock, until, ready);
+            } else {
+                wake.wait(lock, ready);
+            }
+            continue;
+        }
+        
+        std::pair<std::string, ulong> next = std::move(pending.front());
+        pending.pop_front();
+        sending = true;
+        lock.unlock();
+        deliver(frame(next.first, next.second), next.second);
+        lock.lock();
+        sending = false;
+        published_stats = sender_stats;
+        if (pending.empty()) {
+            idle.notify_all();
+        }
+    }
+    idle.notify_all();
+}
+
+std::string ShippingHandler::frame(const std::string& payload, ulong records) {
+    std::string out(frame_header, '\0');
+    uchar flags = 0;
+    if (current.compressed) {
+        out.reserve(frame_header + payload.size());
+        util::compress(payload.data(), payload.size(), out);
+        if (out.size() - frame_header < payload.size()) {
+            flags = 1;
+        } else {
+            out.resize(frame_header);
+        }
+    }
+    if (flags == 0) {
+        out += payload;
+    }
+    __put_le32(&out[0], out.size() - 4);
+    out[4] = (char)flags;
+    __put_le32(&out[5], records);
+    __put_le32(&out[9], payload.size());
+    return out;
+}
+
+void ShippingHandler::deliver(const std::string& data, ulong records) {
+    if (ensure_connected()) {
+        try {
+            socket->send(data.data(), (uint)data.size());
+            sender_stats.sends++;
+            sender_stats.sent_bytes += data.size();
+            return;
+        } catch (network::socket_error&) {
+            disconnect();
+        }
+    }
+    spill(data, records);
+}
+
+bool ShippingHandler::ensure_connected() {
+    if (socket != nullptr) {
+        return true;
+    }
+    if (std::chrono::steady_clock::now() < next_attempt) {
+        return false;
+    }
+    
+    network::Socket* connection = nullptr;
+    try {
+        if (path.empty()) {
+            connection = new network::Socket((ushort)AF_INET, (uint)SOCK_STREAM);
+            connection->connect(host, port);
+        } else {
+            connection = new network::Socket((ushort)AF_UNIX, (uint)SOCK_STREAM);
+            connection->connect(path);
+        }
+    } catch (network::socket_error&) {
+        delete connection;
+        disconnect();
+        return false;
+    }
+    
+    socket = connection;
+    sender_stats.connects++;
+    backoff = current.min_backoff;
+    if (spill_size > 0 && !replay()) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+void ShippingHandler::disconnect() {
+    delete socket;
+    socket = nullptr;
+    sender_stats.failures++;
+    next_attempt = std::chrono::steady_clock::now() + backoff;
+    backoff = backoff * 2 > current.max_backoff ? current.max_backoff : backoff * 2;
+}
+
+void ShippingHandler::spill(const std::string& frame, ulong records) {
+    if (current.spill_path.empty() || spill_size + frame.size() > current.spill_limit) {
+        sender_stats.dropped += records;
+        return;
+    }
+    std::ofstream out(current.spill_path, std::ios::binary | std::ios::app);
+    out.write(frame.data(), (std::streamsize)frame.size());
+    if (!out) {
+        sender_stats.dropped += records;
+        return;
+    }
+    spill_size += frame.size();
+    sender_stats.spilled_bytes += frame.size();
+}
+
+bool ShippingHandler::replay() {
+    std::ifstream in(current.spill_path, std::ios::binary);
+    std::vector<char> chunk(64 * 1024);
+    while (in) {
+        in.read(chunk.data(), (std::streamsize)chunk.size());
+        std::streamsize got = in.gcount();
+        if (got <= 0) {
+            break;
+        }
+        try {
+            socket->send(chunk.data(), (uint)got);
+        } catch (network::socket_error&) {
+            return false;
+        }
+        sender_stats.sends++;
+        sender_stats.sent_bytes += (ulong)got;
+        sender_stats.replayed_bytes += (ulong)got;
+    }
+    in.close();
+    std::remove(current.spill_path.c_str());
+    spill_size = 0;
+    return true;
+}
+
+void ShippingHandler::set_batching(ulong max_records, ulong max_bytes, std::chrono::milliseconds max_delay) {
+    std::lock_guard<std::mutex> guard(mutex);
+    batch_records = max_records == 0 ? 1 : max_records;
+    batch_bytes = max_bytes;
+    batch_delay = max_delay;
+}
+
+void ShippingHandler::set_backoff(std::chrono::milliseconds min_delay, std::chrono::milliseconds max_delay) {
+    std::lock_guard<std::mutex> guard(mutex);
+    settings.min_backoff = min_delay;
+    settings.max_backoff = max_delay;
+    settings_changed = true;
+    backoff_changed = true;
+    wake.notify_one();
+}
+
+void ShippingHandler::set_spill(const std::string& path, ulong max_bytes) {
+    std::lock_guard<std::mutex> guard(mutex);
+    settings.spill_path = path;
+    settings.spill_limit = max_bytes;
+    settings_changed = true;
+    spill_changed = true;
+    wake.notify_one();
+}
+
+void ShippingHandler::set_compression(bool enabled) {
+    std::lock_guard<std::mutex> guard(mutex);
+    settings.compressed = enabled;
+    settings_changed = true;
+    wake.notify_one();
+}
+
+void ShippingHandler::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    seal();
+    idle.wait(lock, [this]() {
+        return pending.empty() && !sending;
+    });
+}
+
+ShipStats ShippingHandler::get_stats() {
+    std::lock_guard<std::mutex> guard(mutex);
+    ShipStats result = published_stats;
+    result.records = stats.records;
+    result.batches = stats.batches;
+    result.raw_bytes = stats.raw_bytes;
+    result.dropped += stats.dropped;
+    return result;
+}
+
+void ShippingHandler::log(const std::string& message, const Level* level) {
+    if (*level < *this->level) {
+        return;
+    }
+    if (batch_count == 0) {
+        batch_started = std::chrono::steady_clock::now();
+        wake.notify_one();
+    }
+    
+    const char* name = level->get_c_name();
+    ulong name_length = std::strlen(name);
+    char header[4];
+    __put_le32(header, message.size());
+    batch += (char)name_length;
+    batch.append(name, name_length);
+    batch.append(header, 4);
+    batch += message;
+    batch_count++;
+    stats.records++;
+    
+    if (batch_count >= batch_records || batch.size() >= batch_bytes) {
+        seal();
+    }
+}
+
+void parse_batch(const char* data, ulong length, std::vector<ShippedRecord>& records) {
+    if (length < frame_header - 4) {
+        throw std::runtime_error("Shipped batch is too short");
+    }
+    uchar flags = (uchar)data[0];
+    ulong count = __get_le32(data + 1);
+    ulong raw_length = __get_le32(data + 5);
+    data += frame_header - 4;
+    length -= frame_header - 4;
+    if (raw_length > max_frame) {
+        throw std::runtime_error("Shipped batch is too large");
+    }
+    
+    std::string decompressed;
+    if (flags & 1) {
+        util::decompress(data, length, decompressed, raw_length);
+        data = decompressed.data();
+        length = decompressed.size();
+    } else if (length != raw_length) {
+        throw std::runtime_error("Shipped batch has the wrong length");
+    }
+    
+    const char* end = data + length;
+    for (ulong i = 0; i < count; ++i) {
+        if (end - data < 1 || (ulong)(end - data) < 5 + (ulong)(uchar)data[0]) {
+            throw std::runtime_error("Shipped batch ends inside a record");
+        }
+        ulong name_length = (uchar)data[0];
+        const Level* level = find_level(std::string(data + 1, name_length));
+        if (level == nullptr) {
+            level = INFO;
+        }
+        data += 1 + name_length;
+        ulong text_length = __get_le32(data);
+        data += 4;
+        if ((ulong)(end - data) < text_length) {
+            throw std::runtime_error("Shipped batch ends inside a record");
+        }
+        records.push_back(ShippedRecord {level, std::string(data, text_length)});
+        data += text_length;
+    }
+}
+
+bool read_batch(network::Socket& socket, std::vector<ShippedRecord>& records) {
+    char header[4];
+    ulong got = __recv_exact(socket, header, 4);
+    if (got == 0) {
+        return false;
+    }
+    if (got < 4) {
+        throw network::socket_error("Connection closed inside a batch");
+    }
+    ulong length = __get_le32(header);
+    if (length > max_frame) {
+        throw std::runtime_error("Shipped batch is too large");
+    }
+    std::string body(length, '\0');
+    if (__recv_exact(socket, &body[0], length) < length) {
+        throw network::socket_error("Connection closed inside a batch");
+    }
+    parse_batch(body.data(), body.size(), records);
+    return true;
+}
+
+}
@@ -0,0 +1,125 @@
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstdio>
+#include "generic.h"
+#include "logging/stack.h"
+
+#ifdef LINUXCOMPAT
+#include <execinfo.h>
+#include <dlfcn.h>
+#elif defined(WINCOMPAT)
+#include <windows.h>
+#endif
+
+namespace logging {
+
+static std::atomic<Level*> stack_level {nullptr};
+
+static std::shared_mutex symbol_mutex;
+static std::unordered_map<const void*, std::string> symbols;
+static std::unordered_map<std::string, std::string> demangled;
+
+/**
+ * \internal
+ *
+ * Demangle a symbol name, caching the result. Names that aren't mangled C++ names are returned unchanged. Must be
+ * called with the symbol lock held exclusively
+ *
+ * \param name Symbol name
+ * \return Readable name
+ */
+static const std::string& __demangle_cached(const std::string& name) {
+    auto found = demangled.find(name);
+    if (found != demangled.end()) {
+        return found->second;
+    }
+    std::string result = name;
+    if (name.compare(0, 2, "_Z") == 0) {
+        try {
+            result = demangle(name);
+        } catch (std::runtime_error&) {}
+    }
+    return demangled.emplace(name, result).first->second;
+}
+
+/**
+ * \internal
+ *
+ * Format an offset from a base address as hex
+ *
+ * \param offset Offset to format
+ * \return Offset as `0x...`
+ */
+static std::string __hex(ulong offset) {
+    char buffer[24];
+    std::snprintf(buffer, sizeof(buffer), "0x%lx", (unsigned long)offset);
+    return buffer;
+}
+
+void set_stack_level(Level* level) {
+    stack_level.store(level, std::memory_order_release);
+}
+
+Level* get_stack_level() {
+    return stack_level.load(std::memory_order_acquire);
+}
+
+uint capture_stack(void** frames, uint max, uint skip) {
+#ifdef LINUXCOMPAT
+    void* raw[AT_STACK_DEPTH + 16];
+    uint wanted = max + skip + 1;
+    int got = ::backtrace(raw, (int)(wanted < AT_STACK_DEPTH + 16 ? wanted : AT_STACK_DEPTH + 16));
+    uint depth = 0;
+    for (int i = (int)skip + 1; i < got && depth < max; ++i) {
+        frames[depth++] = raw[i];
+    }
+    return depth;
+#elif defined(WINCOMPAT)
+    return (uint)CaptureStackBackTrace((DWORD)(skip + 1), (DWORD)max, frames, nullptr);
+#else
+    (void)frames;
+    (void)max;
+    (void)skip;
+    return 0;
+#endif
+}
+
+std::string symbolize(const void* address) {
+    {
+        std::shared_lock<std::shared_mutex> lock(symbol_mutex);
+        auto found = symbols.find(address);
+        if (found != symbols.end()) {
+            return found->second;
+        }
+    }
+    
+    std::unique_lock<std::shared_mutex> lock(symbol_mutex);
+    std::string result = __hex((ulong)address);
+#ifdef LINUXCOMPAT
+    Dl_info info {};
+    if (dladdr(address, &info) != 0) {
+        std::string module = info.dli_fname != nullptr ? info.dli_fname : "?";
+        if (info.dli_sname != nullptr) {
+            result = __demangle_cached(info.dli_sname) + "+" +
+                     __hex((ulong)address - (ulong)info.dli_saddr) + " (" + module + ")";
+        } else {
+            result = module + "+" + __hex((ulong)address - (ulong)info.dli_fbase);
+        }
+    }
+#endif
+    return symbols.emplace(address, result).first->second;
+}
+
+void render_stack(std::string& out, const void* const* frames, uint depth) {
+    for (uint i = 0; i < depth; ++i) {
+        out += "\n    #";
+        out += std::to_string(i);
+        out += ' ';
+        out += symbolize(frames[i]);
+    }
+}
+
+}
@@ -0,0 +1,294 @@
+
+#include <cmath>
+#include <cstring>
+#include "logging/structured.h"
+#include "logging/clock.h"
+#include "logging/stack.h"
+
+namespace logging {
+
+/**
+ * \internal
+ *
+ * Append a string as the contents of a JSON string literal, escaping as needed
+ *
+ * \param out String to append to
+ * \param data Characters to append
+ * \param length Number of characters
+ */
+static void __append_json_string(std::string& out, const char* data, ulong length) {
+    static const char* hex = "0123456789abcdef";
+    out += '"';
+    for (ulong i = 0; i < length; ++i) {
+        uchar c = (uchar)data[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else if (c == '\r') {
+            out += "\\r";
+        } else if (c == '\t') {
+            out += "\\t";
+        } else if (c < 0x20) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 0xF];
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * \internal
+ *
+ * Append a double as a JSON number, or null if it isn't finite
+ *
+ * \param out String to append to
+ * \param value Value to append
+ */
+static void __append_json_double(std::string& out, double value) {
+    if (std::isfinite(value)) {
+        __render_double(out, value);
+    } else {
+        out += "null";
+    }
+}
+
+/**
+ * \internal
+ *
+ * Append an unsigned integer in little endian order
+ *
+ * \param out String to append to
+ * \param value Value to append
+ * \param size Number of bytes to append
+ */
+static void __append_le(std::string& out, ulong value, uint size) {
+    for (uint i = 0; i < size; ++i) {
+        out += (char)(value >> (i * 8));
+    }
+}
+
+/**
+ * \internal
+ *
+ * Append a double as its little endian IEEE 754 bits
+ *
+ * \param out String to append to
+ * \param value Value to append
+ */
+static void __append_le_double(std::string& out, double value) {
+    ulong bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    __append_le(out, bits, 8);
+}
+
+/**
+ * \internal
+ *
+ * Append a string prefixed by its length, truncating it to the longest length the prefix can hold
+ *
+ * \param out String to append to
+ * \param data Characters to append
+ * \param length Number of characters
+ * \param size Size of the length prefix in bytes
+ */
+static void __append_sized(std::string& out, const char* data, ulong length, uint size) {
+    ulong max = size >= 8 ? ~(ulong)0 : ((ulong)1 << (size * 8)) - 1;
+    if (length > max) {
+        length = max;
+    }
+    __append_le(out, length, size);
+    out.append(data, length);
+}
+
+void render_fields(std::string& out, const Field* fields, ulong count) {
+    for (ulong i = 0; i < count; ++i) {
+        const Field& field = fields[i];
+        if (i > 0) {
+            out += ' ';
+        }
+        out += field.key;
+        out += '=';
+        if (field.type != FieldType::STRING) {
+            field.render_value(out);
+            continue;
+        }
+        
+        const char* data = field.string_value.data;
+        ulong length = field.string_value.length;
+        bool quote = length == 0;
+        for (ulong j = 0; j < length && !quote; ++j) {
+            uchar c = (uchar)data[j];
+            quote = c <= ' ' || c == '"' || c == '=' || c == '\\';
+        }
+        if (!quote) {
+            out.append(data, length);
+            continue;
+        }
+        
+        out += '"';
+        for (ulong j = 0; j < length; ++j) {
+            char c = data[j];
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+}
+
+void render_json(std::string& out, const Record& record) {
+    out += '{';
+    if (record.timestamp != 0) {
+        out += "\"time\":\"";
+        render_timestamp(out, record.timestamp, 9);
+        out += "\",";
+    }
+    out += "\"level\":";
+    std::string level = record.level->get_name();
+    __append_json_string(out, level.data(), level.size());
+    out += ",\"logger\":";
+    __append_json_string(out, record.name->data(), record.name->size());
+    out += ",\"message\":";
+    __append_json_string(out, record.message->data(), record.message->size());
+    if (record.location.file != nullptr) {
+        out += ",\"file\":";
+        __append_json_string(out, record.location.file, std::char_traits<char>::length(record.location.file));
+        out += ",\"line\":";
+        out += std::to_string(record.location.line);
+    }
+    
+    for (ulong i = 0; i < record.field_count; ++i) {
+        const Field& field = record.fields[i];
+        out += ',';
+        __append_json_string(out, field.key, std::char_traits<char>::length(field.key));
+        out += ':';
+        switch (field.type) {
+            case FieldType::STRING:
+                __append_json_string(out, field.string_value.data, field.string_value.length);
+                break;
+            case FieldType::DOUBLE:
+                __append_json_double(out, field.double_value);
+                break;
+            case FieldType::VECTOR:
+                out += '[';
+                __append_json_double(out, field.vector_value.x);
+                out += ',';
+                __append_json_double(out, field.vector_value.y);
+                out += ',';
+                __append_json_double(out, field.vector_value.z);
+                out += ']';
+                break;
+            default:
+                field.render_value(out);
+                break;
+        }
+    }
+    
+    if (record.stack_depth > 0) {
+        out += ",\"stack\":[";
+        for (uint i = 0; i < record.stack_depth; ++i) {
+            std::string frame = symbolize(record.stack[i]);
+            if (i > 0) {
+                out += ',';
+            }
+            __append_json_string(out, frame.data(), frame.size());
+        }
+        out += ']';
+    }
+    out += '}';
+}
+
+void render_binary(std::string& out, const Record& record) {
+    ulong start = out.size();
+    __append_le(out, 0, 4);
+    
+    std::string level = record.level->get_name();
+    __append_le(out, (uint)record.level->get_priority(), 4);
+    __append_sized(out, level.data(), level.size(), 1);
+    __append_sized(out, record.name->data(), record.name->size(), 2);
+    __append_sized(out, record.message->data(), record.message->size(), 4);
+    const char* file = record.location.file != nullptr ? record.location.file : "";
+    __append_sized(out, file, std::char_traits<char>::length(file), 2);
+    __append_le(out, record.location.line, 4);
+    
+    ulong count = record.field_count > 255 ? 255 : record.field_count;
+    __append_le(out, count, 1);
+    for (ulong i = 0; i < count; ++i) {
+        const Field& field = record.fields[i];
+        __append_sized(out, field.key, std::char_traits<char>::length(field.key), 1);
+        __append_le(out, (uchar)field.type, 1);
+        switch (field.type) {
+            case FieldType::INT:
+                __append_le(out, (ulong)field.int_value, 8);
+                break;
+            case FieldType::UINT:
+                __append_le(out, field.uint_value, 8);
+                break;
+            case FieldType::DOUBLE:
+                __append_le_double(out, field.double_value);
+                break;
+            case FieldType::BOOL:
+                __append_le(out, field.bool_value ? 1 : 0, 1);
+                break;
+            case FieldType::STRING:
+                __append_sized(out, field.string_value.data, field.string_value.length, 4);
+                break;
+            case FieldType::VECTOR:
+                __append_le_double(out, field.vector_value.x);
+                __append_le_double(out, field.vector_value.y);
+                __append_le_double(out, field.vector_value.z);
+                break;
+        }
+    }
+    
+    ulong length = out.size() - start - 4;
+    for (uint i = 0; i < 4; ++i) {
+        out[start + i] = (char)(length >> (i * 8));
+    }
+}
+
+StreamHandler::StreamHandler(std::ostream& stream, RecordFormat format) {
+    this->stream = &stream;
+    this->format = format;
+}
+
+RecordFormat StreamHandler::get_format() const {
+    return format;
+}
+
+bool StreamHandler::needs_text() const {
+    return format == RecordFormat::TEXT;
+}
+
+void StreamHandler::handle(const Record& record) {
+    std::lock_guard<std::mutex> guard(mutex);
+    buffer.clear();
+    if (format == RecordFormat::TEXT) {
+        buffer += *record.text;
+        buffer += '\n';
+    } else if (format == RecordFormat::JSON) {
+        render_json(buffer, record);
+        buffer += '\n';
+    } else {
+        render_binary(buffer, record);
+    }
+    stream->write(buffer.data(), (std::streamsize)buffer.size());
+}
+
+void StreamHandler::log(const std::string& message, const Level* level) {
+    if (*level >= *this->level) {
+        *stream << message << '\n';
+    }
+}
+
+}
@@ -0,0 +1,342 @@
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "network/datagram.h"
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/uio.h>
+#endif
+
+/**
+ * \internal
+ *
+ * Bytes of control data kept per slot, enough for the segment size reported with UDP_GRO
+ */
+#define AT_DATAGRAM_CONTROL 64
+
+/**
+ * \internal
+ *
+ * Most segments the kernel accepts in one segmented send
+ */
+#define AT_DATAGRAM_SEGMENTS 64
+
+namespace network {
+
+struct __DatagramSlots {
+#ifdef __linux__
+    std::vector<mmsghdr> headers;
+    std::vector<iovec> parts;
+    std::vector<char> control;
+#endif
+    std::vector<sockaddr_in> addresses;
+    std::vector<ulong> lengths;
+    std::vector<ulong> segments;
+};
+
+DatagramBatch::DatagramBatch(ulong capacity, ulong slot_size) {
+    this->capacity = capacity;
+    this->slot_size = slot_size;
+    this->count = 0;
+    this->sent = 0;
+    storage = new char[capacity * slot_size];
+    slots = new __DatagramSlots();
+#ifdef __linux__
+    slots->headers.resize(capacity);
+    slots->parts.resize(capacity);
+    slots->control.resize(capacity * AT_DATAGRAM_CONTROL);
+#endif
+    slots->addresses.resize(capacity);
+    slots->lengths.resize(capacity);
+    slots->segments.resize(capacity);
+}
+
+DatagramBatch::~DatagramBatch() {
+    delete[] storage;
+    delete slots;
+}
+
+ulong DatagramBatch::get_capacity() const {
+    return capacity;
+}
+
+ulong DatagramBatch::get_slot_size() const {
+    return slot_size;
+}
+
+ulong DatagramBatch::size() const {
+    return count;
+}
+
+ulong DatagramBatch::get_sent() const {
+    return sent;
+}
+
+void DatagramBatch::clear() {
+    count = 0;
+    sent = 0;
+}
+
+char* DatagramBatch::data(ulong index) {
+    if (index >= capacity) {
+        throw std::out_of_range("Datagram slot out of range");
+    }
+    return storage + index * slot_size;
+}
+
+ulong DatagramBatch::length(ulong index) const {
+    if (index >= count) {
+        throw std::out_of_range("Datagram index out of range");
+    }
+    return slots->lengths[index];
+}
+
+Endpoint DatagramBatch::get_endpoint(ulong index) const {
+    if (index >= count) {
+        throw std::out_of_range("Datagram index out of range");
+    }
+    const sockaddr_in& address = slots->addresses[index];
+    return Endpoint(IPAddr(address.sin_addr), ntohs(address.sin_port));
+}
+
+ulong DatagramBatch::get_segment_size(ulong index) const {
+    if (index >= count) {
+        throw std::out_of_range("Datagram index out of range");
+    }
+    return slots->segments[index];
+}
+
+bool DatagramBatch::push(const char* bytes, ulong length, const Endpoint& to) {
+    if (count == capacity) {
+        return false;
+    }
+    if (length > slot_size) {
+        throw std::out_of_range("Datagram is longer than the slot size");
+    }
+    std::memcpy(data(count), bytes, length);
+    return commit(length, to);
+}
+
+bool DatagramBatch::commit(ulong length, const Endpoint& to) {
+    if (count == capacity) {
+        return false;
+    }
+    if (length > slot_size) {
+        throw std::out_of_range("Datagram is longer than the slot size");
+    }
+    sockaddr_in& address = slots->addresses[count];
+    address = sockaddr_in();
+    address.sin_family = AF_INET;
+    address.sin_addr = to.ip.addr;
+    address.sin_port = htons(to.port);
+    slots->lengths[count] = length;
+    slots->segments[count] = 0;
+    count++;
+    return true;
+}
+
+IOResult recv_batch(Socket& socket, DatagramBatch& batch, int flags) {
+    batch.clear();
+    __DatagramSlots& slots = *batch.slots;
+    IOResult result;
+#ifdef __linux__
+    for (ulong i = 0; i < batch.capacity; ++i) {
+        slots.parts[i].iov_base = batch.data(i);
+        slots.parts[i].iov_len = batch.slot_size;
+        msghdr& header = slots.headers[i].msg_hdr;
+        header.msg_name = &slots.addresses[i];
+        header.msg_namelen = sizeof(sockaddr_in);
+        header.msg_iov = &slots.parts[i];
+        header.msg_iovlen = 1;
+        header.msg_control = slots.control.data() + i * AT_DATAGRAM_CONTROL;
+        header.msg_controllen = AT_DATAGRAM_CONTROL;
+        header.msg_flags = 0;
+    }
+    int received;
+    do {
+        received = ::recvmmsg((int)socket.get_fd(), slots.headers.data(), (uint)batch.capacity,
+                              flags | MSG_WAITFORONE, nullptr);
+    } while (received < 0 && errno == EINTR);
+    if (received < 0) {
+        result.error = errno;
+        return result;
+    }
+    for (int i = 0; i < received; ++i) {
+        slots.lengths[i] = slots.headers[i].msg_len;
+        slots.segments[i] = 0;
+#ifdef UDP_GRO
+        msghdr& header = slots.headers[i].msg_hdr;
+        for (cmsghdr* control = CMSG_FIRSTHDR(&header); control; control = CMSG_NXTHDR(&header, control)) {
+            if (control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO) {
+                int segment;
+                std::memcpy(&segment, CMSG_DATA(control), sizeof(segment));
+                slots.segments[i] = (ulong)segment;
+            }
+        }
+#endif
+        result.bytes += slots.lengths[i];
+    }
+    batch.count = (ulong)received;
+#else
+    while (batch.count < batch.capacity) {
+        int call_flags = flags;
+#ifdef MSG_DONTWAIT
+        if (batch.count > 0) {
+            call_flags |= MSG_DONTWAIT;
+        }
+#endif
+        Endpoint from;
+        IOResult part = socket.recv_from(batch.data(batch.count), batch.slot_size, from, call_flags);
+        if (!part.ok()) {
+            if (batch.count == 0) {
+                result.error = part.error;
+            }
+            break;
+        }
+        batch.commit(part.bytes, from);
+        result.bytes += part.bytes;
+#ifndef MSG_DONTWAIT
+        break;
+#endif
+    }
+#endif
+    return result;
+}
+
+IOResult send_batch(Socket& socket, DatagramBatch& batch, int flags) {
+    __DatagramSlots& slots = *batch.slots;
+    IOResult result;
+#ifdef __linux__
+    for (ulong i = batch.sent; i < batch.count; ++i) {
+        slots.parts[i].iov_base = batch.data(i);
+        slots.parts[i].iov_len = slots.lengths[i];
+        msghdr& header = slots.headers[i].msg_hdr;
+        header.msg_name = &slots.addresses[i];
+        header.msg_namelen = sizeof(sockaddr_in);
+        header.msg_iov = &slots.parts[i];
+        header.msg_iovlen = 1;
+        header.msg_control = nullptr;
+        header.msg_controllen = 0;
+        header.msg_flags = 0;
+    }
+    while (batch.sent < batch.count) {
+        int sent = ::sendmmsg((int)socket.get_fd(), slots.headers.data() + batch.sent,
+                              (uint)(batch.count - batch.sent), flags);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result.error = errno;
+            break;
+        }
+        for (int i = 0; i < sent; ++i) {
+            result.bytes += slots.headers[batch.sent + i].msg_len;
+        }
+        batch.sent += (ulong)sent;
+    }
+#else
+    while (batch.sent < batch.count) {
+        IOResult part = socket.send_to(batch.data(batch.sent), slots.lengths[batch.sent],
+                                       batch.get_endpoint(batch.sent), flags);
+        if (!part.ok()) {
+            result.error = part.error;
+            break;
+        }
+        result.bytes += part.bytes;
+        batch.sent++;
+    }
+#endif
+    return result;
+}
+
+/**
+ * \internal
+ *
+ * Send a run of segments one datagram at a time, for when segmentation offload isn't available
+ *
+ * \param socket Socket to send on
+ * \param bytes Bytes to send
+ * \param length Number of bytes to send
+ * \param segment Size of each datagram
+ * \param to Address to send to
+ * \return Bytes sent and errno
+ */
+static IOResult __send_segments(Socket& socket, const char* bytes, ulong length, ulong segment, const Endpoint& to) {
+    IOResult result;
+    while (result.bytes < length) {
+        ulong size = length - result.bytes < segment ? length - result.bytes : segment;
+        IOResult part = socket.send_to(bytes + result.bytes, size, to);
+        if (!part.ok()) {
+            result.error = part.error;
+            break;
+        }
+        result.bytes += part.bytes;
+    }
+    return result;
+}
+
+IOResult send_segmented(Socket& socket, const char* bytes, ulong length, ulong segment, const Endpoint& to) {
+    IOResult result;
+    if (segment == 0) {
+        result.error = EINVAL;
+        return result;
+    }
+#if defined(__linux__) && defined(UDP_SEGMENT)
+    ulong per_call = AT_DATAGRAM_MAX / segment;
+    per_call = per_call < AT_DATAGRAM_SEGMENTS ? per_call : AT_DATAGRAM_SEGMENTS;
+    if (per_call < 2) {
+        return __send_segments(socket, bytes, length, segment, to);
+    }
+    
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr = to.ip.addr;
+    address.sin_port = htons(to.port);
+    char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+    uint16_t segment_size = (uint16_t)segment;
+    
+    while (result.bytes < length) {
+        ulong chunk = length - result.bytes < per_call * segment ? length - result.bytes : per_call * segment;
+        iovec part {(void*)(bytes + result.bytes), chunk};
+        msghdr message {};
+        message.msg_name = &address;
+        message.msg_namelen = sizeof(address);
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        if (chunk > segment) {
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_UDP;
+            header->cmsg_type = UDP_SEGMENT;
+            header->cmsg_len = CMSG_LEN(sizeof(segment_size));
+            std::memcpy(CMSG_DATA(header), &segment_size, sizeof(segment_size));
+        }
+        long sent = (long)::sendmsg((int)socket.get_fd(), &message, 0);
+        if (sent >= 0) {
+            result.bytes += (ulong)sent;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP || errno == EIO) {
+            IOResult rest = __send_segments(socket, bytes + result.bytes, length - result.bytes, segment, to);
+            result.bytes += rest.bytes;
+            result.error = rest.error;
+            break;
+        }
+        result.error = errno;
+        break;
+    }
+    return result;
+#else
+    return __send_segments(socket, bytes, length, segment, to);
+#endif
+}
+
+}
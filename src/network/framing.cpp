@@ -0,0 +1,377 @@
+
+#include <algorithm>
+#include <cstring>
+#include "utils/algorithms.h"
+#include "network/framing.h"
+
+/**
+ * \internal
+ *
+ * Longest varint length prefix, enough for any 64 bit length
+ */
+#define AT_VARINT_MAX 10
+
+namespace network {
+
+frame_error::frame_error(const std::string& msg) : socket_error(msg) {}
+
+/**
+ * \internal
+ *
+ * Get the number of bytes a fixed size prefix takes
+ *
+ * \param prefix Prefix type, not VARINT
+ * \return Prefix size in bytes
+ */
+static ulong __fixed_size(LengthPrefix prefix) {
+    switch (prefix) {
+        case LengthPrefix::FIXED16:
+            return 2;
+        case LengthPrefix::FIXED32:
+            return 4;
+        default:
+            return 8;
+    }
+}
+
+/**
+ * \internal
+ *
+ * Read a little endian integer
+ */
+static ulong __read_le(const uchar* bytes, ulong size) {
+    ulong value = 0;
+    for (ulong i = 0; i < size; ++i) {
+        value |= (ulong)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * \internal
+ *
+ * Append a little endian integer to a buffer
+ */
+static void __write_le(std::vector<char>& out, ulong value, ulong size) {
+    for (ulong i = 0; i < size; ++i) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+}
+
+/**
+ * \internal
+ *
+ * Parse the length prefix at the start of some bytes
+ *
+ * \param prefix Prefix type
+ * \param bytes Start of the frame
+ * \param available Number of bytes buffered
+ * \param header Set to the size of the prefix
+ * \param length Set to the payload length
+ * \return Whether the whole prefix was buffered
+ * \throws frame_error if a varint prefix is too long
+ */
+static bool __parse_prefix(LengthPrefix prefix, const uchar* bytes, ulong available, ulong& header, ulong& length) {
+    if (prefix != LengthPrefix::VARINT) {
+        header = __fixed_size(prefix);
+        if (available < header) {
+            return false;
+        }
+        length = __read_le(bytes, header);
+        return true;
+    }
+    length = 0;
+    for (ulong i = 0; i < AT_VARINT_MAX; ++i) {
+        if (i == available) {
+            return false;
+        }
+        length |= (ulong)(bytes[i] & 0x7Fu) << (7 * i);
+        if ((bytes[i] & 0x80u) == 0) {
+            header = i + 1;
+            return true;
+        }
+    }
+    throw frame_error("Malformed varint frame length");
+}
+
+BufferPool::BufferPool(ulong buffer_size, ulong max_free) {
+    this->buffer_size = buffer_size;
+    this->max_free = max_free;
+    this->allocated = 0;
+}
+
+BufferPool::~BufferPool() {
+    for (auto buffer : free) {
+        delete[] buffer->data;
+        delete buffer;
+    }
+}
+
+__FrameBuffer* BufferPool::acquire(ulong size) {
+    __FrameBuffer* buffer;
+    if (size <= buffer_size && !free.empty()) {
+        buffer = free.back();
+        free.pop_back();
+    } else {
+        buffer = new __FrameBuffer();
+        buffer->capacity = std::max(size, buffer_size);
+        buffer->data = new char[buffer->capacity];
+        buffer->pool = this;
+    }
+    buffer->refs = 1;
+    allocated++;
+    return buffer;
+}
+
+void BufferPool::release(__FrameBuffer* buffer) {
+    if (--buffer->refs != 0) {
+        return;
+    }
+    allocated--;
+    if (buffer->capacity == buffer_size && free.size() < max_free) {
+        free.push_back(buffer);
+    } else {
+        delete[] buffer->data;
+        delete buffer;
+    }
+}
+
+ulong BufferPool::get_buffer_size() const {
+    return buffer_size;
+}
+
+ulong BufferPool::get_allocated() const {
+    return allocated;
+}
+
+ulong BufferPool::get_free() const {
+    return free.size();
+}
+
+Frame::Frame(__FrameBuffer* buffer, const char* bytes, ulong length) {
+    this->buffer = buffer;
+    this->bytes = bytes;
+    this->length = length;
+    buffer->refs++;
+}
+
+Frame::Frame() {
+    this->buffer = nullptr;
+    this->bytes = nullptr;
+    this->length = 0;
+}
+
+Frame::Frame(const Frame& other) {
+    this->buffer = other.buffer;
+    this->bytes = other.bytes;
+    this->length = other.length;
+    if (buffer != nullptr) {
+        buffer->refs++;
+    }
+}
+
+Frame::Frame(Frame&& other) noexcept {
+    this->buffer = other.buffer;
+    this->bytes = other.bytes;
+    this->length = other.length;
+    other.buffer = nullptr;
+    other.bytes = nullptr;
+    other.length = 0;
+}
+
+Frame& Frame::operator=(const Frame& other) {
+    if (this != &other) {
+        Frame copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Frame& Frame::operator=(Frame&& other) noexcept {
+    if (this != &other) {
+        if (buffer != nullptr) {
+            buffer->pool->release(buffer);
+        }
+        this->buffer = other.buffer;
+        this->bytes = other.bytes;
+        this->length = other.length;
+        other.buffer = nullptr;
+        other.bytes = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+Frame::~Frame() {
+    if (buffer != nullptr) {
+        buffer->pool->release(buffer);
+    }
+}
+
+const char* Frame::data() const {
+    return bytes;
+}
+
+ulong Frame::size() const {
+    return length;
+}
+
+std::string Frame::str() const {
+    return std::string(bytes, length);
+}
+
+FrameDecoder::FrameDecoder(BufferPool& pool, FrameOptions options) : pool(pool) {
+    this->options = options;
+    this->current = nullptr;
+    this->begin = 0;
+    this->end = 0;
+    this->expected = 0;
+}
+
+FrameDecoder::~FrameDecoder() {
+    if (current != nullptr) {
+        pool.release(current);
+    }
+}
+
+MutableBuffer FrameDecoder::prepare() {
+    if (current == nullptr) {
+        current = pool.acquire(std::max(expected, pool.get_buffer_size()));
+    }
+    if (begin == end && current->refs == 1) {
+        begin = 0;
+        end = 0;
+    }
+    if (end == current->capacity || expected > current->capacity - begin) {
+        ulong partial = end - begin;
+        ulong needed = std::max(expected, partial + 1);
+        if (current->refs == 1 && needed <= current->capacity) {
+            std::memmove(current->data, current->data + begin, partial);
+        } else {
+            __FrameBuffer* next = pool.acquire(needed);
+            std::memcpy(next->data, current->data + begin, partial);
+            pool.release(current);
+            current = next;
+        }
+        begin = 0;
+        end = partial;
+    }
+    return {current->data + end, current->capacity - end};
+}
+
+void FrameDecoder::commit(ulong bytes) {
+    end += bytes;
+}
+
+void FrameDecoder::feed(const char* bytes, ulong length) {
+    while (length > 0) {
+        MutableBuffer space = prepare();
+        ulong copied = std::min(space.length, length);
+        std::memcpy(space.data, bytes, copied);
+        commit(copied);
+        bytes += copied;
+        length -= copied;
+    }
+}
+
+IOResult FrameDecoder::read_from(Socket& socket) {
+    MutableBuffer space = prepare();
+    IOResult result = socket.recv_into(space.data, space.length);
+    commit(result.bytes);
+    return result;
+}
+
+bool FrameDecoder::next(Frame& frame) {
+    if (current == nullptr) {
+        return false;
+    }
+    const uchar* start = reinterpret_cast<const uchar*>(current->data + begin);
+    ulong header = 0;
+    ulong length = 0;
+    if (!__parse_prefix(options.prefix, start, end - begin, header, length)) {
+        return false;
+    }
+    if (length > options.max_frame) {
+        throw frame_error("Frame of " + std::to_string(length) + " bytes is over the maximum of " +
+                          std::to_string(options.max_frame));
+    }
+    ulong total = header + length + (options.checksum ? 4 : 0);
+    if (end - begin < total) {
+        expected = total;
+        return false;
+    }
+    if (options.checksum) {
+        uint stored = (uint)__read_le(start + header + length, 4);
+        if (util::crc32(start + header, length) != stored) {
+            throw frame_error("Frame checksum mismatch");
+        }
+    }
+    frame = Frame(current, current->data + begin + header, length);
+    begin += total;
+    expected = 0;
+    return true;
+}
+
+ulong FrameDecoder::get_buffered() const {
+    return end - begin;
+}
+
+FrameEncoder::FrameEncoder(FrameOptions options, ulong flush_size) {
+    this->options = options;
+    this->flush_size = flush_size;
+    this->flushed = 0;
+}
+
+void FrameEncoder::write(const char* bytes, ulong length) {
+    if (length > options.max_frame) {
+        throw frame_error("Frame of " + std::to_string(length) + " bytes is over the maximum of " +
+                          std::to_string(options.max_frame));
+    }
+    if (options.prefix == LengthPrefix::VARINT) {
+        ulong value = length;
+        while (value >= 0x80u) {
+            pending.push_back((char)(value | 0x80u));
+            value >>= 7;
+        }
+        pending.push_back((char)value);
+    } else {
+        ulong size = __fixed_size(options.prefix);
+        if (size < 8 && length >> (8 * size) != 0) {
+            throw frame_error("Frame of " + std::to_string(length) + " bytes doesn't fit its length prefix");
+        }
+        __write_le(pending, length, size);
+    }
+    pending.insert(pending.end(), bytes, bytes + length);
+    if (options.checksum) {
+        __write_le(pending, util::crc32(reinterpret_cast<const uchar*>(bytes), length), 4);
+    }
+}
+
+bool FrameEncoder::should_flush() const {
+    return get_pending() >= flush_size;
+}
+
+ulong FrameEncoder::get_pending() const {
+    return pending.size() - flushed;
+}
+
+ConstBuffer FrameEncoder::peek() const {
+    return {pending.data() + flushed, pending.size() - flushed};
+}
+
+void FrameEncoder::consume(ulong bytes) {
+    flushed += std::min(bytes, get_pending());
+    if (flushed == pending.size()) {
+        pending.clear();
+        flushed = 0;
+    }
+}
+
+IOResult FrameEncoder::flush(Socket& socket) {
+    ConstBuffer data = peek();
+    IOResult result = socket.send_all(data.data, data.length);
+    consume(result.bytes);
+    return result;
+}
+
+}
@@ -0,0 +1,265 @@
+
+#include <cerrno>
+#include "network/reactor.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace network {
+
+bool __TimerEntry::operator>(const __TimerEntry& other) const {
+    return deadline > other.deadline || (deadline == other.deadline && id > other.id);
+}
+
+#ifdef __linux__
+
+/**
+ * \internal
+ *
+ * Convert IOEvent flags to edge-triggered epoll flags
+ *
+ * \param events IOEvent flags
+ * \return epoll event mask
+ */
+static uint __epoll_flags(uint events) {
+    uint flags = EPOLLET | EPOLLRDHUP;
+    if (events & IO_READ) {
+        flags |= EPOLLIN;
+    }
+    if (events & IO_WRITE) {
+        flags |= EPOLLOUT;
+    }
+    return flags;
+}
+
+/**
+ * \internal
+ *
+ * Convert epoll flags to IOEvent flags
+ *
+ * \param flags epoll event mask
+ * \return IOEvent flags
+ */
+static uint __io_events(uint flags) {
+    uint events = 0;
+    if (flags & (EPOLLIN | EPOLLPRI)) {
+        events |= IO_READ;
+    }
+    if (flags & EPOLLOUT) {
+        events |= IO_WRITE;
+    }
+    if (flags & (EPOLLHUP | EPOLLRDHUP)) {
+        events |= IO_HANGUP;
+    }
+    if (flags & EPOLLERR) {
+        events |= IO_ERROR;
+    }
+    return events;
+}
+
+Reactor::Reactor() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        throw socket_error("Failed to create epoll instance");
+    }
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        ::close(epoll_fd);
+        throw socket_error("Failed to create reactor wakeup descriptor");
+    }
+    epoll_event event {};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+}
+
+Reactor::~Reactor() {
+    for (auto& entry : watches) {
+        delete entry.second;
+    }
+    for (auto watch : retired) {
+        delete watch;
+    }
+    ::close(wake_fd);
+    ::close(epoll_fd);
+}
+
+void Reactor::add(ulong fd, uint events, IOCallback callback) {
+    if (watches.count(fd) != 0) {
+        throw socket_error("Descriptor is already watched by this reactor");
+    }
+    __ReactorWatch* watch = new __ReactorWatch {fd, events, std::move(callback), false};
+    epoll_event event {};
+    event.events = __epoll_flags(events);
+    event.data.ptr = watch;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, (int)fd, &event) < 0) {
+        delete watch;
+        throw socket_error("Failed to watch descriptor");
+    }
+    watches[fd] = watch;
+}
+
+void Reactor::modify(ulong fd, uint events) {
+    auto found = watches.find(fd);
+    if (found == watches.end()) {
+        throw socket_error("Descriptor isn't watched by this reactor");
+    }
+    epoll_event event {};
+    event.events = __epoll_flags(events);
+    event.data.ptr = found->second;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, (int)fd, &event) < 0) {
+        throw socket_error("Failed to change watched events");
+    }
+    found->second->events = events;
+}
+
+bool Reactor::remove(ulong fd) {
+    auto found = watches.find(fd);
+    if (found == watches.end()) {
+        return false;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, (int)fd, nullptr);
+    found->second->removed = true;
+    retired.push_back(found->second);
+    watches.erase(found);
+    return true;
+}
+
+ulong Reactor::run_once(std::chrono::milliseconds timeout) {
+    epoll_event events[AT_REACTOR_EVENTS];
+    int count = epoll_wait(epoll_fd, events, AT_REACTOR_EVENTS, wait_time(timeout));
+    if (count < 0 && errno != EINTR) {
+        throw socket_error("Failed to wait for events");
+    }
+    
+    ulong handled = 0;
+    for (int i = 0; i < count; ++i) {
+        __ReactorWatch* watch = (__ReactorWatch*)events[i].data.ptr;
+        if (watch == nullptr) {
+            ulong value;
+            while (::read(wake_fd, &value, sizeof(value)) > 0) {}
+            continue;
+        }
+        if (watch->removed) {
+            continue;
+        }
+        watch->callback(__io_events(events[i].events));
+        handled++;
+    }
+    for (auto watch : retired) {
+        delete watch;
+    }
+    retired.clear();
+    return handled + run_timers();
+}
+
+void Reactor::wake() {
+    ulong value = 1;
+    while (::write(wake_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+}
+
+#else
+
+Reactor::Reactor() {
+    throw socket_error("Reactor is only supported on Linux");
+}
+
+Reactor::~Reactor() = default;
+
+void Reactor::add(ulong, uint, IOCallback) {}
+
+void Reactor::modify(ulong, uint) {}
+
+bool Reactor::remove(ulong) {
+    return false;
+}
+
+ulong Reactor::run_once(std::chrono::milliseconds) {
+    return 0;
+}
+
+void Reactor::wake() {}
+
+#endif
+
+ulong Reactor::get_watched() const {
+    return watches.size();
+}
+
+EventLoop::EventLoop() {
+    this->next_timer = 1;
+    this->stopping = false;
+}
+
+EventLoop::~EventLoop() = default;
+
+void EventLoop::add(Socket& socket, uint events, IOCallback callback) {
+    socket.set_blocking(false);
+    add(socket.get_fd(), events, std::move(callback));
+}
+
+int EventLoop::wait_time(std::chrono::milliseconds timeout) {
+    while (!timer_queue.empty() && timers.count(timer_queue.top().id) == 0) {
+        timer_queue.pop();
+    }
+    if (timer_queue.empty()) {
+        return timeout.count() < 0 ? -1 : (int)timeout.count();
+    }
+    auto until = timer_queue.top().deadline - std::chrono::steady_clock::now();
+    long due = (long)std::chrono::ceil<std::chrono::milliseconds>(until).count();
+    due = due < 0 ? 0 : due;
+    if (timeout.count() >= 0 && timeout.count() < due) {
+        due = (long)timeout.count();
+    }
+    return (int)due;
+}
+
+ulong EventLoop::run_timers() {
+    ulong ran = 0;
+    auto now = std::chrono::steady_clock::now();
+    while (!timer_queue.empty() && timer_queue.top().deadline <= now) {
+        __TimerEntry entry = timer_queue.top();
+        timer_queue.pop();
+        auto found = timers.find(entry.id);
+        if (found == timers.end()) {
+            continue;
+        }
+        TimerCallback callback = found->second.callback;
+        if (found->second.repeat.count() > 0) {
+            timer_queue.push(__TimerEntry {entry.deadline + found->second.repeat, entry.id});
+        } else {
+            timers.erase(found);
+        }
+        callback();
+        ran++;
+    }
+    return ran;
+}
+
+ulong EventLoop::add_timer(std::chrono::milliseconds delay, TimerCallback callback, std::chrono::milliseconds repeat) {
+    ulong id = next_timer++;
+    timers[id] = __ReactorTimer {std::move(callback), repeat};
+    timer_queue.push(__TimerEntry {std::chrono::steady_clock::now() + delay, id});
+    return id;
+}
+
+bool EventLoop::cancel_timer(ulong id) {
+    return timers.erase(id) != 0;
+}
+
+void EventLoop::run() {
+    while (!stopping) {
+        run_once();
+    }
+    stopping = false;
+}
+
+void EventLoop::stop() {
+    stopping = true;
+    wake();
+}
+
+}
@@ -0,0 +1,128 @@
+
+#include <algorithm>
+#include "network/sharded_server.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace network {
+
+bool pin_thread(uint index) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return false;
+    }
+    uint target = index % (uint)CPU_COUNT(&allowed);
+    for (uint cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        if (target-- == 0) {
+            cpu_set_t chosen;
+            CPU_ZERO(&chosen);
+            CPU_SET(cpu, &chosen);
+            return pthread_setaffinity_np(pthread_self(), sizeof(chosen), &chosen) == 0;
+        }
+    }
+    return false;
+#else
+    (void)index;
+    return false;
+#endif
+}
+
+ShardedServer::ShardedServer(ushort port, uint workers, LoopBackend backend) {
+    this->port = port;
+    this->workers = workers != 0 ? workers : std::max(1u, std::thread::hardware_concurrency());
+    this->backend = backend;
+    this->backlog = 1024;
+    this->pin = true;
+}
+
+ShardedServer::~ShardedServer() {
+    stop();
+}
+
+void ShardedServer::set_backlog(uint backlog) {
+    this->backlog = backlog;
+}
+
+void ShardedServer::set_pinning(bool pin) {
+    this->pin = pin;
+}
+
+void ShardedServer::start(ConnectionHandler handler) {
+    if (!running.empty()) {
+        throw socket_error("Server is already running");
+    }
+    try {
+        for (uint i = 0; i < workers; ++i) {
+            __ServerWorker* worker = new __ServerWorker();
+            running.push_back(worker);
+            worker->listener.set(SockOpt::REUSEADDR, 1);
+            worker->listener.set(SockOpt::REUSEPORT, 1);
+            worker->listener.bind(port);
+            worker->listener.listen(backlog);
+            worker->loop = make_event_loop(backend);
+        }
+    } catch (...) {
+        for (auto worker : running) {
+            delete worker->loop;
+            delete worker;
+        }
+        running.clear();
+        throw;
+    }
+    
+    for (uint i = 0; i < workers; ++i) {
+        __ServerWorker* worker = running[i];
+        worker->thread = std::thread([this, worker, handler, i]() {
+            if (pin) {
+                pin_thread(i);
+            }
+            std::vector<Socket> accepted;
+            worker->loop->add(worker->listener, IO_READ, [worker, &handler, &accepted](uint) {
+                try {
+                    worker->listener.accept_many(accepted);
+                } catch (socket_error&) {}
+                worker->accepted.fetch_add(accepted.size(), std::memory_order_relaxed);
+                for (auto& socket : accepted) {
+                    handler(*worker->loop, std::move(socket));
+                }
+                accepted.clear();
+            });
+            worker->loop->run();
+            worker->loop->remove(worker->listener.get_fd());
+        });
+    }
+}
+
+void ShardedServer::stop() {
+    for (auto worker : running) {
+        worker->loop->stop();
+    }
+    for (auto worker : running) {
+        worker->thread.join();
+        delete worker->loop;
+        delete worker;
+    }
+    running.clear();
+}
+
+uint ShardedServer::get_workers() const {
+    return workers;
+}
+
+std::vector<ulong> ShardedServer::get_accepted() const {
+    std::vector<ulong> counts;
+    for (auto worker : running) {
+        counts.push_back(worker->accepted.load(std::memory_order_relaxed));
+    }
+    return counts;
+}
+
+}
@@ -1,42 +1,204 @@
 
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
 #include "network/socket.h"
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#endif
+
 #ifdef _WIN32
 #define setsockopt(s, level, optname, optval, oplen) setsockopt(s, level, optname, (const char*)optval, oplen)
 #define getsockopt(s, level, optname, optval, oplen) getsockopt(s, level, optname, (char*)optval, oplen)
 #endif
 
+#ifdef MSG_NOSIGNAL
+#define AT_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define AT_SEND_FLAGS 0
+#endif
+
 namespace network {
 
+static const ulong invalid_socket = ~(ulong)0;
+
 socket_error::socket_error(const std::string& msg) : runtime_error(msg) {}
 
+/**
+ * \internal
+ *
+ * Get the error code of the last failed socket call
+ *
+ * \return Error code, comparable to errno values
+ */
+static int __last_error() {
+#ifdef _WIN32
+    int error = WSAGetLastError();
+    return error == WSAEWOULDBLOCK ? EWOULDBLOCK : error;
+#else
+    return errno;
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Wait for a descriptor to become readable
+ *
+ * \param fd Descriptor to wait on
+ * \param timeout Milliseconds to wait
+ * \return Whether the descriptor is readable, or has hung up or failed
+ */
+static bool __wait_readable(ulong fd, int timeout) {
+#ifdef _WIN32
+    WSAPOLLFD poll_fd {(SOCKET)fd, POLLRDNORM, 0};
+    return WSAPoll(&poll_fd, 1, timeout) > 0;
+#else
+    pollfd poll_fd {(int)fd, POLLIN, 0};
+    int ready;
+    do {
+        ready = ::poll(&poll_fd, 1, timeout);
+    } while (ready < 0 && errno == EINTR);
+    return ready > 0;
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Make one vectored send of a list of buffers, skipping some bytes at the start of the first
+ *
+ * \param fd Socket to send on
+ * \param buffers Buffers to send
+ * \param count Number of buffers
+ * \param offset Bytes of the first buffer already sent
+ * \param flags Flags for the system call
+ * \return Bytes sent and errno
+ */
+static IOResult __send_buffers(ulong fd, const ConstBuffer* buffers, ulong count, ulong offset, int flags) {
+    ulong used = count < AT_IOV_BATCH ? count : AT_IOV_BATCH;
+    IOResult result;
+#ifdef _WIN32
+    WSABUF parts[AT_IOV_BATCH];
+    for (ulong i = 0; i < used; ++i) {
+        parts[i].buf = (CHAR*)buffers[i].data;
+        parts[i].len = (ULONG)buffers[i].length;
+    }
+    parts[0].buf += offset;
+    parts[0].len -= (ULONG)offset;
+    DWORD sent = 0;
+    if (WSASend((SOCKET)fd, parts, (DWORD)used, &sent, (DWORD)flags, nullptr, nullptr) != 0) {
+        result.error = __last_error();
+    }
+    result.bytes = sent;
+#else
+    iovec parts[AT_IOV_BATCH];
+    for (ulong i = 0; i < used; ++i) {
+        parts[i].iov_base = (void*)buffers[i].data;
+        parts[i].iov_len = buffers[i].length;
+    }
+    parts[0].iov_base = (char*)parts[0].iov_base + offset;
+    parts[0].iov_len -= offset;
+    msghdr message {};
+    message.msg_iov = parts;
+    message.msg_iovlen = used;
+    while (true) {
+        long sent = (long)::sendmsg((int)fd, &message, flags | AT_SEND_FLAGS);
+        if (sent >= 0) {
+            result.bytes = (ulong)sent;
+            break;
+        }
+        if (errno != EINTR) {
+            result.error = errno;
+            break;
+        }
+    }
+#endif
+    return result;
+}
+
 
 bind_error::bind_error(int errnum, const std::string& msg) : socket_error(msg) {
     this->errnum = errnum;
 }
 
 
-const SockOpt SockOpt::DEBUG = SockOpt("Debug", SO_DEBUG, sizeof(int));
-const SockOpt SockOpt::BROADCAST = SockOpt("Broadcast", SO_BROADCAST, sizeof(int));
-const SockOpt SockOpt::REUSEADDR = SockOpt("Reuse Address", SO_REUSEADDR, sizeof(int));
-const SockOpt SockOpt::KEEPALIVE = SockOpt("Keep Alive", SO_KEEPALIVE, sizeof(int));
-const SockOpt SockOpt::LINGER = SockOpt("Linger", SO_LINGER, sizeof(linger));
-const SockOpt SockOpt::OOBINLINE = SockOpt("Out of Band inline", SO_OOBINLINE, sizeof(int));
-const SockOpt SockOpt::SNDBUF = SockOpt("Send Buffer Size", SO_SNDBUF, sizeof(int));
-const SockOpt SockOpt::RCVBUF = SockOpt("Receive Buffer Size", SO_RCVBUF, sizeof(int));
-const SockOpt SockOpt::DONTROUTE = SockOpt("Don't Route", SO_DONTROUTE, sizeof(int));
-const SockOpt SockOpt::RCVLOWAT = SockOpt("Receive Low Accept", SO_RCVLOWAT, sizeof(int));
-const SockOpt SockOpt::RCVTIMEO = SockOpt("Receive Timeout", SO_RCVTIMEO, sizeof(timeval));
-const SockOpt SockOpt::SNDLOWAT = SockOpt("Send Low Accept", SO_SNDLOWAT, sizeof(int));
-const SockOpt SockOpt::SNDTIMEO = SockOpt("Send Timeout", SO_SNDTIMEO, sizeof(timeval));
+#ifdef SO_REUSEPORT
+#define AT_SO_REUSEPORT SO_REUSEPORT
+#else
+#define AT_SO_REUSEPORT -1
+#endif
+
+#ifdef SO_BUSY_POLL
+#define AT_SO_BUSY_POLL SO_BUSY_POLL
+#else
+#define AT_SO_BUSY_POLL -1
+#endif
+
+#ifdef TCP_QUICKACK
+#define AT_TCP_QUICKACK TCP_QUICKACK
+#else
+#define AT_TCP_QUICKACK -1
+#endif
 
-SockOpt::SockOpt(const char* name, int sock_name, socklen_t length) noexcept {
+#ifdef TCP_FASTOPEN
+#define AT_TCP_FASTOPEN TCP_FASTOPEN
+#else
+#define AT_TCP_FASTOPEN -1
+#endif
+
+#ifdef UDP_SEGMENT
+#define AT_UDP_SEGMENT UDP_SEGMENT
+#else
+#define AT_UDP_SEGMENT -1
+#endif
+
+#ifdef UDP_GRO
+#define AT_UDP_GRO UDP_GRO
+#else
+#define AT_UDP_GRO -1
+#endif
+
+const TypedSockOpt<int> SockOpt::DEBUG = TypedSockOpt<int>("Debug", SOL_SOCKET, SO_DEBUG);
+const TypedSockOpt<int> SockOpt::BROADCAST = TypedSockOpt<int>("Broadcast", SOL_SOCKET, SO_BROADCAST);
+const TypedSockOpt<int> SockOpt::REUSEADDR = TypedSockOpt<int>("Reuse Address", SOL_SOCKET, SO_REUSEADDR);
+const TypedSockOpt<int> SockOpt::KEEPALIVE = TypedSockOpt<int>("Keep Alive", SOL_SOCKET, SO_KEEPALIVE);
+const TypedSockOpt<linger> SockOpt::LINGER = TypedSockOpt<linger>("Linger", SOL_SOCKET, SO_LINGER);
+const TypedSockOpt<int> SockOpt::OOBINLINE = TypedSockOpt<int>("Out of Band inline", SOL_SOCKET, SO_OOBINLINE);
+const TypedSockOpt<int> SockOpt::SNDBUF = TypedSockOpt<int>("Send Buffer Size", SOL_SOCKET, SO_SNDBUF);
+const TypedSockOpt<int> SockOpt::RCVBUF = TypedSockOpt<int>("Receive Buffer Size", SOL_SOCKET, SO_RCVBUF);
+const TypedSockOpt<int> SockOpt::DONTROUTE = TypedSockOpt<int>("Don't Route", SOL_SOCKET, SO_DONTROUTE);
+const TypedSockOpt<int> SockOpt::RCVLOWAT = TypedSockOpt<int>("Receive Low Accept", SOL_SOCKET, SO_RCVLOWAT);
+const TypedSockOpt<timeval> SockOpt::RCVTIMEO = TypedSockOpt<timeval>("Receive Timeout", SOL_SOCKET, SO_RCVTIMEO);
+const TypedSockOpt<int> SockOpt::SNDLOWAT = TypedSockOpt<int>("Send Low Accept", SOL_SOCKET, SO_SNDLOWAT);
+const TypedSockOpt<timeval> SockOpt::SNDTIMEO = TypedSockOpt<timeval>("Send Timeout", SOL_SOCKET, SO_SNDTIMEO);
+const TypedSockOpt<int> SockOpt::REUSEPORT = TypedSockOpt<int>("Reuse Port", SOL_SOCKET, AT_SO_REUSEPORT);
+const TypedSockOpt<int> SockOpt::BUSY_POLL = TypedSockOpt<int>("Busy Poll", SOL_SOCKET, AT_SO_BUSY_POLL);
+const TypedSockOpt<int> SockOpt::NODELAY = TypedSockOpt<int>("No Delay", IPPROTO_TCP, TCP_NODELAY);
+const TypedSockOpt<int> SockOpt::QUICKACK = TypedSockOpt<int>("Quick Ack", IPPROTO_TCP, AT_TCP_QUICKACK);
+const TypedSockOpt<int> SockOpt::FASTOPEN = TypedSockOpt<int>("Fast Open", IPPROTO_TCP, AT_TCP_FASTOPEN);
+const TypedSockOpt<int> SockOpt::SEGMENT = TypedSockOpt<int>("UDP Segment", IPPROTO_UDP, AT_UDP_SEGMENT);
+const TypedSockOpt<int> SockOpt::GRO = TypedSockOpt<int>("UDP Receive Offload", IPPROTO_UDP, AT_UDP_GRO);
+
+SockOpt::SockOpt(const char* name, int sock_name, socklen_t length) noexcept :
+    SockOpt(name, SOL_SOCKET, sock_name, length) {}
+
+SockOpt::SockOpt(const char* name, int level, int sock_name, socklen_t length) noexcept {
     this->name = name;
+    this->level = level;
     this->sock_name = sock_name;
     this->length = length;
 }
 
-
 IPAddr::IPAddr(const std::string& text) : addr() {
     this->text = text;
     inet_pton(AF_INET, text.c_str(), &addr);
@@ -50,6 +212,19 @@ IPAddr::IPAddr(const in_addr& addr) : addr() {
 }
 
 
+Endpoint::Endpoint() : ip(in_addr()) {
+    this->port = 0;
+}
+
+Endpoint::Endpoint(const IPAddr& ip, ushort port) : ip(ip) {
+    this->port = port;
+}
+
+Endpoint::Endpoint(const std::string& ip, ushort port) : ip(ip) {
+    this->port = port;
+}
+
+
 static void __setup_sockets() {
 #if defined(_WIN32)
     WSADATA wsadata;
@@ -70,6 +245,57 @@ static void __teardown_sockets() {
 }
 
 
+/**
+ * \internal
+ *
+ * Build a Unix domain address for a filesystem path, or an abstract name if the path starts with a null byte
+ *
+ * \param path Path of the socket
+ * \param length Set to the length of the address
+ * \return New address, owned by the caller, to be freed with __free_addr
+ */
+static sockaddr* __unix_addr(const std::string& path, socklen_t& length) {
+#ifdef _WIN32
+    (void)path;
+    (void)length;
+    throw socket_error("Unix domain sockets aren't supported on this platform");
+#else
+    bool abstract = !path.empty() && path[0] == '\0';
+    sockaddr_un* addr_un = new sockaddr_un();
+    if (path.size() + (abstract ? 0 : 1) > sizeof(addr_un->sun_path)) {
+        delete addr_un;
+        throw socket_error("Unix socket path too long: " + path);
+    }
+    addr_un->sun_family = AF_UNIX;
+    std::memcpy(addr_un->sun_path, path.data(), path.size());
+    // Abstract names are exactly as long as given, with no terminator
+    length = (socklen_t)(offsetof(sockaddr_un, sun_path) + path.size() + (abstract ? 0 : 1));
+    return reinterpret_cast<sockaddr*>(addr_un);
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Free an address built for bind or connect, as the type it was allocated as
+ *
+ * \param addr Address to free, or nullptr
+ */
+static void __free_addr(sockaddr* addr) {
+#ifndef _WIN32
+    if (addr != nullptr && addr->sa_family == AF_UNIX) {
+        delete reinterpret_cast<sockaddr_un*>(addr);
+        return;
+    }
+#endif
+    delete reinterpret_cast<sockaddr_in*>(addr);
+}
+
+std::string abstract_name(const std::string& name) {
+    return std::string(1, '\0') + name;
+}
+
+
 Socket::Socket(ulong sockfd, ushort domain, uint type) {
     __setup_sockets();
     this->addr = nullptr;
@@ -85,22 +311,113 @@ Socket::Socket(ushort domain, uint type) {
     this->type = type;
     
     sockfd = (ulong)socket(domain, type, 0);
-    if (sockfd == 0) {
+    if (sockfd == invalid_socket) {
         throw socket_error("Failed to create socket");
     }
 }
 
+Socket::Socket(Socket&& other) noexcept {
+    __setup_sockets();
+    this->addr = other.addr;
+    this->sockfd = other.sockfd;
+    this->domain = other.domain;
+    this->type = other.type;
+    other.addr = nullptr;
+    other.sockfd = invalid_socket;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        if (sockfd != invalid_socket) {
+#ifdef _WIN32
+            closesocket(sockfd);
+#else
+            ::close((int)sockfd);
+#endif
+        }
+        __free_addr(addr);
+        this->addr = other.addr;
+        this->sockfd = other.sockfd;
+        this->domain = other.domain;
+        this->type = other.type;
+        other.addr = nullptr;
+        other.sockfd = invalid_socket;
+    }
+    return *this;
+}
+
 Socket::~Socket() {
-    delete addr;
+    if (sockfd != invalid_socket) {
+#ifdef _WIN32
+        closesocket(sockfd);
+#else
+        ::close((int)sockfd);
+#endif
+    }
+    __free_addr(addr);
     __teardown_sockets();
 }
 
+std::pair<Socket, Socket> Socket::pair(uint type) {
+#ifdef _WIN32
+    (void)type;
+    throw socket_error("Socket pairs aren't supported on this platform");
+#else
+    int fds[2];
+    if (::socketpair(AF_UNIX, (int)type, 0, fds) < 0) {
+        throw socket_error("Failed to create socket pair");
+    }
+    return {Socket((ulong)fds[0], AF_UNIX, type), Socket((ulong)fds[1], AF_UNIX, type)};
+#endif
+}
+
+Socket Socket::adopt(ulong fd) {
+    int domain = AF_INET;
+    int type = SOCK_STREAM;
+#if defined(SO_DOMAIN)
+    socklen_t length = sizeof(domain);
+    ::getsockopt((int)fd, SOL_SOCKET, SO_DOMAIN, &domain, &length);
+#endif
+    socklen_t type_length = sizeof(type);
+    getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_length);
+    return Socket(fd, (ushort)domain, (uint)type);
+}
+
+ulong Socket::get_fd() const {
+    return sockfd;
+}
+
+void Socket::set_blocking(bool blocking) {
+#ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+    if (ioctlsocket(sockfd, FIONBIO, &mode) != 0) {
+        throw socket_error("Failed to set socket blocking mode");
+    }
+#else
+    int flags = fcntl((int)sockfd, F_GETFL, 0);
+    flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+    if (flags < 0 || fcntl((int)sockfd, F_SETFL, flags) < 0) {
+        throw socket_error("Failed to set socket blocking mode");
+    }
+#endif
+}
+
 void Socket::setopt(SockOpt option, const void* val) {
-    setsockopt(sockfd, SOL_SOCKET, option.sock_name, val, option.length);
+    if (option.sock_name < 0) {
+        throw socket_error(option.name + " isn't supported on this platform");
+    }
+    if (setsockopt(sockfd, option.level, option.sock_name, val, option.length) < 0) {
+        throw socket_error("Failed to set socket option " + option.name);
+    }
 }
 
 void Socket::getopt(SockOpt option, void* val) {
-    getsockopt(sockfd, SOL_SOCKET, option.sock_name, val, &option.length);
+    if (option.sock_name < 0) {
+        throw socket_error(option.name + " isn't supported on this platform");
+    }
+    if (getsockopt(sockfd, option.level, option.sock_name, val, &option.length) < 0) {
+        throw socket_error("Failed to get socket option " + option.name);
+    }
 }
 
 void Socket::bind(ushort port) {
@@ -109,6 +426,7 @@ void Socket::bind(ushort port) {
     addr_in->sin_addr.s_addr = INADDR_ANY;
     addr_in->sin_port = htons(port);
     
+    __free_addr(this->addr);
     this->addr = reinterpret_cast<sockaddr*>(addr_in);
     
     if (::bind(sockfd, this->addr, sizeof(*addr_in)) < 0) {
@@ -116,6 +434,17 @@ void Socket::bind(ushort port) {
     }
 }
 
+void Socket::bind(const std::string& path) {
+    socklen_t length = 0;
+    sockaddr* addr_un = __unix_addr(path, length);
+    __free_addr(this->addr);
+    this->addr = addr_un;
+    
+    if (::bind(sockfd, this->addr, length) < 0) {
+        throw bind_error(errno, "Failed to bind socket to " + path);
+    }
+}
+
 void Socket::connect(const std::string& ip, ushort port) {
     connect(IPAddr(ip), port);
 }
@@ -126,6 +455,7 @@ void Socket::connect(IPAddr ip, ushort port) {
     addr_in->sin_addr = ip.addr;
     addr_in->sin_port = htons(port);
     
+    __free_addr(this->addr);
     this->addr = reinterpret_cast<sockaddr*>(addr_in);
     
     if (::connect(sockfd, this->addr, sizeof(*addr_in)) < 0) {
@@ -133,6 +463,17 @@ void Socket::connect(IPAddr ip, ushort port) {
     }
 }
 
+void Socket::connect(const std::string& path) {
+    socklen_t length = 0;
+    sockaddr* addr_un = __unix_addr(path, length);
+    __free_addr(this->addr);
+    this->addr = addr_un;
+    
+    if (::connect(sockfd, this->addr, length) < 0) {
+        throw socket_error("Failed to connect socket to " + path);
+    }
+}
+
 void Socket::listen(uint backlog) {
     if (::listen(sockfd, backlog) < 0) {
         throw socket_error("Failed to listen to socket");
@@ -145,14 +486,372 @@ Socket Socket::accept() {
     return Socket(accepted, domain, type);
 }
 
+ulong Socket::accept_many(std::vector<Socket>& out, ulong max) {
+    ulong accepted = 0;
+    while (accepted < max) {
+#ifdef __linux__
+        long fd = (long)::accept4((int)sockfd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+        long fd = (long)::accept(sockfd, nullptr, nullptr);
+#endif
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            throw socket_error("Failed to accept on socket");
+        }
+        out.push_back(Socket((ulong)fd, domain, type));
+#ifndef __linux__
+        out.back().set_blocking(false);
+#endif
+        accepted++;
+    }
+    return accepted;
+}
+
+bool IOResult::ok() const {
+    return error == 0;
+}
+
+bool IOResult::would_block() const {
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
 const char* Socket::recv(uint size) {
     char* buffer = new char[size];
     ::recv(sockfd, buffer, size, 0);
     return buffer;
 }
 
+uint Socket::recv(char* buffer, uint size) {
+    IOResult result = recv_into(buffer, size);
+    if (!result.ok()) {
+        throw socket_error("Failed to receive on socket");
+    }
+    return (uint)result.bytes;
+}
+
 void Socket::send(const char* bytes, uint length) {
-    ::send(sockfd, bytes, length, 0);
+    if (!send_all(bytes, length).ok()) {
+        throw socket_error("Failed to send on socket");
+    }
+}
+
+IOResult Socket::recv_into(char* buffer, ulong length, int flags) {
+    IOResult result;
+    while (true) {
+        long received = (long)::recv(sockfd, buffer, length, flags);
+        if (received >= 0) {
+            result.bytes = (ulong)received;
+            return result;
+        }
+        result.error = __last_error();
+        if (result.error != EINTR) {
+            return result;
+        }
+        result.error = 0;
+    }
+}
+
+IOResult Socket::recv_exact(char* buffer, ulong length) {
+    IOResult result;
+    while (result.bytes < length) {
+        IOResult part = recv_into(buffer + result.bytes, length - result.bytes);
+        result.bytes += part.bytes;
+        if (!part.ok()) {
+            result.error = part.error;
+            break;
+        }
+        if (part.bytes == 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+IOResult Socket::recv_exact(char* buffer, ulong length, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    IOResult result;
+    while (result.bytes < length) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()
+        );
+        if (remaining.count() < 0 || !__wait_readable(sockfd, (int)remaining.count())) {
+            result.error = ETIMEDOUT;
+            break;
+        }
+        IOResult part = recv_into(buffer + result.bytes, length - result.bytes);
+        result.bytes += part.bytes;
+        if (part.would_block()) {
+            continue;
+        }
+        if (!part.ok() || part.bytes == 0) {
+            result.error = part.error;
+            break;
+        }
+    }
+    return result;
+}
+
+IOResult Socket::send_some(const char* bytes, ulong length, int flags) {
+    IOResult result;
+    while (true) {
+        long sent = (long)::send(sockfd, bytes, length, flags | AT_SEND_FLAGS);
+        if (sent >= 0) {
+            result.bytes = (ulong)sent;
+            return result;
+        }
+        result.error = __last_error();
+        if (result.error != EINTR) {
+            return result;
+        }
+        result.error = 0;
+    }
+}
+
+IOResult Socket::send_to(const char* bytes, ulong length, const Endpoint& to, int flags) {
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_addr = to.ip.addr;
+    address.sin_port = htons(to.port);
+    IOResult result;
+    while (true) {
+        long sent = (long)::sendto(sockfd, bytes, length, flags | AT_SEND_FLAGS,
+                                   reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        if (sent >= 0) {
+            result.bytes = (ulong)sent;
+            return result;
+        }
+        result.error = __last_error();
+        if (result.error != EINTR) {
+            return result;
+        }
+        result.error = 0;
+    }
+}
+
+IOResult Socket::recv_from(char* buffer, ulong length, Endpoint& from, int flags) {
+    sockaddr_in address {};
+    socklen_t address_length = sizeof(address);
+    IOResult result;
+    while (true) {
+        long received = (long)::recvfrom(sockfd, buffer, length, flags, reinterpret_cast<sockaddr*>(&address),
+                                         &address_length);
+        if (received >= 0) {
+            result.bytes = (ulong)received;
+            from = Endpoint(IPAddr(address.sin_addr), ntohs(address.sin_port));
+            return result;
+        }
+        result.error = __last_error();
+        if (result.error != EINTR) {
+            return result;
+        }
+        result.error = 0;
+    }
+}
+
+IOResult Socket::send_all(const char* bytes, ulong length) {
+    IOResult result;
+    while (result.bytes < length) {
+        IOResult part = send_some(bytes + result.bytes, length - result.bytes);
+        result.bytes += part.bytes;
+        if (!part.ok()) {
+            result.error = part.error;
+            break;
+        }
+    }
+    return result;
+}
+
+IOResult Socket::send_vectored(const ConstBuffer* buffers, ulong count, int flags) {
+    if (count == 0) {
+        return IOResult();
+    }
+    return __send_buffers(sockfd, buffers, count, 0, flags);
+}
+
+IOResult Socket::send_vectored(std::initializer_list<ConstBuffer> buffers, int flags) {
+    return send_vectored(buffers.begin(), buffers.size(), flags);
+}
+
+IOResult Socket::send_all_vectored(const ConstBuffer* buffers, ulong count, int flags) {
+    IOResult result;
+    ulong offset = 0;
+    while (count > 0) {
+        if (offset == buffers->length) {
+            ++buffers;
+            --count;
+            offset = 0;
+            continue;
+        }
+        IOResult part = __send_buffers(sockfd, buffers, count, offset, flags);
+        result.bytes += part.bytes;
+        if (!part.ok()) {
+            result.error = part.error;
+            break;
+        }
+        offset += part.bytes;
+        while (count > 0 && offset >= buffers->length) {
+            offset -= buffers->length;
+            ++buffers;
+            --count;
+        }
+    }
+    return result;
+}
+
+IOResult Socket::recv_vectored(const MutableBuffer* buffers, ulong count, int flags) {
+    ulong used = count < AT_IOV_BATCH ? count : AT_IOV_BATCH;
+    IOResult result;
+#ifdef _WIN32
+    WSABUF parts[AT_IOV_BATCH];
+    for (ulong i = 0; i < used; ++i) {
+        parts[i].buf = buffers[i].data;
+        parts[i].len = (ULONG)buffers[i].length;
+    }
+    DWORD received = 0;
+    DWORD recv_flags = (DWORD)flags;
+    if (WSARecv((SOCKET)sockfd, parts, (DWORD)used, &received, &recv_flags, nullptr, nullptr) != 0) {
+        result.error = __last_error();
+    }
+    result.bytes = received;
+#else
+    iovec parts[AT_IOV_BATCH];
+    for (ulong i = 0; i < used; ++i) {
+        parts[i].iov_base = buffers[i].data;
+        parts[i].iov_len = buffers[i].length;
+    }
+    msghdr message {};
+    message.msg_iov = parts;
+    message.msg_iovlen = used;
+    while (true) {
+        long received = (long)::recvmsg((int)sockfd, &message, flags);
+        if (received >= 0) {
+            result.bytes = (ulong)received;
+            break;
+        }
+        if (errno != EINTR) {
+            result.error = errno;
+            break;
+        }
+    }
+#endif
+    return result;
+}
+
+IOResult Socket::send_fds(const char* bytes, ulong length, const int* fds, ulong count) {
+    IOResult result;
+#ifdef _WIN32
+    (void)bytes;
+    (void)length;
+    (void)fds;
+    (void)count;
+    result.error = EOPNOTSUPP;
+#else
+    if (count > AT_MAX_FDS || length == 0) {
+        result.error = EINVAL;
+        return result;
+    }
+    iovec part {(void*)bytes, length};
+    msghdr message {};
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * count));
+    if (count > 0) {
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        std::memcpy(CMSG_DATA(header), fds, sizeof(int) * count);
+    }
+    while (true) {
+        long sent = (long)::sendmsg((int)sockfd, &message, AT_SEND_FLAGS);
+        if (sent >= 0) {
+            result.bytes = (ulong)sent;
+            break;
+        }
+        if (errno != EINTR) {
+            result.error = errno;
+            break;
+        }
+    }
+#endif
+    return result;
+}
+
+IOResult Socket::recv_fds(char* buffer, ulong length, std::vector<int>& fds) {
+    IOResult result;
+#ifdef _WIN32
+    (void)buffer;
+    (void)length;
+    (void)fds;
+    result.error = EOPNOTSUPP;
+#else
+    iovec part {buffer, length};
+    msghdr message {};
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * AT_MAX_FDS));
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+#ifdef MSG_CMSG_CLOEXEC
+    int flags = MSG_CMSG_CLOEXEC;
+#else
+    int flags = 0;
+#endif
+    while (true) {
+        long received = (long)::recvmsg((int)sockfd, &message, flags);
+        if (received >= 0) {
+            result.bytes = (ulong)received;
+            break;
+        }
+        if (errno != EINTR) {
+            result.error = errno;
+            return result;
+        }
+    }
+    // Descriptors that didn't fit were closed by the kernel, so the caller must be told some are missing
+    if (message.msg_flags & MSG_CTRUNC) {
+        result.error = EMSGSIZE;
+    }
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        ulong count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (ulong i = 0; i < count; ++i) {
+            int fd;
+            std::memcpy(&fd, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+#ifndef MSG_CMSG_CLOEXEC
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+            fds.push_back(fd);
+        }
+    }
+#endif
+    return result;
+}
+
+void Socket::set_cork(bool corked) {
+    int value = corked ? 1 : 0;
+#if defined(TCP_CORK)
+    int option = TCP_CORK;
+#elif defined(TCP_NOPUSH)
+    int option = TCP_NOPUSH;
+#else
+    (void)value;
+    throw socket_error("Corking isn't supported on this platform");
+#endif
+#if defined(TCP_CORK) || defined(TCP_NOPUSH)
+    if (setsockopt(sockfd, IPPROTO_TCP, option, &value, sizeof(value)) < 0) {
+        throw socket_error("Failed to set socket cork");
+    }
+#endif
 }
 
 void Socket::close() {
@@ -163,4 +862,14 @@ void Socket::shutdown(int how) {
     ::shutdown(sockfd, how);
 }
 
+CorkGuard::CorkGuard(Socket& socket) : socket(socket) {
+    socket.set_cork(true);
+}
+
+CorkGuard::~CorkGuard() {
+    try {
+        socket.set_cork(false);
+    } catch (socket_error&) {}
+}
+
 }
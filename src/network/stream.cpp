@@ -0,0 +1,116 @@
+
+#include <algorithm>
+#include <cstring>
+#include "network/stream.h"
+
+namespace network {
+
+SocketBuffer::SocketBuffer(Socket& socket, ulong in_size, ulong out_size) : socket(socket) {
+    this->in_size = std::max(in_size, 1ul);
+    this->out_size = std::max(out_size, 1ul);
+    in_buffer = new char[this->in_size];
+    out_buffer = new char[this->out_size];
+    setg(in_buffer, in_buffer, in_buffer);
+    setp(out_buffer, out_buffer + this->out_size);
+}
+
+SocketBuffer::~SocketBuffer() {
+    flush_out();
+    delete[] in_buffer;
+    delete[] out_buffer;
+}
+
+bool SocketBuffer::flush_out() {
+    ulong pending = (ulong)(pptr() - pbase());
+    if (pending == 0) {
+        return true;
+    }
+    IOResult result = socket.send_all(pbase(), pending);
+    setp(out_buffer, out_buffer + out_size);
+    return result.ok();
+}
+
+SocketBuffer::int_type SocketBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+    IOResult result = socket.recv_into(in_buffer, in_size);
+    if (result.bytes == 0) {
+        setg(in_buffer, in_buffer, in_buffer);
+        return traits_type::eof();
+    }
+    setg(in_buffer, in_buffer, in_buffer + result.bytes);
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize SocketBuffer::xsgetn(char* s, std::streamsize n) {
+    std::streamsize done = 0;
+    while (done < n) {
+        std::streamsize buffered = egptr() - gptr();
+        if (buffered > 0) {
+            std::streamsize taken = std::min(buffered, n - done);
+            std::memcpy(s + done, gptr(), (ulong)taken);
+            gbump((int)taken);
+            done += taken;
+            continue;
+        }
+        if ((ulong)(n - done) >= in_size) {
+            IOResult result = socket.recv_into(s + done, (ulong)(n - done));
+            if (result.bytes == 0) {
+                break;
+            }
+            done += (std::streamsize)result.bytes;
+        } else if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+            break;
+        }
+    }
+    return done;
+}
+
+std::streamsize SocketBuffer::showmanyc() {
+    return egptr() - gptr();
+}
+
+SocketBuffer::int_type SocketBuffer::overflow(int_type ch) {
+    if (!flush_out()) {
+        return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize SocketBuffer::xsputn(const char* s, std::streamsize n) {
+    ulong space = (ulong)(epptr() - pptr());
+    if ((ulong)n <= space) {
+        std::memcpy(pptr(), s, (ulong)n);
+        pbump((int)n);
+        return n;
+    }
+    if ((ulong)n < out_size) {
+        if (!flush_out()) {
+            return 0;
+        }
+        std::memcpy(pptr(), s, (ulong)n);
+        pbump((int)n);
+        return n;
+    }
+    ulong pending = (ulong)(pptr() - pbase());
+    ConstBuffer parts[] = {{pbase(), pending}, {s, (ulong)n}};
+    IOResult result = socket.send_all_vectored(parts, 2);
+    setp(out_buffer, out_buffer + out_size);
+    return result.bytes > pending ? (std::streamsize)(result.bytes - pending) : 0;
+}
+
+int SocketBuffer::sync() {
+    return flush_out() ? 0 : -1;
+}
+
+SocketStream::SocketStream(Socket& socket, ulong in_size, ulong out_size) :
+    std::iostream(nullptr), buffer(socket, in_size, out_size) {
+    rdbuf(&buffer);
+}
+
+}
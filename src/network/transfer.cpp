@@ -0,0 +1,301 @@
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include "network/transfer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace network {
+
+/**
+ * \internal
+ *
+ * Read from a file at an offset, without moving its file position where possible
+ *
+ * \param fd File to read
+ * \param buffer Buffer to read into
+ * \param length Most bytes to read
+ * \param offset Offset in the file
+ * \return Bytes read, 0 at the end of the file, or -1 on error
+ */
+static long __read_at(int fd, char* buffer, ulong length, ulong offset) {
+#ifdef _WIN32
+    if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0) {
+        return -1;
+    }
+    return (long)_read(fd, buffer, (uint)length);
+#else
+    long count;
+    do {
+        count = (long)::pread(fd, buffer, length, (off_t)offset);
+    } while (count < 0 && errno == EINTR);
+    return count;
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Send a file range by reading it into a stack buffer and sending that, for when sendfile can't be used
+ *
+ * \param socket Socket to send to
+ * \param file_fd File to send from
+ * \param offset Offset to start at
+ * \param length Bytes to send
+ * \return Bytes sent and errno
+ */
+static IOResult __send_file_copy(Socket& socket, int file_fd, ulong offset, ulong length) {
+    char buffer[AT_TRANSFER_CHUNK];
+    IOResult result;
+    while (result.bytes < length) {
+        ulong wanted = length - result.bytes < sizeof(buffer) ? length - result.bytes : sizeof(buffer);
+        long count = __read_at(file_fd, buffer, wanted, offset + result.bytes);
+        if (count <= 0) {
+            result.error = count < 0 ? errno : 0;
+            break;
+        }
+        IOResult sent = socket.send_all(buffer, (ulong)count);
+        result.bytes += sent.bytes;
+        if (!sent.ok()) {
+            result.error = sent.error;
+            break;
+        }
+    }
+    return result;
+}
+
+IOResult send_file(Socket& socket, int file_fd, ulong offset, ulong length) {
+#ifdef __linux__
+    IOResult result;
+    while (result.bytes < length) {
+        off_t position = (off_t)(offset + result.bytes);
+        long sent = (long)::sendfile((int)socket.get_fd(), file_fd, &position, length - result.bytes);
+        if (sent > 0) {
+            result.bytes += (ulong)sent;
+            continue;
+        }
+        if (sent == 0) {
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if ((errno == EINVAL || errno == ENOSYS) && result.bytes == 0) {
+            return __send_file_copy(socket, file_fd, offset, length);
+        }
+        result.error = errno;
+        break;
+    }
+    return result;
+#else
+    return __send_file_copy(socket, file_fd, offset, length);
+#endif
+}
+
+IOResult send_file(Socket& socket, const std::string& path, ulong offset) {
+#ifdef _WIN32
+    int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file to send: " + path);
+    }
+#ifdef _WIN32
+    ulong size = (ulong)_lseeki64(fd, 0, SEEK_END);
+#else
+    ulong size = (ulong)::lseek(fd, 0, SEEK_END);
+#endif
+    IOResult result = send_file(socket, fd, offset, offset < size ? size - offset : 0);
+#ifdef _WIN32
+    _close(fd);
+#else
+    ::close(fd);
+#endif
+    return result;
+}
+
+Pipe::Pipe(ulong capacity) {
+    read_fd = -1;
+    write_fd = -1;
+    buffered = 0;
+    fallback_start = 0;
+#ifdef __linux__
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        throw socket_error("Failed to create pipe");
+    }
+    read_fd = fds[0];
+    write_fd = fds[1];
+    if (capacity != 0) {
+        ::fcntl(write_fd, F_SETPIPE_SZ, (int)capacity);
+    }
+    this->capacity = (ulong)::fcntl(write_fd, F_GETPIPE_SZ);
+    copying = false;
+#else
+    this->capacity = capacity != 0 ? capacity : AT_TRANSFER_CHUNK;
+    copying = true;
+    fallback.resize(this->capacity);
+#endif
+}
+
+Pipe::~Pipe() {
+#ifdef __linux__
+    ::close(read_fd);
+    ::close(write_fd);
+#endif
+}
+
+ulong Pipe::get_capacity() const {
+    return capacity;
+}
+
+ulong Pipe::get_buffered() const {
+    return buffered;
+}
+
+/**
+ * \internal
+ *
+ * Read from a descriptor, which may be a socket
+ */
+static long __read_some(ulong fd, char* buffer, ulong length) {
+#ifdef _WIN32
+    return (long)::recv((SOCKET)fd, buffer, (int)length, 0);
+#else
+    long count;
+    do {
+        count = (long)::read((int)fd, buffer, length);
+    } while (count < 0 && errno == EINTR);
+    return count;
+#endif
+}
+
+/**
+ * \internal
+ *
+ * Write to a descriptor, which may be a socket
+ */
+static long __write_some(ulong fd, const char* buffer, ulong length) {
+#ifdef _WIN32
+    return (long)::send((SOCKET)fd, buffer, (int)length, 0);
+#else
+    long count;
+    do {
+        count = (long)::write((int)fd, buffer, length);
+    } while (count < 0 && errno == EINTR);
+    return count;
+#endif
+}
+
+bool Pipe::start_copying() {
+    fallback.resize(capacity);
+    fallback_start = 0;
+    ulong moved = 0;
+    while (moved < buffered) {
+        long count = __read_some((ulong)read_fd, fallback.data() + moved, buffered - moved);
+        if (count <= 0) {
+            return false;
+        }
+        moved += (ulong)count;
+    }
+    copying = true;
+    return true;
+}
+
+long Pipe::fill(ulong from, ulong length) {
+#ifdef __linux__
+    if (!copying) {
+        long count = (long)::splice((int)from, nullptr, write_fd, nullptr, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        // EINVAL means the source can't be spliced from, like some character devices and procfs files
+        if (count >= 0 || errno != EINVAL || !start_copying()) {
+            return count;
+        }
+    }
+#endif
+    if (fallback_start + buffered == capacity) {
+        std::copy(fallback.begin() + (long)fallback_start, fallback.begin() + (long)(fallback_start + buffered),
+                  fallback.begin());
+        fallback_start = 0;
+    }
+    ulong space = capacity - fallback_start - buffered;
+    return __read_some(from, fallback.data() + fallback_start + buffered, length < space ? length : space);
+}
+
+long Pipe::drain(ulong to, ulong length) {
+#ifdef __linux__
+    if (!copying) {
+        long count = (long)::splice(read_fd, nullptr, (int)to, nullptr, length, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        // EINVAL means the destination can't be spliced to, like a file opened for appending
+        if (count >= 0 || errno != EINVAL || !start_copying()) {
+            return count;
+        }
+    }
+#endif
+    long count = __write_some(to, fallback.data() + fallback_start, length);
+    if (count > 0) {
+        fallback_start = buffered == (ulong)count ? 0 : fallback_start + (ulong)count;
+    }
+    return count;
+}
+
+IOResult splice(ulong from, ulong to, Pipe& pipe, ulong length) {
+    IOResult result;
+    bool source_ended = false;
+    while (result.bytes < length) {
+        ulong wanted = length - result.bytes;
+        bool progress = false;
+        
+        if (!source_ended && pipe.buffered < wanted && pipe.buffered < pipe.capacity) {
+            ulong pull = wanted - pipe.buffered;
+            long count = pipe.fill(from, pull < pipe.capacity - pipe.buffered ? pull : pipe.capacity - pipe.buffered);
+            if (count > 0) {
+                pipe.buffered += (ulong)count;
+                progress = true;
+            } else if (count == 0) {
+                source_ended = true;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                result.error = errno;
+                break;
+            }
+        }
+        
+        if (pipe.buffered > 0) {
+            long count = pipe.drain(to, pipe.buffered < wanted ? pipe.buffered : wanted);
+            if (count > 0) {
+                pipe.buffered -= (ulong)count;
+                result.bytes += (ulong)count;
+                progress = true;
+            } else if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                result.error = errno;
+                break;
+            }
+        }
+        
+        if (source_ended && pipe.buffered == 0) {
+            break;
+        }
+        if (!progress) {
+            result.error = EAGAIN;
+            break;
+        }
+    }
+    return result;
+}
+
+IOResult splice(Socket& from, Socket& to, Pipe& pipe, ulong length) {
+    return splice(from.get_fd(), to.get_fd(), pipe, length);
+}
+
+}
@@ -0,0 +1,611 @@
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include "network/uring.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_FEAT_RSRC_TAGS) && defined(IORING_ENTER_EXT_ARG) && defined(IORING_POLL_ADD_MULTI)
+#define AT_URING_AVAILABLE
+#endif
+#endif
+
+namespace network {
+
+/**
+ * \internal
+ *
+ * Kinds of operation a UringReactor tracks
+ */
+enum __UringKind : uint {
+    URING_POLL, URING_ACCEPT, URING_TRANSFER
+};
+
+/**
+ * \internal
+ *
+ * User data of the wake descriptor read, and of operations whose completions are ignored
+ */
+static const ulong wake_id = 0;
+static const ulong ignored_id = 1;
+
+EventLoop* make_event_loop(LoopBackend backend) {
+    if (backend != LoopBackend::EPOLL && UringReactor::supported()) {
+        return new UringReactor();
+    }
+    return new Reactor();
+}
+
+#ifdef AT_URING_AVAILABLE
+
+struct __UringRings {
+    void* ring;
+    ulong ring_size;
+    io_uring_sqe* sqes;
+    ulong sqes_size;
+    
+    uint* sq_head;
+    uint* sq_tail;
+    uint* sq_array;
+    uint sq_mask;
+    uint sq_entries;
+    uint sq_local_tail;
+    
+    uint* cq_head;
+    uint* cq_tail;
+    uint cq_mask;
+    io_uring_cqe* cqes;
+};
+
+/**
+ * \internal
+ *
+ * Set up an io_uring instance
+ */
+static int __uring_setup(uint entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+/**
+ * \internal
+ *
+ * Submit queued entries to an io_uring instance, and optionally wait for completions
+ */
+static int __uring_enter(int fd, uint submit, uint wait, uint flags, const void* arg, ulong size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+/**
+ * \internal
+ *
+ * Register or unregister resources with an io_uring instance
+ */
+static int __uring_register(int fd, uint opcode, const void* arg, uint count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+/**
+ * \internal
+ *
+ * Convert IOEvent flags to a poll mask
+ *
+ * \param events IOEvent flags
+ * \return Poll mask
+ */
+static uint __poll_mask(uint events) {
+    uint mask = POLLRDHUP;
+    if (events & IO_READ) {
+        mask |= POLLIN;
+    }
+    if (events & IO_WRITE) {
+        mask |= POLLOUT;
+    }
+    return mask;
+}
+
+/**
+ * \internal
+ *
+ * Convert a poll mask to IOEvent flags
+ *
+ * \param mask Poll mask
+ * \return IOEvent flags
+ */
+static uint __io_events(uint mask) {
+    uint events = 0;
+    if (mask & (POLLIN | POLLPRI)) {
+        events |= IO_READ;
+    }
+    if (mask & POLLOUT) {
+        events |= IO_WRITE;
+    }
+    if (mask & (POLLHUP | POLLRDHUP)) {
+        events |= IO_HANGUP;
+    }
+    if (mask & POLLERR) {
+        events |= IO_ERROR;
+    }
+    return events;
+}
+
+/**
+ * \internal
+ *
+ * Fill in a submission queue entry for a read or write style operation
+ */
+static void __prep_transfer(io_uring_sqe* sqe, uint opcode, ulong fd, const void* addr, ulong length, ulong offset) {
+    sqe->opcode = (__u8)opcode;
+    sqe->fd = (int)fd;
+    sqe->addr = (ulong)addr;
+    sqe->len = length < 0xFFFFFFFF ? (uint)length : 0xFFFFFFFF;
+    sqe->off = offset;
+}
+
+bool UringReactor::supported() {
+    static const bool result = []() {
+        io_uring_params params {};
+        int fd = __uring_setup(2, &params);
+        if (fd < 0) {
+            return false;
+        }
+        ::close(fd);
+        uint needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+        return (params.features & needed) == needed;
+    }();
+    return result;
+}
+
+UringReactor::UringReactor(uint entries) {
+    this->wake_fd = -1;
+    this->wake_value = 0;
+    this->rings = nullptr;
+    this->queued = 0;
+    this->next_op = ignored_id + 1;
+    this->buffers = nullptr;
+    this->buffer_count = 0;
+    this->buffer_size = 0;
+    
+    if (!supported()) {
+        throw socket_error("io_uring isn't supported by this kernel");
+    }
+    io_uring_params params {};
+    ring_fd = __uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        throw socket_error("Failed to create io_uring instance");
+    }
+    
+    ulong sq_size = params.sq_off.array + params.sq_entries * sizeof(uint);
+    ulong cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    rings = new __UringRings();
+    rings->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    rings->ring = mmap(nullptr, rings->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                       IORING_OFF_SQ_RING);
+    rings->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, rings->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                      IORING_OFF_SQES);
+    wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (rings->ring == MAP_FAILED || sqes == MAP_FAILED || wake_fd < 0) {
+        if (rings->ring != MAP_FAILED) {
+            munmap(rings->ring, rings->ring_size);
+        }
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, rings->sqes_size);
+        }
+        if (wake_fd >= 0) {
+            ::close(wake_fd);
+        }
+        delete rings;
+        ::close(ring_fd);
+        throw socket_error("Failed to map io_uring rings");
+    }
+    
+    char* base = (char*)rings->ring;
+    rings->sqes = (io_uring_sqe*)sqes;
+    rings->sq_head = (uint*)(base + params.sq_off.head);
+    rings->sq_tail = (uint*)(base + params.sq_off.tail);
+    rings->sq_array = (uint*)(base + params.sq_off.array);
+    rings->sq_mask = *(uint*)(base + params.sq_off.ring_mask);
+    rings->sq_entries = *(uint*)(base + params.sq_off.ring_entries);
+    rings->sq_local_tail = *rings->sq_tail;
+    rings->cq_head = (uint*)(base + params.cq_off.head);
+    rings->cq_tail = (uint*)(base + params.cq_off.tail);
+    rings->cq_mask = *(uint*)(base + params.cq_off.ring_mask);
+    rings->cqes = (io_uring_cqe*)(base + params.cq_off.cqes);
+    
+    arm_wake();
+}
+
+UringReactor::~UringReactor() {
+    ::close(ring_fd);
+    munmap(rings->sqes, rings->sqes_size);
+    munmap(rings->ring, rings->ring_size);
+    delete rings;
+    ::close(wake_fd);
+    for (auto& entry : ops) {
+        delete entry.second;
+    }
+    for (auto& entry : watches) {
+        delete entry.second;
+    }
+    for (auto watch : retired) {
+        delete watch;
+    }
+    delete[] buffers;
+}
+
+io_uring_sqe* UringReactor::next_sqe(ulong op) {
+    uint head = __atomic_load_n(rings->sq_head, __ATOMIC_ACQUIRE);
+    if (rings->sq_local_tail - head >= rings->sq_entries) {
+        submit(0);
+        head = __atomic_load_n(rings->sq_head, __ATOMIC_ACQUIRE);
+        if (rings->sq_local_tail - head >= rings->sq_entries) {
+            throw socket_error("io_uring submission queue is full");
+        }
+    }
+    uint index = rings->sq_local_tail & rings->sq_mask;
+    io_uring_sqe* sqe = &rings->sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = op;
+    rings->sq_array[index] = index;
+    rings->sq_local_tail++;
+    queued++;
+    return sqe;
+}
+
+ulong UringReactor::track(__UringOp* op) {
+    ulong id = next_op++;
+    ops[id] = op;
+    return id;
+}
+
+void UringReactor::arm_poll(__UringWatch* watch) {
+    if (watch->op == 0) {
+        watch->op = track(new __UringOp {URING_POLL, false, watch, nullptr, nullptr, 0, 0});
+    }
+    io_uring_sqe* sqe = next_sqe(watch->op);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = (int)watch->fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = __poll_mask(watch->events);
+}
+
+void UringReactor::cancel_poll(__UringWatch* watch) {
+    if (watch->op == 0) {
+        return;
+    }
+    ops[watch->op]->stale = true;
+    io_uring_sqe* sqe = next_sqe(ignored_id);
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = watch->op;
+    watch->op = 0;
+}
+
+void UringReactor::arm_wake() {
+    io_uring_sqe* sqe = next_sqe(wake_id);
+    __prep_transfer(sqe, IORING_OP_READ, (ulong)wake_fd, &wake_value, sizeof(wake_value), 0);
+}
+
+void UringReactor::submit(int wait) {
+    __atomic_store_n(rings->sq_tail, rings->sq_local_tail, __ATOMIC_RELEASE);
+    uint flags = wait != 0 ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec timeout {};
+    io_uring_getevents_arg arg {};
+    const void* argp = nullptr;
+    ulong arg_size = 0;
+    if (wait > 0) {
+        timeout.tv_sec = wait / 1000;
+        timeout.tv_nsec = (long long)(wait % 1000) * 1000000;
+        arg.ts = (ulong)&timeout;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        arg_size = sizeof(arg);
+    }
+    int submitted = __uring_enter(ring_fd, queued, wait != 0 ? 1 : 0, flags, argp, arg_size);
+    if (submitted >= 0) {
+        queued -= (uint)submitted < queued ? (uint)submitted : queued;
+        return;
+    }
+    if (errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY) {
+        throw socket_error("Failed to submit to io_uring");
+    }
+}
+
+bool UringReactor::complete(ulong id, int res, uint flags) {
+    if (id == wake_id) {
+        arm_wake();
+        return false;
+    }
+    auto found = ops.find(id);
+    if (found == ops.end()) {
+        return false;
+    }
+    __UringOp* op = found->second;
+    
+    if (op->kind == URING_POLL) {
+        bool more = (flags & IORING_CQE_F_MORE) != 0;
+        if (op->stale) {
+            if (!more) {
+                ops.erase(found);
+                delete op;
+            }
+            return false;
+        }
+        __UringWatch* watch = op->watch;
+        if (res < 0) {
+            if (!more) {
+                ops.erase(found);
+                delete op;
+                watch->op = 0;
+            }
+            watch->callback(IO_ERROR);
+            return true;
+        }
+        if (!more) {
+            arm_poll(watch);
+        }
+        watch->callback(__io_events((uint)res));
+        return true;
+    }
+    
+    ops.erase(found);
+    IOResult result;
+    if (res < 0) {
+        result.error = -res;
+    } else {
+        result.bytes = (ulong)res;
+    }
+    if (op->kind == URING_ACCEPT) {
+        AcceptCallback callback = std::move(op->on_accept);
+        Socket socket(res >= 0 ? (ulong)res : ~(ulong)0, op->domain, op->type);
+        delete op;
+        callback(std::move(socket), result.error);
+    } else {
+        CompletionCallback callback = std::move(op->on_complete);
+        delete op;
+        callback(result);
+    }
+    return true;
+}
+
+void UringReactor::wake() {
+    ulong value = 1;
+    while (::write(wake_fd, &value, sizeof(value)) < 0 && errno == EINTR) {}
+}
+
+void UringReactor::add(ulong fd, uint events, IOCallback callback) {
+    if (watches.count(fd) != 0) {
+        throw socket_error("Descriptor is already watched by this reactor");
+    }
+    __UringWatch* watch = new __UringWatch {fd, events, std::move(callback), 0};
+    arm_poll(watch);
+    watches[fd] = watch;
+}
+
+void UringReactor::modify(ulong fd, uint events) {
+    auto found = watches.find(fd);
+    if (found == watches.end()) {
+        throw socket_error("Descriptor isn't watched by this reactor");
+    }
+    cancel_poll(found->second);
+    found->second->events = events;
+    arm_poll(found->second);
+}
+
+bool UringReactor::remove(ulong fd) {
+    auto found = watches.find(fd);
+    if (found == watches.end()) {
+        return false;
+    }
+    cancel_poll(found->second);
+    retired.push_back(found->second);
+    watches.erase(found);
+    return true;
+}
+
+ulong UringReactor::run_once(std::chrono::milliseconds timeout) {
+    int wait = wait_time(timeout);
+    if (*rings->cq_head != __atomic_load_n(rings->cq_tail, __ATOMIC_ACQUIRE)) {
+        wait = 0;
+    }
+    if (wait != 0 || queued > 0) {
+        submit(wait);
+    }
+    
+    ulong handled = 0;
+    uint head = *rings->cq_head;
+    uint tail = __atomic_load_n(rings->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        io_uring_cqe* cqe = &rings->cqes[head & rings->cq_mask];
+        ulong id = cqe->user_data;
+        int res = cqe->res;
+        uint flags = cqe->flags;
+        __atomic_store_n(rings->cq_head, head + 1, __ATOMIC_RELEASE);
+        if (complete(id, res, flags)) {
+            handled++;
+        }
+    }
+    for (auto watch : retired) {
+        delete watch;
+    }
+    retired.clear();
+    return handled + run_timers();
+}
+
+ulong UringReactor::get_watched() const {
+    return watches.size();
+}
+
+void UringReactor::accept(Socket& listener, AcceptCallback callback) {
+    __UringOp* op = new __UringOp {URING_ACCEPT, false, nullptr, nullptr, std::move(callback), listener.domain,
+                                   listener.type};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = (int)listener.get_fd();
+    sqe->accept_flags = SOCK_CLOEXEC;
+}
+
+void UringReactor::recv(Socket& socket, char* buffer, ulong length, CompletionCallback callback) {
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_RECV, socket.get_fd(), buffer, length, 0);
+}
+
+void UringReactor::send(Socket& socket, const char* bytes, ulong length, CompletionCallback callback) {
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_SEND, socket.get_fd(), bytes, length, 0);
+    sqe->msg_flags = MSG_NOSIGNAL;
+}
+
+void UringReactor::read(ulong fd, char* buffer, ulong length, ulong offset, CompletionCallback callback) {
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_READ, fd, buffer, length, offset);
+}
+
+void UringReactor::write(ulong fd, const char* bytes, ulong length, ulong offset, CompletionCallback callback) {
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_WRITE, fd, bytes, length, offset);
+}
+
+void UringReactor::register_buffers(ulong count, ulong size) {
+    if (buffers != nullptr) {
+        __uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        delete[] buffers;
+        buffers = nullptr;
+        buffer_count = 0;
+        buffer_size = 0;
+    }
+    char* memory = new char[count * size];
+    std::vector<iovec> regions(count);
+    for (ulong i = 0; i < count; ++i) {
+        regions[i].iov_base = memory + i * size;
+        regions[i].iov_len = size;
+    }
+    if (__uring_register(ring_fd, IORING_REGISTER_BUFFERS, regions.data(), (uint)count) < 0) {
+        delete[] memory;
+        throw socket_error("Failed to register buffers with io_uring");
+    }
+    buffers = memory;
+    buffer_count = count;
+    buffer_size = size;
+}
+
+void UringReactor::read_fixed(ulong fd, ulong index, ulong length, ulong offset, CompletionCallback callback) {
+    if (index >= buffer_count || length > buffer_size) {
+        throw std::out_of_range("Registered buffer index or length out of range");
+    }
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_READ_FIXED, fd, get_buffer(index), length, offset);
+    sqe->buf_index = (__u16)index;
+}
+
+void UringReactor::write_fixed(ulong fd, ulong index, ulong length, ulong offset, CompletionCallback callback) {
+    if (index >= buffer_count || length > buffer_size) {
+        throw std::out_of_range("Registered buffer index or length out of range");
+    }
+    __UringOp* op = new __UringOp {URING_TRANSFER, false, nullptr, std::move(callback), nullptr, 0, 0};
+    io_uring_sqe* sqe = next_sqe(track(op));
+    __prep_transfer(sqe, IORING_OP_WRITE_FIXED, fd, get_buffer(index), length, offset);
+    sqe->buf_index = (__u16)index;
+}
+
+#else
+
+bool UringReactor::supported() {
+    return false;
+}
+
+UringReactor::UringReactor(uint) {
+    throw socket_error("io_uring isn't supported on this platform");
+}
+
+UringReactor::~UringReactor() = default;
+
+io_uring_sqe* UringReactor::next_sqe(ulong) {
+    return nullptr;
+}
+
+ulong UringReactor::track(__UringOp*) {
+    return 0;
+}
+
+void UringReactor::arm_poll(__UringWatch*) {}
+
+void UringReactor::cancel_poll(__UringWatch*) {}
+
+void UringReactor::arm_wake() {}
+
+void UringReactor::submit(int) {}
+
+bool UringReactor::complete(ulong, int, uint) {
+    return false;
+}
+
+void UringReactor::wake() {}
+
+void UringReactor::add(ulong, uint, IOCallback) {}
+
+void UringReactor::modify(ulong, uint) {}
+
+bool UringReactor::remove(ulong) {
+    return false;
+}
+
+ulong UringReactor::run_once(std::chrono::milliseconds) {
+    return 0;
+}
+
+ulong UringReactor::get_watched() const {
+    return 0;
+}
+
+void UringReactor::accept(Socket&, AcceptCallback) {}
+
+void UringReactor::recv(Socket&, char*, ulong, CompletionCallback) {}
+
+void UringReactor::send(Socket&, const char*, ulong, CompletionCallback) {}
+
+void UringReactor::read(ulong, char*, ulong, ulong, CompletionCallback) {}
+
+void UringReactor::write(ulong, const char*, ulong, ulong, CompletionCallback) {}
+
+void UringReactor::register_buffers(ulong, ulong) {}
+
+void UringReactor::read_fixed(ulong, ulong, ulong, ulong, CompletionCallback) {}
+
+void UringReactor::write_fixed(ulong, ulong, ulong, ulong, CompletionCallback) {}
+
+#endif
+
+char* UringReactor::get_buffer(ulong index) const {
+    return buffers + index * buffer_size;
+}
+
+ulong UringReactor::get_buffer_size() const {
+    return buffer_size;
+}
+
+ulong UringReactor::get_pending() const {
+    ulong pending = 0;
+    for (auto& entry : ops) {
+        if (entry.second->kind != URING_POLL) {
+            pending++;
+        }
+    }
+    return pending;
+}
+
+}
@@ -0,0 +1,164 @@
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "utils/compress.h"
+
+namespace util {
+
+static const ulong min_match = 4;
+static const ulong max_offset = 65535;
+static const uint hash_bits = 12;
+static const ulong reserve_ratio = 16;
+
+/**
+ * \internal
+ *
+ * Read four bytes as a uint, in native order
+ *
+ * \param data Bytes to read
+ * \return Bytes as a uint
+ */
+static uint __read4(const char* data) {
+    uint value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/**
+ * \internal
+ *
+ * Append the remainder of a length that didn't fit in its token nibble
+ *
+ * \param out String to append to
+ * \param length Remaining length, after subtracting 15
+ */
+static void __write_length(std::string& out, ulong length) {
+    while (length >= 255) {
+        out += (char)255;
+        length -= 255;
+    }
+    out += (char)length;
+}
+
+/**
+ * \internal
+ *
+ * Read the remainder of a length that didn't fit in its token nibble
+ *
+ * \param data Position in the compressed block, advanced past the length
+ * \param end End of the compressed block
+ * \return Remaining length
+ */
+static ulong __read_length(const uchar*& data, const uchar* end) {
+    ulong length = 0;
+    uchar next;
+    do {
+        if (data == end) {
+            throw std::runtime_error("Compressed block ends inside a length");
+        }
+        next = *data++;
+        length += next;
+    } while (next == 255);
+    return length;
+}
+
+/**
+ * \internal
+ *
+ * Append one sequence of literals, followed by a match unless this is the last sequence
+ *
+ * \param out String to append to
+ * \param literals Start of the literal bytes
+ * \param literal_length Number of literal bytes
+ * \param offset Distance back to the match, or 0 for the last sequence
+ * \param match_length Length of the match
+ */
+static void __write_sequence(std::string& out, const char* literals, ulong literal_length, ulong offset,
+                             ulong match_length) {
+    ulong match_code = offset == 0 ? 0 : match_length - min_match;
+    uchar token = (uchar)((literal_length < 15 ? literal_length : 15) << 4 | (match_code < 15 ? match_code : 15));
+    out += (char)token;
+    if (literal_length >= 15) {
+        __write_length(out, literal_length - 15);
+    }
+    out.append(literals, literal_length);
+    if (offset == 0) {
+        return;
+    }
+    out += (char)(offset & 0xFF);
+    out += (char)(offset >> 8);
+    if (match_code >= 15) {
+        __write_length(out, match_code - 15);
+    }
+}
+
+void compress(const char* data, ulong length, std::string& out) {
+    ulong table[1 << hash_bits] = {};
+    ulong anchor = 0, pos = 0;
+    while (pos + min_match + 4 < length) {
+        uint sequence = __read4(data + pos);
+        uint hash = (sequence * 2654435761u) >> (32 - hash_bits);
+        ulong candidate = table[hash];
+        table[hash] = pos + 1;
+        
+        if (candidate == 0 || pos - (candidate - 1) > max_offset || __read4(data + candidate - 1) != sequence) {
+            pos++;
+            continue;
+        }
+        ulong match = candidate - 1;
+        ulong match_length = min_match;
+        while (pos + match_length < length && data[match + match_length] == data[pos + match_length]) {
+            match_length++;
+        }
+        __write_sequence(out, data + anchor, pos - anchor, pos - match, match_length);
+        pos += match_length;
+        anchor = pos;
+    }
+    __write_sequence(out, data + anchor, length - anchor, 0, 0);
+}
+
+void decompress(const char* data, ulong length, std::string& out, ulong original) {
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    const uchar* end = in + length;
+    ulong start = out.size();
+    out.reserve(start + std::min(original, length * reserve_ratio));
+    while (in < end) {
+        uchar token = *in++;
+        ulong literal_length = token >> 4;
+        if (literal_length == 15) {
+            literal_length += __read_length(in, end);
+        }
+        if ((ulong)(end - in) < literal_length || out.size() - start + literal_length > original) {
+            throw std::runtime_error("Compressed block has too many literals");
+        }
+        out.append(reinterpret_cast<const char*>(in), literal_length);
+        in += literal_length;
+        if (in == end) {
+            break;
+        }
+        
+        if (end - in < 2) {
+            throw std::runtime_error("Compressed block ends inside an offset");
+        }
+        ulong offset = (ulong)in[0] | (ulong)in[1] << 8;
+        in += 2;
+        ulong match_length = token & 0xF;
+        if (match_length == 15) {
+            match_length += __read_length(in, end);
+        }
+        match_length += min_match;
+        if (offset == 0 || offset > out.size() - start || out.size() - start + match_length > original) {
+            throw std::runtime_error("Compressed block has an invalid match");
+        }
+        ulong from = out.size() - offset;
+        for (ulong i = 0; i < match_length; ++i) {
+            out += out[from + i];
+        }
+    }
+    if (out.size() - start != original) {
+        throw std::runtime_error("Compressed block has the wrong length");
+    }
+}
+
+}
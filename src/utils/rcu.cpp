@@ -0,0 +1,156 @@
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "utils/rcu.h"
+
+namespace util {
+
+/**
+ * \internal
+ *
+ * Read-side state of one thread. Active holds the epoch the thread entered its outermost guard at, or 0 outside any
+ * guard. Slots are never freed, and are reused by later threads once their owner exits
+ */
+struct __RcuSlot {
+    std::atomic<ulong> active {0};
+    std::atomic<bool> in_use {true};
+    __RcuSlot* next = nullptr;
+};
+
+/**
+ * \internal
+ *
+ * An object waiting to be freed, and the epoch it was retired at
+ */
+struct __RcuRetired {
+    void* pointer;
+    void (*deleter)(void*);
+    ulong epoch;
+};
+
+static std::atomic<ulong> global_epoch {1};
+static std::atomic<__RcuSlot*> slots {nullptr};
+static std::mutex retire_mutex;
+static std::vector<__RcuRetired> retired;
+
+/**
+ * \internal
+ *
+ * The slot of the calling thread, claimed on first use and released when the thread exits
+ */
+struct __RcuThread {
+    
+    __RcuSlot* slot = nullptr;
+    ulong depth = 0;
+    
+    __RcuSlot* get() {
+        if (slot != nullptr) {
+            return slot;
+        }
+        for (__RcuSlot* current = slots.load(std::memory_order_acquire); current; current = current->next) {
+            bool free = false;
+            if (!current->in_use.load(std::memory_order_relaxed) && current->in_use.compare_exchange_strong(free, true)) {
+                slot = current;
+                return slot;
+            }
+        }
+        slot = new __RcuSlot();
+        __RcuSlot* head = slots.load(std::memory_order_relaxed);
+        do {
+            slot->next = head;
+        } while (!slots.compare_exchange_weak(head, slot, std::memory_order_release, std::memory_order_relaxed));
+        return slot;
+    }
+    
+    ~__RcuThread() {
+        if (slot != nullptr) {
+            slot->active.store(0, std::memory_order_release);
+            slot->in_use.store(false, std::memory_order_release);
+        }
+    }
+    
+};
+
+static thread_local __RcuThread rcu_thread;
+
+/**
+ * \internal
+ *
+ * Get the oldest epoch any other thread is reading at. Retired objects tagged with an epoch at or before it are
+ * safe to free
+ *
+ * \param own Slot of the calling thread, which is counted too
+ * \param skip_own Whether to ignore the calling thread's slot
+ * \return Oldest active epoch, or the current epoch plus one if no thread is reading
+ */
+static ulong __oldest_reader(__RcuSlot* own, bool skip_own) {
+    ulong oldest = global_epoch.load() + 1;
+    for (__RcuSlot* current = slots.load(std::memory_order_acquire); current; current = current->next) {
+        if (skip_own && current == own) {
+            continue;
+        }
+        ulong active = current->active.load();
+        if (active != 0 && active < oldest) {
+            oldest = active;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * \internal
+ *
+ * Free every retired object no reader can still hold. Must be called with the retire mutex held
+ */
+static void __reclaim() {
+    ulong oldest = __oldest_reader(rcu_thread.slot, false);
+    ulong kept = 0;
+    for (ulong i = 0; i < retired.size(); ++i) {
+        if (retired[i].epoch <= oldest) {
+            retired[i].deleter(retired[i].pointer);
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+RcuReadGuard::RcuReadGuard() noexcept {
+    if (rcu_thread.depth++ == 0) {
+        rcu_thread.get()->active.store(global_epoch.load(), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+RcuReadGuard::~RcuReadGuard() {
+    if (--rcu_thread.depth == 0) {
+        rcu_thread.slot->active.store(0, std::memory_order_release);
+    }
+}
+
+void rcu_retire(void* pointer, void (*deleter)(void*)) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ulong epoch = global_epoch.fetch_add(1) + 1;
+    std::lock_guard<std::mutex> guard(retire_mutex);
+    retired.push_back(__RcuRetired {pointer, deleter, epoch});
+    __reclaim();
+}
+
+void rcu_synchronize() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    ulong target = global_epoch.fetch_add(1) + 1;
+    while (__oldest_reader(rcu_thread.slot, true) < target) {
+        std::this_thread::yield();
+    }
+    std::lock_guard<std::mutex> guard(retire_mutex);
+    __reclaim();
+}
+
+ulong rcu_pending() {
+    std::lock_guard<std::mutex> guard(retire_mutex);
+    return retired.size();
+}
+
+}
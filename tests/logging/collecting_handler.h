@@ -0,0 +1,30 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <at_logging>
+
+/**
+ * Handler that keeps every line it's given, to check what reached it
+ */
+class CollectingHandler : public logging::Handler {
+public:
+    
+    std::vector<std::string> lines;
+    
+    void log(const std::string& message, const logging::Level*) override {
+        lines.push_back(message);
+    }
+    
+    /**
+     * Check whether a line was collected
+     *
+     * \param line Line to look for
+     * \return Whether the line reached this handler
+     */
+    bool has(const std::string& line) const {
+        return std::find(lines.begin(), lines.end(), line) != lines.end();
+    }
+    
+};
@@ -0,0 +1,139 @@
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_aggregate.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+void test_aggregate_repeats() {
+    CollectingHandler collector;
+    AggregatingHandler aggregate(&collector, std::chrono::milliseconds(3600000));
+    Logger* log = get_logger("aggregate.repeats");
+    log->set_propagation(false);
+    log->set_pattern("%l %m");
+    log->add_handler(&aggregate);
+    
+    for (int i = 0; i < 100; ++i) {
+        log->info("spam");
+        if (i < 3) {
+            log->info("other");
+        }
+    }
+    log->warn("spam");
+    ASSERT(collector.lines.size() == 3);
+    ASSERT(collector.lines[0] == "INFO spam");
+    ASSERT(collector.lines[1] == "INFO other");
+    ASSERT(collector.lines[2] == "WARN spam");
+    ASSERT(aggregate.get_suppressed() == 101);
+    
+    aggregate.flush();
+    log->remove_handler(&aggregate);
+    ASSERT(collector.lines.size() == 5);
+    ASSERT(collector.has("INFO spam (repeated 99 more times)"));
+    ASSERT(collector.has("INFO other (repeated 2 more times)"));
+}
+
+void test_aggregate_window() {
+    CollectingHandler collector;
+    AggregatingHandler aggregate(&collector, std::chrono::milliseconds(20));
+    Logger* log = get_logger("aggregate.window");
+    log->set_propagation(false);
+    log->set_pattern("%t6 %m");
+    log->add_handler(&aggregate);
+    
+    for (int i = 0; i < 3; ++i) {
+        log->info("tick");
+    }
+    ASSERT(collector.lines.size() == 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    log->info("tick");
+    log->remove_handler(&aggregate);
+    
+    ASSERT(collector.lines.size() == 3);
+    ASSERT(collector.lines[1] == collector.lines[0] + " (repeated 2 more times)");
+    ASSERT(collector.lines[2].size() == collector.lines[0].size());
+    ASSERT(collector.lines[2] != collector.lines[0]);
+}
+
+void test_aggregate_destroyed() {
+    CollectingHandler collector;
+    {
+        AggregatingHandler aggregate(&collector, std::chrono::milliseconds(3600000));
+        for (int i = 0; i < 5; ++i) {
+            std::string name = "aggregate.temporary";
+            std::string message = "burst";
+            Record record = {INFO, &name, &message, &message, SourceLocation()};
+            if (aggregate.accepts(record)) {
+                aggregate.handle(record);
+            }
+        }
+        ASSERT(collector.lines.size() == 1);
+    }
+    ASSERT(collector.lines.size() == 2);
+    ASSERT(collector.lines[1] == "burst (repeated 4 more times)");
+}
+
+void test_aggregate_top() {
+    CollectingHandler collector;
+    AggregatingHandler aggregate(&collector, std::chrono::milliseconds(3600000), 2);
+    for (int i = 0; i < 100; ++i) {
+        aggregate.log("unique " + std::to_string(i), INFO);
+        if (i < 50) {
+            aggregate.log("often", INFO);
+        }
+        if (i < 30) {
+            aggregate.log("sometimes", ERROR);
+        }
+    }
+    
+    std::vector<MessageCount> top = aggregate.get_top();
+    ASSERT(top.size() == 2);
+    ASSERT(top[0].message == "often" && top[0].level == INFO && top[0].count >= 50);
+    ASSERT(top[1].message == "sometimes" && top[1].level == ERROR && top[1].count >= 30);
+    ASSERT(top[0].name == "aggregate");
+}
+
+void test_aggregate_top_evictions() {
+    CollectingHandler collector;
+    AggregatingHandler aggregate(&collector, std::chrono::milliseconds(3600000), 4);
+    ulong total = 0;
+    for (int i = 0; i < 3000; ++i) {
+        aggregate.log("unique " + std::to_string(i), INFO);
+        total++;
+        if (i % 2 == 0) {
+            aggregate.log("hot a", INFO);
+            total++;
+        }
+        if (i % 3 == 0) {
+            aggregate.log("hot b", INFO);
+            total++;
+        }
+        if (i % 4 == 0) {
+            aggregate.log("hot a", WARN);
+            total++;
+        }
+    }
+    
+    std::vector<MessageCount> top = aggregate.get_top();
+    ASSERT(top.size() == 4);
+    ASSERT(top[0].message == "hot a" && top[0].level == INFO);
+    ASSERT(top[1].message == "hot b" && top[1].level == INFO);
+    ASSERT(top[2].message == "hot a" && top[2].level == WARN);
+    ASSERT(top[0].count >= 1500 && top[0].count <= 1500 + total / 16);
+    ASSERT(top[1].count >= 1000 && top[1].count <= 1000 + total / 16);
+    ASSERT(top[2].count >= 750 && top[2].count <= 750 + total / 16);
+}
+
+void run_aggregate_tests() {
+    __ensure_levels();
+    TEST(test_aggregate_repeats)
+    TEST(test_aggregate_window)
+    TEST(test_aggregate_destroyed)
+    TEST(test_aggregate_top)
+    TEST(test_aggregate_top_evictions)
+}
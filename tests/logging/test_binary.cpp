@@ -0,0 +1,59 @@
+
+#include <sstream>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_binary.h"
+
+using namespace logging;
+
+void test_binary_roundtrip() {
+    std::stringstream out;
+    set_binary_output(&out);
+    
+    AT_BINLOG(INFO, "binary", "Value {} and {} named {}", 42, -1.5, "test");
+    AT_BINLOG(DEBUG, "binary", "Filtered {}", 1u);
+    AT_BINLOG(WARN, "binary.child", "No arguments");
+    flush_binary();
+    set_binary_output(nullptr);
+    
+    std::stringstream text;
+    ASSERT(decode_binary(out, text) == 2);
+    
+    std::string line;
+    std::getline(text, line);
+    ASSERT(line.find(" INFO binary: Value 42 and -1.5 named test") != std::string::npos);
+    std::getline(text, line);
+    ASSERT(line.find(" WARN binary.child: No arguments") != std::string::npos);
+}
+
+void test_binary_site_registration() {
+    std::stringstream out;
+    set_binary_output(&out);
+    
+    ulong before = get_binary_formats().size();
+    for (int i = 0; i < 3; ++i) {
+        AT_BINLOG(INFO, "binary", "Iteration {}", i);
+    }
+    ASSERT(get_binary_formats().size() == before + 1);
+    ASSERT(get_binary_formats().back().format == "Iteration {}");
+    
+    flush_binary();
+    set_binary_output(nullptr);
+    
+    std::stringstream text;
+    ASSERT(decode_binary(out, text) == 3);
+    ASSERT(text.str().find("binary: Iteration 2\n") != std::string::npos);
+}
+
+void test_binary_invalid() {
+    std::stringstream out("not a log");
+    std::stringstream text;
+    ASSERT_THROWS(std::runtime_error, [&]() { decode_binary(out, text); });
+}
+
+void run_binary_tests() {
+    TEST(test_binary_roundtrip)
+    TEST(test_binary_site_registration)
+    TEST(test_binary_invalid)
+}
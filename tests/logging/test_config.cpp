@@ -0,0 +1,95 @@
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_config.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+void test_apply_config() {
+    std::istringstream input(
+        "# logger settings\n"
+        "config.apply.level = DEBUG\n"
+        "config.apply.pattern = \"%l [%n] %m\"   # quoted to keep spacing\n"
+        "\n"
+        "config.apply.child.propagate = false\n"
+    );
+    ASSERT(apply_config(input) == 3);
+    Logger* log = get_logger("config.apply");
+    ASSERT(log->get_level() == DEBUG);
+    ASSERT(log->get_pattern() == "%l [%n] %m");
+    ASSERT(!get_logger("config.apply.child")->get_propagation());
+    
+    CollectingHandler collector;
+    log->set_propagation(false);
+    log->add_handler(&collector);
+    log->debug("shown");
+    ASSERT(collector.lines.size() == 1 && collector.lines[0] == "DEBUG [config.apply] shown");
+    ASSERT(log->remove_handler(&collector));
+    
+    std::istringstream cleared("config.apply.level = NONE\n");
+    apply_config(cleared);
+    ASSERT(log->get_level() == NO_LEVEL);
+}
+
+void test_config_errors() {
+    Logger* log = get_logger("config.errors");
+    log->set_level(WARN);
+    std::istringstream bad_level("config.errors.level = ERROR\nconfig.errors.level = LOUD\n");
+    ASSERT_THROWS(std::runtime_error, [&]() { apply_config(bad_level); });
+    ASSERT(log->get_level() == WARN);
+    
+    std::istringstream no_equals("config.errors.level ERROR\n");
+    ASSERT_THROWS(std::runtime_error, [&]() { apply_config(no_equals); });
+    std::istringstream bad_key("config.errors.colour = red\n");
+    ASSERT_THROWS(std::runtime_error, [&]() { apply_config(bad_key); });
+    std::istringstream root_none("root.level = NONE\n");
+    ASSERT_THROWS(std::runtime_error, [&]() { apply_config(root_none); });
+    ASSERT_THROWS(std::runtime_error, []() { load_config("no_such_logging.conf"); });
+}
+
+/**
+ * Replace a file by writing a temporary file and renaming it into place, so it's never seen half written
+ */
+static void replace_file(const std::string& path, const std::string& contents) {
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp);
+        out << contents;
+    }
+    ASSERT(std::rename(temp.c_str(), path.c_str()) == 0);
+}
+
+void test_config_watcher() {
+    std::string path = "test_config_watch.conf";
+    replace_file(path, "config.watch.level = ERROR\n");
+    Logger* log = get_logger("config.watch");
+    ConfigWatcher watcher(path, std::chrono::milliseconds(5));
+    ASSERT(log->get_level() == ERROR);
+    ASSERT(watcher.get_reloads() == 1);
+    
+    replace_file(path, "config.watch.level = TRACE\nconfig.watch.pattern = %m\n");
+    for (int i = 0; i < 400 && watcher.get_reloads() < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    ASSERT(watcher.get_reloads() >= 2);
+    ASSERT(log->get_level() == TRACE);
+    ASSERT(log->get_pattern() == "%m");
+    
+    replace_file(path, "config.watch.level = DEBUG\n");
+    ASSERT(watcher.reload());
+    ASSERT(log->get_level() == DEBUG);
+    std::remove(path.c_str());
+}
+
+void run_config_tests() {
+    TEST(test_apply_config)
+    TEST(test_config_errors)
+    TEST(test_config_watcher)
+}
@@ -0,0 +1,105 @@
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_file_handler.h"
+
+using namespace logging;
+
+static std::string read_file(const std::string& name) {
+    std::ifstream in(name);
+    std::stringstream out;
+    out << in.rdbuf();
+    return out.str();
+}
+
+void test_buffered_output() {
+    std::remove("test_buffered.log");
+    {
+        BufferedFileHandler handler("test_buffered.log");
+        handler.log("first", INFO);
+        handler.log("second", INFO);
+        handler.log("third", INFO);
+        
+        ASSERT(handler.get_stats().writes == 0);
+        ASSERT(read_file("test_buffered.log").empty());
+        
+        handler.flush();
+        ASSERT(handler.get_stats().writes == 1);
+        ASSERT(handler.get_stats().records == 3);
+        ASSERT(handler.get_stats().bytes == 19);
+        ASSERT(read_file("test_buffered.log") == "first\nsecond\nthird\n");
+        
+        handler.log("fourth", INFO);
+    }
+    ASSERT(read_file("test_buffered.log") == "first\nsecond\nthird\nfourth\n");
+    std::remove("test_buffered.log");
+}
+
+void test_buffered_chunks() {
+    std::remove("test_chunks.log");
+    BufferedFileHandler handler("test_chunks.log", 8, 2);
+    handler.log("aaaa", INFO);
+    handler.log("bbbb", INFO);
+    ASSERT(handler.get_stats().writes == 0);
+    handler.log("cccc", INFO);
+    ASSERT(handler.get_stats().writes == 1);
+    ASSERT(read_file("test_chunks.log") == "aaaa\nbbbb\n");
+    
+    handler.log("a message larger than a chunk", INFO);
+    ASSERT(handler.get_stats().writes == 2);
+    ASSERT(read_file("test_chunks.log") == "aaaa\nbbbb\ncccc\na message larger than a chunk\n");
+    std::remove("test_chunks.log");
+}
+
+void test_buffered_rotation() {
+    std::remove("test_rotate.log");
+    std::remove("test_rotate.log.1");
+    std::remove("test_rotate.log.2");
+    
+    BufferedFileHandler handler("test_rotate.log");
+    handler.set_rotation(12, std::chrono::milliseconds(0), 1);
+    handler.log("one", INFO);
+    handler.log("two", INFO);
+    handler.log("three", INFO);
+    handler.log("four", INFO);
+    handler.log("five", INFO);
+    handler.flush();
+    
+    ASSERT(handler.get_stats().rotations == 2);
+    ASSERT(read_file("test_rotate.log") == "five\n");
+    ASSERT(read_file("test_rotate.log.1") == "three\nfour\n");
+    ASSERT(!std::ifstream("test_rotate.log.2").good());
+    
+    std::remove("test_rotate.log");
+    std::remove("test_rotate.log.1");
+}
+
+void test_buffered_sync() {
+    std::remove("test_sync.log");
+    BufferedFileHandler handler("test_sync.log");
+    handler.set_sync_policy(SyncPolicy::BYTES, 10);
+    handler.log("12345", INFO);
+    handler.log("12345", INFO);
+    ASSERT(handler.get_stats().syncs == 0);
+    handler.log("12345", INFO);
+    ASSERT(handler.get_stats().syncs == 1);
+    ASSERT(read_file("test_sync.log") == "12345\n12345\n");
+    
+    handler.set_level(ERROR);
+    handler.log("filtered", INFO);
+    handler.flush();
+    ASSERT(handler.get_stats().records == 3);
+    std::remove("test_sync.log");
+}
+
+void run_file_handler_tests() {
+    __ensure_levels();
+    TEST(test_buffered_output)
+    TEST(test_buffered_chunks)
+    TEST(test_buffered_rotation)
+    TEST(test_buffered_sync)
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void run_file_handler_tests();
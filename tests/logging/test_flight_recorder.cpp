@@ -0,0 +1,172 @@
+
+#include <cstdio>
+#include <csignal>
+#include <thread>
+#include <vector>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_flight_recorder.h"
+
+using namespace logging;
+
+namespace {
+
+/**
+ * Temporary file to dump recorders into, read back as lines
+ */
+class DumpFile {
+public:
+    
+    std::FILE* file;
+    
+    DumpFile() {
+        file = std::tmpfile();
+    }
+    
+    ~DumpFile() {
+        std::fclose(file);
+    }
+    
+    int fd() {
+        return fileno(file);
+    }
+    
+    std::vector<std::string> lines() {
+        std::rewind(file);
+        std::vector<std::string> result;
+        std::string line;
+        int c;
+        while ((c = std::fgetc(file)) != EOF) {
+            if (c == '\n') {
+                result.push_back(line);
+                line.clear();
+            } else {
+                line += (char)c;
+            }
+        }
+        return result;
+    }
+    
+};
+
+}
+
+void test_flight_ring() {
+    DumpFile out;
+    FlightRecorder recorder(4);
+    recorder.set_trigger(nullptr);
+    Logger* log = get_logger("flight.ring");
+    log->set_propagation(false);
+    log->set_level(TRACE);
+    log->add_handler(&recorder);
+    
+    for (int i = 0; i < 10; ++i) {
+        log->debug("message " + std::to_string(i));
+    }
+    log->remove_handler(&recorder);
+    
+    ASSERT(recorder.get_recorded() == 10);
+    ASSERT(recorder.dump(out.fd()) == 4);
+    std::vector<std::string> lines = out.lines();
+    ASSERT(lines.size() == 4);
+    ASSERT(lines[0].size() > 27 && lines[0][4] == '-' && lines[0][19] == '.');
+    ASSERT(lines[0].substr(27) == "DEBUG flight.ring: message 6");
+    ASSERT(lines[3].substr(27) == "DEBUG flight.ring: message 9");
+}
+
+void test_flight_trigger() {
+    DumpFile out;
+    FlightRecorder recorder(16, 8);
+    recorder.set_output(out.fd());
+    Logger* log = get_logger("flight.trigger");
+    log->set_propagation(false);
+    log->set_level(TRACE);
+    log->add_handler(&recorder);
+    
+    log->trace("0123456789");
+    log->error("short");
+    ASSERT(out.lines().empty());
+    log->fatal("crashed");
+    log->remove_handler(&recorder);
+    
+    std::vector<std::string> lines = out.lines();
+    ASSERT(lines.size() == 3);
+    ASSERT(lines[0].substr(27) == "TRACE flight.trigger: 01234567...");
+    ASSERT(lines[1].substr(27) == "ERROR flight.trigger: short");
+    ASSERT(lines[2].substr(27) == "FATAL flight.trigger: crashed");
+}
+
+void test_flight_copies_name() {
+    DumpFile out;
+    FlightRecorder recorder(4);
+    recorder.set_trigger(nullptr);
+    {
+        std::string name = "flight.temporary";
+        std::string message = "gone";
+        Record record = {INFO, &name, &message, nullptr, SourceLocation()};
+        recorder.handle(record);
+        name.assign(name.size(), 'x');
+    }
+    std::string long_name(300, 'n');
+    std::string message = "long";
+    Record record = {WARN, &long_name, &message, nullptr, SourceLocation()};
+    recorder.handle(record);
+    
+    ASSERT(recorder.dump(out.fd()) == 2);
+    std::vector<std::string> lines = out.lines();
+    ASSERT(lines.size() == 2);
+    ASSERT(lines[0].substr(27) == "INFO flight.temporary: gone");
+    ASSERT(lines[1].substr(27) == "WARN " + std::string(AT_FLIGHT_NAME_SIZE, 'n') + ": long");
+}
+
+void test_flight_signal() {
+#ifdef SIGUSR1
+    DumpFile out;
+    FlightRecorder recorder(8);
+    recorder.set_output(out.fd());
+    recorder.log("before signal", WARN);
+    recorder.dump_on_signal(SIGUSR1);
+    std::raise(SIGUSR1);
+    std::signal(SIGUSR1, SIG_DFL);
+    
+    std::vector<std::string> lines = out.lines();
+    ASSERT(lines.size() == 1);
+    ASSERT(lines[0].substr(27) == "WARN: before signal");
+#else
+    throw testing::skip_test("No SIGUSR1 on this platform");
+#endif
+}
+
+void test_flight_threads() {
+    const int num_threads = 4, num_messages = 2000;
+    DumpFile out;
+    FlightRecorder recorder(64);
+    
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&recorder]() {
+            for (int j = 0; j < num_messages; ++j) {
+                recorder.log("threaded record", INFO);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    ASSERT(recorder.get_recorded() == num_threads * num_messages);
+    ASSERT(recorder.dump(out.fd()) == 64);
+    for (const auto& line : out.lines()) {
+        ASSERT(line.substr(27) == "INFO: threaded record");
+    }
+}
+
+void run_flight_recorder_tests() {
+    __ensure_levels();
+    TEST(test_flight_ring)
+    TEST(test_flight_trigger)
+    TEST(test_flight_copies_name)
+    TEST(test_flight_signal)
+    TEST(test_flight_threads)
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void run_flight_recorder_tests();
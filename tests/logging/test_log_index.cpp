@@ -0,0 +1,113 @@
+
+#include <cstdio>
+#include <string>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_log_index.h"
+
+using namespace logging;
+
+static const std::string web_name = "web";
+static const std::string db_name = "db";
+
+/**
+ * Deliver a record straight to a handler, with a fixed timestamp
+ */
+static void deliver(Handler& handler, const Level* level, const std::string& name, const std::string& text,
+                    ulong timestamp) {
+    Record record = {level, &name, &text, &text, SourceLocation()};
+    record.timestamp = timestamp;
+    if (handler.accepts(record)) {
+        handler.handle(record);
+    }
+}
+
+/**
+ * Get the text of every region as one string
+ */
+static std::string join(const std::vector<LogRegion>& regions) {
+    std::string out;
+    for (auto& region : regions) {
+        out.append(region.data, region.length);
+    }
+    return out;
+}
+
+void test_index_queries() {
+    std::remove("test_index.log");
+    std::remove("test_index.log.idx");
+    {
+        BufferedFileHandler handler("test_index.log");
+        handler.set_level(TRACE);
+        handler.set_index(100);
+        for (ulong i = 0; i < 40; ++i) {
+            const Level* level = i == 17 ? ERROR : INFO;
+            deliver(handler, level, i < 20 ? web_name : db_name, "record number " + std::to_string(i), 1000 + i);
+        }
+    }
+    
+    LogIndex index("test_index.log");
+    ASSERT(index.get_entries().size() >= 6);
+    ASSERT(index.get_entries()[0].offset == 0);
+    ASSERT(index.find(IndexQuery()).size() == 1 && index.find(IndexQuery())[0].length == index.get_size());
+    
+    IndexQuery errors;
+    errors.min_level = ERROR;
+    std::string found = join(index.find(errors));
+    ASSERT(found.find("record number 17\n") != std::string::npos);
+    ASSERT(found.size() < index.get_size() / 3);
+    
+    IndexQuery late;
+    late.start_time = 1030;
+    late.end_time = 1032;
+    found = join(index.find(late));
+    ASSERT(found.find("record number 31\n") != std::string::npos);
+    ASSERT(found.find("record number 5\n") == std::string::npos);
+    
+    IndexQuery web;
+    web.logger = "web";
+    found = join(index.find(web));
+    ASSERT(found.find("record number 0\n") != std::string::npos);
+    ASSERT(found.find("record number 19\n") != std::string::npos);
+    
+    std::remove("test_index.log");
+    std::remove("test_index.log.idx");
+}
+
+void test_index_tail_and_rotation() {
+    std::remove("test_index_rotate.log");
+    std::remove("test_index_rotate.log.idx");
+    std::remove("test_index_rotate.log.1");
+    std::remove("test_index_rotate.log.1.idx");
+    {
+        BufferedFileHandler handler("test_index_rotate.log");
+        handler.set_index(1 << 20);
+        handler.set_rotation(0, std::chrono::milliseconds(0), 2);
+        deliver(handler, WARN, web_name, "before rotation", 10);
+        handler.rotate();
+        deliver(handler, WARN, web_name, "after rotation", 20);
+        handler.flush();
+        
+        LogIndex open("test_index_rotate.log");
+        ASSERT(open.get_entries().empty());
+        ASSERT(join(open.find(IndexQuery())) == "after rotation\n");
+    }
+    
+    LogIndex rotated("test_index_rotate.log.1");
+    ASSERT(rotated.get_entries().size() == 1);
+    ASSERT(rotated.get_entries()[0].first_time == 10);
+    IndexQuery late;
+    late.start_time = 15;
+    ASSERT(rotated.find(late).empty());
+    
+    std::remove("test_index_rotate.log");
+    std::remove("test_index_rotate.log.idx");
+    std::remove("test_index_rotate.log.1");
+    std::remove("test_index_rotate.log.1.idx");
+}
+
+void run_log_index_tests() {
+    TEST(test_index_queries)
+    TEST(test_index_tail_and_rotation)
+}
@@ -1,6 +1,9 @@
 
 #include <iostream>
+#include <thread>
+#include <vector>
 #include "test_logging.h"
+#include "collecting_handler.h"
 #include "at_logging"
 
 using namespace logging;
@@ -34,6 +37,10 @@ void TestLogger::run() {
     TEST_METHOD(test_format)
     TEST_METHOD(test_saving)
 	TEST_METHOD(test_auto_parent)
+    TEST_METHOD(test_cached_logger)
+    TEST_METHOD(test_concurrent_loggers)
+    TEST_METHOD(test_threaded_logging)
+    TEST_METHOD(test_time_directives)
 }
 
 void TestLogger::clear_logs() {
@@ -127,6 +134,106 @@ void TestLogger::test_auto_parent() {
 	ASSERT(root->get_parent() == nullptr);
 }
 
+void TestLogger::test_cached_logger() {
+    Logger* first = nullptr;
+    for (int i = 0; i < 3; ++i) {
+        Logger* cached = AT_LOGGER("cached.logger");
+        if (first == nullptr) {
+            first = cached;
+        }
+        ASSERT(cached == first);
+    }
+    ASSERT(first == get_logger("cached.logger"));
+    ASSERT(first->get_parent() == get_logger("cached"));
+}
+
+void TestLogger::test_concurrent_loggers() {
+    const int num_threads = 8;
+    std::vector<std::thread> threads;
+    std::vector<Logger*> results(num_threads * 3);
+    
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([i, &results]() {
+            results[i * 3] = get_logger("concurrent.a.b.c");
+            results[i * 3 + 1] = get_logger("concurrent.a");
+            results[i * 3 + 2] = get_logger("concurrent.thread" + std::to_string(i));
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    for (int i = 0; i < num_threads; ++i) {
+        ASSERT(results[i * 3] == results[0]);
+        ASSERT(results[i * 3 + 1] == results[1]);
+        ASSERT(results[i * 3 + 2]->get_parent() == get_logger("concurrent"));
+    }
+    ASSERT(results[0]->get_parent()->get_parent() == results[1]);
+}
+
+void TestLogger::test_threaded_logging() {
+    const int num_threads = 8, num_messages = 500;
+    Logger* threaded = get_logger("threaded");
+    threaded->set_propagation(false);
+    threaded->set_pattern("[%n] %m");
+    CollectingHandler handler;
+    threaded->add_handler(&handler);
+    
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([i, threaded]() {
+            for (int j = 0; j < num_messages; ++j) {
+                threaded->info("thread " + std::to_string(i) + " message " + std::to_string(j));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threaded->remove_handler(&handler);
+    
+    ASSERT(handler.lines.size() == num_threads * num_messages);
+    for (const auto& line : handler.lines) {
+        ASSERT(line.rfind("[threaded] thread ", 0) == 0);
+    }
+}
+
+void TestLogger::test_time_directives() {
+    std::string out;
+    render_timestamp(out, 1700000000123456789, 3);
+    ASSERT(out == "2023-11-14 22:13:20.123");
+    out.clear();
+    render_timestamp(out, 1700000000000000042, 9);
+    ASSERT(out == "2023-11-14 22:13:20.000000042");
+    out.clear();
+    render_timestamp(out, 1700000061999999999, 0);
+    ASSERT(out == "2023-11-14 22:14:21");
+    out.clear();
+    render_duration(out, 12345678901, 6);
+    ASSERT(out == "12.345678");
+    
+    Logger* timed = get_logger("timed");
+    timed->set_propagation(false);
+    timed->set_pattern("%t6|%T|%s|%F|%e|%m");
+    CollectingHandler handler;
+    timed->add_handler(&handler);
+    AT_INFO(timed, "Stamped");
+    timed->info("Unplaced");
+    timed->remove_handler(&handler);
+    
+    ASSERT(handler.lines.size() == 2);
+    const std::string& line = handler.lines[0];
+    ASSERT(line.size() > 27 && line[4] == '-' && line[19] == '.' && line[26] == '|');
+    std::string rest = line.substr(27);
+    std::string thread = std::to_string(thread_id());
+    ASSERT(rest.rfind(thread + "|", 0) == 0);
+    rest = rest.substr(thread.size() + 1);
+    ASSERT(rest.find("test_logging.cpp:") != std::string::npos);
+    ASSERT(rest.find("|test_time_directives|") != std::string::npos);
+    ASSERT(rest.size() > 8 && rest.compare(rest.size() - 8, 8, "|Stamped") == 0);
+    ASSERT(handler.lines[1].find("|?|?|") != std::string::npos);
+}
+
 void run_logging_tests() {
     TEST(TestLogger())
 }
@@ -19,6 +19,10 @@ class TestLogger : public testing::AbstractTest {
     void test_format();
     void test_saving();
 	void test_auto_parent();
+    void test_cached_logger();
+    void test_concurrent_loggers();
+    void test_threaded_logging();
+    void test_time_directives();
     
 public:
     
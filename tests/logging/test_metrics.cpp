@@ -0,0 +1,113 @@
+
+#include <thread>
+#include <vector>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_metrics.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+void test_logger_metrics() {
+    CollectingHandler collector;
+    Logger* log = get_logger("metrics.counts");
+    log->set_propagation(false);
+    log->set_level(INFO);
+    log->set_pattern("%m");
+    log->add_handler(&collector);
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([log]() {
+            for (int i = 0; i < 250; ++i) {
+                log->debug("hidden");
+                log->error("shown");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    log->remove_handler(&collector);
+    
+    LoggerMetrics metrics = log->get_metrics();
+    ASSERT(metrics.name == "metrics.counts");
+    ASSERT(metrics.levels[metric_index(DEBUG)].filtered == 1000);
+    ASSERT(metrics.levels[metric_index(DEBUG)].emitted == 0);
+    ASSERT(metrics.levels[metric_index(ERROR)].emitted == 1000);
+    ASSERT(metrics.levels[metric_index(ERROR)].bytes == 5000);
+    ASSERT(metrics.levels[metric_index(ERROR)].handler_ns == 0);
+    ASSERT(metrics.total().emitted == 1000 && metrics.total().filtered == 1000);
+    ASSERT(std::string(metric_level_name(metric_index(ERROR))) == "ERROR");
+    
+    bool found = false;
+    for (auto& entry : snapshot_metrics()) {
+        found |= entry.name == "metrics.counts" && entry.total().emitted == 1000;
+    }
+    ASSERT(found);
+}
+
+void test_handler_timing() {
+    CollectingHandler collector;
+    CollectingHandler second;
+    Logger* log = get_logger("metrics.timing");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(&collector);
+    log->add_handler(&second);
+    
+    ASSERT(!get_handler_timing());
+    log->info("untimed");
+    set_handler_timing(true);
+    ASSERT(get_handler_timing());
+    for (int i = 0; i < 100; ++i) {
+        log->info("timed");
+    }
+    set_handler_timing(false);
+    ASSERT(!get_handler_timing());
+    {
+        MetricsHandler reporter(&collector, std::chrono::milliseconds(3600000));
+        ASSERT(get_handler_timing());
+    }
+    ASSERT(!get_handler_timing());
+    log->remove_handler(&collector);
+    log->remove_handler(&second);
+    
+    LevelMetrics info = log->get_metrics().levels[metric_index(INFO)];
+    ASSERT(info.emitted == 101);
+    ASSERT(info.bytes == 2 * (7 + 100 * 5));
+    ASSERT(info.handler_ns > 0);
+}
+
+void test_metrics_handler() {
+    CollectingHandler collector;
+    MetricsHandler reporter(&collector, std::chrono::milliseconds(3600000));
+    Logger* log = get_logger("metrics.report");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(&reporter);
+    log->info("first");
+    log->trace("dropped");
+    
+    ASSERT(reporter.report() >= 1);
+    bool found = false;
+    for (auto& line : collector.lines) {
+        found |= line == "logging metrics logger=metrics.report emitted=1 filtered=1 bytes=5 handler_ns=" +
+                         line.substr(line.rfind('=') + 1);
+    }
+    ASSERT(found);
+    
+    collector.lines.clear();
+    reporter.report();
+    for (auto& line : collector.lines) {
+        ASSERT(line.find("logger=metrics.report ") == std::string::npos);
+    }
+    log->remove_handler(&reporter);
+}
+
+void run_metrics_tests() {
+    TEST(test_logger_metrics)
+    TEST(test_handler_timing)
+    TEST(test_metrics_handler)
+}
@@ -0,0 +1,86 @@
+
+#include <vector>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_rate_limit.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+void test_rate_burst() {
+    CollectingHandler collector;
+    RateLimitHandler limiter(&collector, 0.001, 3);
+    Logger* log = get_logger("rate.burst");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(&limiter);
+    
+    for (int i = 0; i < 10; ++i) {
+        AT_WARN(log, "Repeated warning");
+    }
+    for (int i = 0; i < 5; ++i) {
+        AT_WARN(log, "Other warning");
+    }
+    
+    ASSERT(collector.lines.size() == 6);
+    ASSERT(collector.lines[0] == "Repeated warning");
+    ASSERT(collector.lines[3] == "Other warning");
+    ASSERT(limiter.get_dropped() == 9);
+    
+    limiter.flush_summary();
+    ASSERT(collector.lines.size() == 8);
+    ASSERT(collector.lines[6].find("Suppressed 7 messages from ") == 0);
+    ASSERT(collector.lines[7].find("Suppressed 2 messages from ") == 0);
+    ASSERT(limiter.get_dropped() == 0);
+    
+    log->remove_handler(&limiter);
+}
+
+void test_rate_no_location() {
+    CollectingHandler collector;
+    RateLimitHandler limiter(&collector, 0.001, 2);
+    for (int i = 0; i < 4; ++i) {
+        limiter.log("same text", WARN);
+        limiter.log("different text", WARN);
+    }
+    ASSERT(collector.lines.size() == 4);
+    ASSERT(limiter.get_dropped() == 4);
+    
+    limiter.flush_summary();
+    ASSERT(collector.lines.back() == "Suppressed 2 messages");
+}
+
+void test_rate_sampling() {
+    CollectingHandler collector;
+    RateLimitHandler limiter(&collector, 1e9, 1000000);
+    limiter.set_sample_rate(DEBUG, 0);
+    limiter.set_sample_rate(INFO, 0.5);
+    
+    for (int i = 0; i < 10000; ++i) {
+        limiter.log("debug", DEBUG);
+        limiter.log("info", INFO);
+        limiter.log("warn", WARN);
+    }
+    
+    ulong debug = 0, info = 0, warn = 0;
+    for (const auto& line : collector.lines) {
+        debug += line == "debug";
+        info += line == "info";
+        warn += line == "warn";
+    }
+    ASSERT(debug == 0);
+    ASSERT(info > 4000 && info < 6000);
+    ASSERT(warn == 10000);
+    
+    limiter.flush_summary();
+    ASSERT(collector.lines[collector.lines.size() - 2] == "Sampled out 10000 DEBUG messages");
+    ASSERT(collector.lines.back() == "Sampled out " + std::to_string(10000 - info) + " INFO messages");
+}
+
+void run_rate_limit_tests() {
+    __ensure_levels();
+    TEST(test_rate_burst)
+    TEST(test_rate_no_location)
+    TEST(test_rate_sampling)
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void run_rate_limit_tests();
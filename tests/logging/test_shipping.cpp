@@ -0,0 +1,208 @@
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_shipping.h"
+
+using namespace logging;
+
+namespace {
+
+/**
+ * Collector that accepts one connection at a time on a listening socket, and reads records until it has enough
+ */
+class TestCollector {
+public:
+    
+    network::Socket server;
+    std::vector<ShippedRecord> records;
+    ulong batches = 0;
+    
+    explicit TestCollector(ushort domain) : server(domain, (uint)SOCK_STREAM) {}
+    
+    void collect(ulong wanted) {
+        while (records.size() < wanted) {
+            network::Socket connection = server.accept();
+            while (records.size() < wanted && read_batch(connection, records)) {
+                batches++;
+            }
+        }
+    }
+    
+};
+
+/**
+ * Get a per-process path for a temporary file
+ */
+std::string temp_path(const std::string& name) {
+    return "/tmp/at_" + name + "_" + std::to_string(thread_id());
+}
+
+}
+
+void test_ship_tcp() {
+    TestCollector collector((ushort)AF_INET);
+    int reuse = 1;
+    collector.server.setopt(network::SockOpt::REUSEADDR, &reuse);
+    collector.server.bind(8082);
+    collector.server.listen(4);
+    std::thread reader([&collector]() { collector.collect(1000); });
+    
+    ShippingHandler* shipper = new ShippingHandler("127.0.0.1", 8082);
+    shipper->set_batching(300, 1024 * 1024, std::chrono::seconds(10));
+    Logger* log = get_logger("ship.tcp");
+    log->set_propagation(false);
+    log->set_pattern("%l %m");
+    log->add_handler(shipper);
+    for (int i = 0; i < 1000; ++i) {
+        log->log("record " + std::to_string(i), i % 2 ? WARN : INFO);
+    }
+    shipper->flush();
+    reader.join();
+    log->remove_handler(shipper);
+    
+    ASSERT(collector.records.size() == 1000);
+    ASSERT(collector.records[0].text == "INFO record 0");
+    ASSERT(collector.records[0].level == INFO);
+    ASSERT(collector.records[999].text == "WARN record 999");
+    ASSERT(collector.records[999].level == WARN);
+    ASSERT(collector.batches == 4);
+    
+    ShipStats stats = shipper->get_stats();
+    ASSERT(stats.records == 1000);
+    ASSERT(stats.batches == 4);
+    ASSERT(stats.sends == 4);
+    ASSERT(stats.connects == 1);
+    ASSERT(stats.sent_bytes < stats.raw_bytes);
+    delete shipper;
+}
+
+void test_ship_spill() {
+#ifdef _WIN32
+    throw testing::skip_test("Unix domain sockets aren't supported on this platform");
+#else
+    std::string socket_path = temp_path("ship_socket");
+    std::string spill_path = temp_path("ship_spill");
+    std::remove(socket_path.c_str());
+    std::remove(spill_path.c_str());
+    
+    ShippingHandler* shipper = new ShippingHandler(socket_path);
+    shipper->set_spill(spill_path, 1024 * 1024);
+    shipper->set_backoff(std::chrono::milliseconds(1), std::chrono::milliseconds(1));
+    shipper->set_compression(false);
+    Logger* log = get_logger("ship.spill");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(shipper);
+    for (int i = 0; i < 10; ++i) {
+        log->info("early " + std::to_string(i));
+    }
+    shipper->flush();
+    
+    ShipStats stats = shipper->get_stats();
+    ASSERT(stats.sends == 0);
+    ASSERT(stats.failures >= 1);
+    ASSERT(stats.spilled_bytes > 0);
+    
+    TestCollector collector((ushort)AF_UNIX);
+    collector.server.bind(socket_path);
+    collector.server.listen(4);
+    std::thread reader([&collector]() { collector.collect(15); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    for (int i = 0; i < 5; ++i) {
+        log->error("late " + std::to_string(i));
+    }
+    shipper->flush();
+    reader.join();
+    log->remove_handler(shipper);
+    
+    ASSERT(collector.records.size() == 15);
+    ASSERT(collector.records[0].text == "early 0");
+    ASSERT(collector.records[9].text == "early 9");
+    ASSERT(collector.records[10].text == "late 0");
+    ASSERT(collector.records[14].level == ERROR);
+    
+    stats = shipper->get_stats();
+    ASSERT(stats.replayed_bytes == stats.spilled_bytes);
+    ASSERT(stats.dropped == 0);
+    delete shipper;
+    ASSERT(std::fopen(spill_path.c_str(), "rb") == nullptr);
+    std::remove(socket_path.c_str());
+#endif
+}
+
+void test_ship_settings_while_sending() {
+    TestCollector collector((ushort)AF_INET);
+    int reuse = 1;
+    collector.server.setopt(network::SockOpt::REUSEADDR, &reuse);
+    collector.server.bind(8082);
+    collector.server.listen(4);
+    std::thread reader([&collector]() { collector.collect(2000); });
+    
+    std::string spill_path = temp_path("ship_settings");
+    std::remove(spill_path.c_str());
+    ShippingHandler* shipper = new ShippingHandler("127.0.0.1", 8082);
+    shipper->set_batching(50, 1024 * 1024, std::chrono::milliseconds(1));
+    Logger* log = get_logger("ship.settings");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(shipper);
+    std::thread writer([log]() {
+        for (int i = 0; i < 2000; ++i) {
+            log->info("record " + std::to_string(i));
+        }
+    });
+    for (int i = 0; i < 200; ++i) {
+        shipper->set_compression(i % 2 == 0);
+        shipper->set_backoff(std::chrono::milliseconds(1 + i % 3), std::chrono::milliseconds(10));
+        shipper->set_spill(i % 2 ? spill_path : "", 1024 * 1024);
+    }
+    writer.join();
+    shipper->flush();
+    reader.join();
+    log->remove_handler(shipper);
+    
+    ASSERT(collector.records.size() == 2000);
+    ASSERT(collector.records[0].text == "record 0");
+    ASSERT(collector.records[1999].text == "record 1999");
+    ShipStats stats = shipper->get_stats();
+    ASSERT(stats.records == 2000);
+    ASSERT(stats.dropped == 0);
+    ASSERT(stats.connects == 1);
+    delete shipper;
+    std::remove(spill_path.c_str());
+}
+
+void test_ship_dropped() {
+    ShippingHandler shipper("/nonexistent/at_socket");
+    shipper.set_backoff(std::chrono::milliseconds(1000), std::chrono::milliseconds(1000));
+    Logger* log = get_logger("ship.dropped");
+    log->set_propagation(false);
+    log->add_handler(&shipper);
+    log->info("lost");
+    shipper.flush();
+    log->remove_handler(&shipper);
+    ASSERT(shipper.get_stats().dropped == 1);
+}
+
+void test_parse_batch_limits() {
+    std::vector<ShippedRecord> records;
+    char huge[] = {1, 1, 0, 0, 0, '\xff', '\xff', '\xff', '\xff', 0x10, 'x'};
+    ASSERT_THROWS(std::runtime_error, [&]() { parse_batch(huge, sizeof(huge), records); });
+    char lying[] = {1, 1, 0, 0, 0, 0, 0, 0, 1, 0x10, 'x'};
+    ASSERT_THROWS(std::runtime_error, [&]() { parse_batch(lying, sizeof(lying), records); });
+    ASSERT(records.empty());
+}
+
+void run_shipping_tests() {
+    __ensure_levels();
+    TEST(test_ship_tcp)
+    TEST(test_ship_spill)
+    TEST(test_ship_settings_while_sending)
+    TEST(test_ship_dropped)
+    TEST(test_parse_batch_limits)
+}
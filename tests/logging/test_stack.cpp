@@ -0,0 +1,73 @@
+
+#include <cstdio>
+#include <exception>
+#include <sstream>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_stack.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+void test_capture_stack() {
+    void* frames[AT_STACK_DEPTH];
+    uint depth = capture_stack(frames, AT_STACK_DEPTH, 0);
+    if (depth == 0) {
+        throw testing::skip_test("Stack capture unsupported on this platform");
+    }
+    ASSERT(depth <= AT_STACK_DEPTH);
+    ASSERT(capture_stack(frames, 2, 0) == 2);
+    
+    std::string terminate = symbolize(reinterpret_cast<const void*>(&std::terminate));
+    ASSERT(terminate.find("std::terminate()+0x0") == 0);
+    ASSERT(symbolize(reinterpret_cast<const void*>(&std::terminate)) == terminate);
+    
+    std::string out;
+    render_stack(out, frames, 2);
+    ASSERT(out.find("\n    #0 ") == 0);
+    ASSERT(out.find("\n    #1 ") != std::string::npos);
+}
+
+void test_logged_stack() {
+    void* probe[1];
+    if (capture_stack(probe, 1, 0) == 0) {
+        throw testing::skip_test("Stack capture unsupported on this platform");
+    }
+    CollectingHandler collector;
+    Logger* log = get_logger("stack.logged");
+    log->set_propagation(false);
+    log->set_level(INFO);
+    log->set_pattern("%l %m");
+    log->add_handler(&collector);
+    
+    set_stack_level(ERROR);
+    log->info("plain");
+    log->error("broken");
+    log->set_pattern("%S|%m");
+    log->fatal("placed");
+    set_stack_level(nullptr);
+    log->error("uncaptured");
+    log->remove_handler(&collector);
+    
+    ASSERT(collector.lines.size() == 4);
+    ASSERT(collector.lines[0] == "INFO plain");
+    ASSERT(collector.lines[1].find("ERROR broken\n    #0 ") == 0);
+    ASSERT(collector.lines[2].find("\n    #0 ") == 0);
+    ASSERT(collector.lines[2].find("|placed") != std::string::npos);
+    ASSERT(collector.lines[3] == "|uncaptured");
+    
+    std::ostringstream stream;
+    StreamHandler json(stream, RecordFormat::JSON);
+    log->add_handler(&json);
+    set_stack_level(WARN);
+    log->warn("with stack");
+    set_stack_level(nullptr);
+    log->remove_handler(&json);
+    ASSERT(stream.str().find(",\"stack\":[\"") != std::string::npos);
+}
+
+void run_stack_tests() {
+    TEST(test_capture_stack)
+    TEST(test_logged_stack)
+}
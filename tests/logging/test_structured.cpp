@@ -0,0 +1,162 @@
+
+#include <sstream>
+#include <cmath>
+#include <at_tests>
+#include <at_logging>
+
+#include "test_structured.h"
+#include "collecting_handler.h"
+
+using namespace logging;
+
+namespace {
+
+/**
+ * Handler that keeps every record's text, and whether it was given any
+ */
+class FieldCollector : public CollectingHandler {
+public:
+    
+    ulong untexted = 0;
+    bool wants_text = true;
+    
+    bool needs_text() const override {
+        return wants_text;
+    }
+    
+    void handle(const Record& record) override {
+        if (record.text == nullptr) {
+            untexted++;
+        } else {
+            lines.push_back(*record.text);
+        }
+    }
+    
+};
+
+}
+
+void test_field_types() {
+    Field a("a", 5);
+    ASSERT(a.type == FieldType::INT && a.int_value == 5);
+    Field b("b", (ulong)7);
+    ASSERT(b.type == FieldType::UINT && b.uint_value == 7);
+    Field c("c", 1.5f);
+    ASSERT(c.type == FieldType::DOUBLE && c.double_value == 1.5);
+    Field d("d", true);
+    ASSERT(d.type == FieldType::BOOL && d.bool_value);
+    std::string text = "text";
+    Field e("e", text);
+    ASSERT(e.type == FieldType::STRING && e.string_value.data == text.data());
+    Field f("f", math::Vector(1, 2.5, -3));
+    ASSERT(f.type == FieldType::VECTOR && f.vector_value.y == 2.5);
+    
+    std::string out;
+    f.render_value(out);
+    ASSERT(out == "(1,2.5,-3)");
+}
+
+void test_field_text() {
+    FieldCollector collector;
+    Logger* log = get_logger("structured.text");
+    log->set_propagation(false);
+    log->set_pattern("%l: %m");
+    log->add_handler(&collector);
+    
+    log->info("Request done", {{"id", 42}, {"path", "/index.html"}, {"latency", 0.25}});
+    ASSERT(collector.lines.back() == "INFO: Request done id=42 path=/index.html latency=0.25");
+    
+    log->warn("Odd input", {{"value", "two words"}, {"empty", ""}, {"quoted", "say \"hi\""}});
+    ASSERT(collector.lines.back() == "WARN: Odd input value=\"two words\" empty=\"\" quoted=\"say \\\"hi\\\"\"");
+    
+    log->set_pattern("[%k] %m");
+    AT_LOG_FIELDS(log, INFO, "Moved", {"pos", math::Vector(0, 1, 0)}, {"ok", false});
+    ASSERT(collector.lines.back() == "[pos=(0,1,0) ok=false] Moved");
+    
+    log->info("Plain");
+    ASSERT(collector.lines.back() == "[] Plain");
+    
+    log->remove_handler(&collector);
+}
+
+void test_field_json() {
+    std::string name = "structured.json";
+    std::string message = "Line\none \"quoted\"";
+    Field fields[] = {{"count", -3}, {"ratio", 0.5}, {"pos", math::Vector(1, 2, 3)}, {"tag", "a\tb"}};
+    Record record = {WARN, &name, &message, nullptr, SourceLocation {"file.cpp", 12, "main"}, fields, 4};
+    
+    std::string out;
+    render_json(out, record);
+    ASSERT(out == "{\"level\":\"WARN\",\"logger\":\"structured.json\",\"message\":\"Line\\none \\\"quoted\\\"\","
+                  "\"file\":\"file.cpp\",\"line\":12,\"count\":-3,\"ratio\":0.5,\"pos\":[1,2,3],\"tag\":\"a\\tb\"}");
+    
+    Field odd[] = {{"nan", std::nan("")}};
+    record.fields = odd;
+    record.field_count = 1;
+    record.location = SourceLocation();
+    out.clear();
+    render_json(out, record);
+    ASSERT(out.find("\"nan\":null}") != std::string::npos);
+    ASSERT(out.find("\"file\"") == std::string::npos);
+}
+
+void test_field_binary() {
+    std::string name = "bin";
+    std::string message = "hi";
+    Field fields[] = {{"n", (uint)258}, {"s", "ab"}};
+    Record record = {INFO, &name, &message, nullptr, SourceLocation(), fields, 2};
+    
+    std::string out;
+    render_binary(out, record);
+    ulong length = (uchar)out[0] | ((uchar)out[1] << 8) | ((uchar)out[2] << 16) | ((uchar)out[3] << 24);
+    ASSERT(length == out.size() - 4);
+    ASSERT((uchar)out[4] == 20);
+    ASSERT(out.compare(8, 5, "\x04INFO") == 0);
+    ASSERT(out.compare(13, 5, std::string("\x03\x00" "bin", 5)) == 0);
+    
+    ulong pos = 18 + 4 + 2 + 2 + 4;
+    ASSERT((uchar)out[pos] == 2);
+    ASSERT(out.compare(pos + 1, 3, "\x01n\x02") == 0);
+    ASSERT((uchar)out[pos + 4] == 2 && (uchar)out[pos + 5] == 1);
+    ASSERT(out.compare(out.size() - 7, 7, std::string("\x05\x02\x00\x00\x00" "ab", 7)) == 0);
+}
+
+void test_stream_handler() {
+    std::stringstream json_out, text_out;
+    StreamHandler json(json_out, RecordFormat::JSON);
+    StreamHandler text(text_out);
+    FieldCollector skipped;
+    skipped.wants_text = false;
+    
+    Logger* log = get_logger("structured.stream");
+    log->set_propagation(false);
+    log->set_pattern("%m");
+    log->add_handler(&json);
+    log->add_handler(&skipped);
+    
+    log->info("Only json", {{"id", 1}});
+    std::string json_line = json_out.str();
+    std::string json_tail = "\",\"level\":\"INFO\",\"logger\":\"structured.stream\",\"message\":\"Only json\",\"id\":1}\n";
+    ASSERT(json_line.rfind("{\"time\":\"", 0) == 0);
+    ASSERT(json_line.size() == 9 + 29 + json_tail.size());
+    ASSERT(json_line.compare(38, json_tail.size(), json_tail) == 0);
+    ASSERT(skipped.untexted == 1);
+    
+    log->add_handler(&text);
+    log->error("Both", {{"id", 2}});
+    ASSERT(text_out.str() == "Both id=2\n");
+    ASSERT(skipped.untexted == 2);
+    
+    log->remove_handler(&json);
+    log->remove_handler(&skipped);
+    log->remove_handler(&text);
+}
+
+void run_structured_tests() {
+    __ensure_levels();
+    TEST(test_field_types)
+    TEST(test_field_text)
+    TEST(test_field_json)
+    TEST(test_field_binary)
+    TEST(test_stream_handler)
+}
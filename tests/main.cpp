@@ -12,11 +12,31 @@
 #include "test_generic.h"
 #include "test_sfinae.h"
 #include "test_socket.h"
+#include "test_reactor.h"
+#include "test_transfer.h"
+#include "test_uring.h"
+#include "test_sharded_server.h"
+#include "test_datagram.h"
+#include "test_framing.h"
+#include "test_stream.h"
 #include "test_memory.h"
 #include "test_argparse.h"
+#include "test_compress.h"
+#include "test_rcu.h"
 
 #include "logging/test_level.h"
 #include "logging/test_logging.h"
+#include "logging/test_binary.h"
+#include "logging/test_file_handler.h"
+#include "logging/test_log_index.h"
+#include "logging/test_rate_limit.h"
+#include "logging/test_structured.h"
+#include "logging/test_flight_recorder.h"
+#include "logging/test_shipping.h"
+#include "logging/test_aggregate.h"
+#include "logging/test_config.h"
+#include "logging/test_metrics.h"
+#include "logging/test_stack.h"
 
 #include "math/test_matrix.h"
 #include "math/test_vector.h"
@@ -40,11 +60,31 @@ int main(int argc, char** argv) {
     TEST_FILE(generic)
     TEST_FILE(sfinae)
     TEST_FILE(socket)
+    TEST_FILE(reactor)
+    TEST_FILE(transfer)
+    TEST_FILE(uring)
+    TEST_FILE(sharded_server)
+    TEST_FILE(datagram)
+    TEST_FILE(framing)
+    TEST_FILE(stream)
     TEST_FILE(memory)
     TEST_FILE(argparse)
+    TEST_FILE(compress)
+    TEST_FILE(rcu)
     
     TEST_FILE(level)
     TEST_FILE(logging)
+    TEST_FILE(binary)
+    TEST_FILE(file_handler)
+    TEST_FILE(log_index)
+    TEST_FILE(rate_limit)
+    TEST_FILE(structured)
+    TEST_FILE(flight_recorder)
+    TEST_FILE(shipping)
+    TEST_FILE(aggregate)
+    TEST_FILE(config)
+    TEST_FILE(metrics)
+    TEST_FILE(stack)
     
     TEST_FILE(matrix)
     TEST_FILE(vector)
@@ -0,0 +1,63 @@
+
+#include <random>
+#include <stdexcept>
+#include "at_tests"
+#include "utils/compress.h"
+
+#include "test_compress.h"
+
+/**
+ * Compress and decompress a block, checking it comes back unchanged
+ */
+static std::string round_trip(const std::string& input) {
+    std::string compressed;
+    util::compress(input.data(), input.size(), compressed);
+    std::string output = "prefix";
+    util::decompress(compressed.data(), compressed.size(), output, input.size());
+    ASSERT(output == "prefix" + input);
+    return compressed;
+}
+
+void test_compress_text() {
+    std::string text;
+    for (int i = 0; i < 500; ++i) {
+        text += "INFO: request " + std::to_string(i) + " handled in 12ms by worker 3\n";
+    }
+    std::string compressed = round_trip(text);
+    ASSERT(compressed.size() < text.size() / 3);
+    
+    round_trip(std::string(100000, 'a'));
+    round_trip("short");
+    round_trip("");
+}
+
+void test_compress_random() {
+    std::mt19937 random(1234);
+    std::string noise;
+    for (int i = 0; i < 70000; ++i) {
+        noise += (char)random();
+    }
+    std::string compressed = round_trip(noise);
+    ASSERT(compressed.size() < noise.size() + noise.size() / 100 + 16);
+}
+
+void test_decompress_corrupt() {
+    std::string text(1000, 'x');
+    std::string compressed;
+    util::compress(text.data(), text.size(), compressed);
+    std::string output;
+    ASSERT_THROWS(std::runtime_error, [&]() { util::decompress(compressed.data(), compressed.size(), output, 999); });
+    output.clear();
+    ASSERT_THROWS(std::runtime_error, [&]() {
+        util::decompress(compressed.data(), compressed.size() - 3, output, 1000);
+    });
+    output.clear();
+    std::string bad_offset = "\x14" "a\xFF\x00";
+    ASSERT_THROWS(std::runtime_error, [&]() { util::decompress(bad_offset.data(), 4, output, 100); });
+}
+
+void run_compress_tests() {
+    TEST(test_compress_text)
+    TEST(test_compress_random)
+    TEST(test_decompress_corrupt)
+}
@@ -0,0 +1,152 @@
+
+#include <cstring>
+#include <string>
+#include "at_tests"
+#include "network/datagram.h"
+#include "test_datagram.h"
+
+/**
+ * Open a UDP socket bound to a port, which gives up receiving after a second
+ */
+static network::Socket bound_udp(ushort port) {
+    network::Socket socket((ushort)AF_INET, (uint)SOCK_DGRAM);
+    socket.set(network::SockOpt::REUSEADDR, 1);
+    socket.bind(port);
+    socket.set(network::SockOpt::RCVTIMEO, timeval {1, 0});
+    return socket;
+}
+
+void test_send_recv_to() {
+    network::Socket receiver = bound_udp(8092);
+    network::Socket sender = bound_udp(8093);
+    
+    network::IOResult result = sender.send_to("datagram", 8, network::Endpoint("127.0.0.1", 8092));
+    ASSERT(result.ok());
+    ASSERT(result.bytes == 8);
+    
+    char buffer[16];
+    network::Endpoint from;
+    result = receiver.recv_from(buffer, sizeof(buffer), from);
+    ASSERT(result.ok());
+    ASSERT(std::string(buffer, result.bytes) == "datagram");
+    ASSERT(from.ip.text == "127.0.0.1");
+    ASSERT(from.port == 8093);
+    
+    sender.send_to("truncated", 9, network::Endpoint("127.0.0.1", 8092));
+    result = receiver.recv_from(buffer, 4, from);
+    ASSERT(std::string(buffer, result.bytes) == "trun");
+}
+
+void test_datagram_batch() {
+    network::Socket receiver = bound_udp(8092);
+    network::Socket sender = bound_udp(8093);
+    network::Endpoint target("127.0.0.1", 8092);
+    
+    network::DatagramBatch outgoing(8, 64);
+    ASSERT(outgoing.get_capacity() == 8);
+    ASSERT(outgoing.get_slot_size() == 64);
+    for (uint i = 0; i < 7; ++i) {
+        std::string message = "message " + std::to_string(i);
+        ASSERT(outgoing.push(message.data(), message.size(), target));
+    }
+    std::memcpy(outgoing.data(7), "in place", 8);
+    ASSERT(outgoing.commit(8, target));
+    ASSERT(!outgoing.push("full", 4, target));
+    ASSERT_THROWS(std::out_of_range, [&]() {
+        outgoing.length(8);
+    });
+    
+    network::IOResult result = network::send_batch(sender, outgoing);
+    ASSERT(result.ok());
+    ASSERT(outgoing.get_sent() == 8);
+    ASSERT(result.bytes == 7 * 9 + 8);
+    
+    network::DatagramBatch incoming(4, 64);
+    std::vector<std::string> received;
+    while (received.size() < 8) {
+        result = network::recv_batch(receiver, incoming);
+        ASSERT(result.ok());
+        ASSERT(incoming.size() > 0 && incoming.size() <= 4);
+        for (ulong i = 0; i < incoming.size(); ++i) {
+            received.emplace_back(incoming.data(i), incoming.length(i));
+            ASSERT(incoming.get_endpoint(i).port == 8093);
+            ASSERT(incoming.get_segment_size(i) == 0);
+        }
+    }
+    for (uint i = 0; i < 7; ++i) {
+        ASSERT(received[i] == "message " + std::to_string(i));
+    }
+    ASSERT(received[7] == "in place");
+    
+    outgoing.clear();
+    ASSERT(outgoing.size() == 0);
+    ASSERT_THROWS(std::out_of_range, [&]() {
+        std::string large(65, 'x');
+        outgoing.push(large.data(), large.size(), target);
+    });
+}
+
+void test_send_segmented() {
+    network::Socket receiver = bound_udp(8092);
+    network::Socket sender = bound_udp(8093);
+    
+    std::string payload;
+    for (uint i = 0; i < 1050; ++i) {
+        payload += (char)('a' + i % 26);
+    }
+    network::IOResult result = network::send_segmented(sender, payload.data(), payload.size(), 100,
+                                                       network::Endpoint("127.0.0.1", 8092));
+    ASSERT(result.ok());
+    ASSERT(result.bytes == payload.size());
+    
+    network::DatagramBatch incoming(16, 256);
+    std::string received;
+    ulong datagrams = 0;
+    while (received.size() < payload.size()) {
+        ASSERT(network::recv_batch(receiver, incoming).ok());
+        for (ulong i = 0; i < incoming.size(); ++i) {
+            ASSERT(incoming.length(i) == (datagrams < 10 ? 100ul : 50ul));
+            received.append(incoming.data(i), incoming.length(i));
+            datagrams++;
+        }
+    }
+    ASSERT(datagrams == 11);
+    ASSERT(received == payload);
+    
+    ASSERT(network::send_segmented(sender, payload.data(), payload.size(), 0, network::Endpoint()).error == EINVAL);
+}
+
+void test_receive_offload() {
+    network::Socket receiver = bound_udp(8092);
+    network::Socket sender = bound_udp(8093);
+    try {
+        receiver.set(network::SockOpt::GRO, 1);
+    } catch (network::socket_error&) {
+        throw testing::skip_test("UDP receive offload isn't supported");
+    }
+    
+    std::string payload(4000, 'g');
+    ASSERT(network::send_segmented(sender, payload.data(), payload.size(), 1000,
+                                   network::Endpoint("127.0.0.1", 8092)).ok());
+    
+    network::DatagramBatch incoming(8, AT_DATAGRAM_MAX);
+    ulong received = 0;
+    while (received < payload.size()) {
+        network::IOResult result = network::recv_batch(receiver, incoming);
+        ASSERT(result.ok());
+        for (ulong i = 0; i < incoming.size(); ++i) {
+            ulong segment = incoming.get_segment_size(i);
+            ASSERT(segment == 0 || segment == 1000);
+            ASSERT(segment != 0 || incoming.length(i) == 1000);
+        }
+        received += result.bytes;
+    }
+    ASSERT(received == payload.size());
+}
+
+void run_datagram_tests() {
+    TEST(test_send_recv_to)
+    TEST(test_datagram_batch)
+    TEST(test_send_segmented)
+    TEST(test_receive_offload)
+}
@@ -0,0 +1,215 @@
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "at_tests"
+#include "network/framing.h"
+#include "test_framing.h"
+
+/**
+ * Encode a list of payloads into the bytes that would be sent
+ */
+static std::string encode(const network::FrameOptions& options, const std::vector<std::string>& payloads) {
+    network::FrameEncoder encoder(options);
+    for (auto& payload : payloads) {
+        encoder.write(payload.data(), payload.size());
+    }
+    network::ConstBuffer pending = encoder.peek();
+    return std::string(pending.data, pending.length);
+}
+
+void test_frame_roundtrip() {
+    network::LengthPrefix prefixes[] = {network::LengthPrefix::VARINT, network::LengthPrefix::FIXED16,
+                                        network::LengthPrefix::FIXED32, network::LengthPrefix::FIXED64};
+    std::vector<std::string> payloads = {"", "a", std::string(127, 'b'), std::string(128, 'c'),
+                                         std::string(300, 'd')};
+    for (auto prefix : prefixes) {
+        for (bool checksum : {false, true}) {
+            network::FrameOptions options;
+            options.prefix = prefix;
+            options.checksum = checksum;
+            std::string encoded = encode(options, payloads);
+            
+            network::BufferPool pool(64);
+            network::FrameDecoder decoder(pool, options);
+            std::vector<network::Frame> frames;
+            network::Frame frame;
+            for (char byte : encoded) {
+                decoder.feed(&byte, 1);
+                while (decoder.next(frame)) {
+                    frames.push_back(frame);
+                }
+            }
+            ASSERT(decoder.get_buffered() == 0);
+            ASSERT(frames.size() == payloads.size());
+            for (ulong i = 0; i < payloads.size(); ++i) {
+                ASSERT(frames[i].str() == payloads[i]);
+            }
+        }
+    }
+}
+
+void test_frame_prefix_sizes() {
+    ASSERT(encode(network::FrameOptions(), {std::string(127, 'x')}).size() == 128);
+    ASSERT(encode(network::FrameOptions(), {std::string(128, 'x')}).size() == 130);
+    network::FrameOptions fixed;
+    fixed.prefix = network::LengthPrefix::FIXED32;
+    fixed.checksum = true;
+    std::string encoded = encode(fixed, {"abc"});
+    ASSERT(encoded.size() == 4 + 3 + 4);
+    ASSERT(encoded.substr(0, 4) == std::string("\x03\0\0\0", 4));
+}
+
+void test_frame_errors() {
+    network::FrameOptions options;
+    options.checksum = true;
+    options.max_frame = 16;
+    network::FrameEncoder encoder(options);
+    ASSERT_THROWS(network::frame_error, [&]() {
+        encoder.write(std::string(17, 'x').data(), 17);
+    });
+    ASSERT(encoder.get_pending() == 0);
+    
+    network::BufferPool pool;
+    network::Frame frame;
+    {
+        std::string encoded = encode(options, {"checked"});
+        encoded[3] ^= 1;
+        network::FrameDecoder decoder(pool, options);
+        decoder.feed(encoded.data(), encoded.size());
+        ASSERT_THROWS(network::frame_error, [&]() {
+            decoder.next(frame);
+        });
+    }
+    {
+        network::FrameOptions unlimited = options;
+        unlimited.max_frame = AT_FRAME_MAX;
+        std::string encoded = encode(unlimited, {std::string(17, 'x')});
+        network::FrameDecoder decoder(pool, options);
+        decoder.feed(encoded.data(), 1);
+        ASSERT_THROWS(network::frame_error, [&]() {
+            decoder.next(frame);
+        });
+    }
+    {
+        std::string encoded(11, '\xFF');
+        network::FrameDecoder decoder(pool, options);
+        decoder.feed(encoded.data(), encoded.size());
+        ASSERT_THROWS(network::frame_error, [&]() {
+            decoder.next(frame);
+        });
+    }
+    {
+        network::FrameOptions small;
+        small.prefix = network::LengthPrefix::FIXED16;
+        network::FrameEncoder narrow(small);
+        ASSERT_THROWS(network::frame_error, [&]() {
+            std::string large(70000, 'x');
+            narrow.write(large.data(), large.size());
+        });
+    }
+}
+
+void test_frame_pooling() {
+    network::BufferPool pool(64, 4);
+    std::vector<std::string> payloads;
+    for (uint i = 0; i < 50; ++i) {
+        payloads.push_back(std::string(i * 3, (char)('a' + i % 26)));
+    }
+    std::string encoded = encode(network::FrameOptions(), payloads);
+    {
+        network::FrameDecoder decoder(pool);
+        std::vector<network::Frame> frames;
+        network::Frame frame;
+        ulong offset = 0;
+        while (offset < encoded.size()) {
+            network::MutableBuffer space = decoder.prepare();
+            ulong length = std::min(space.length, std::min<ulong>(17, encoded.size() - offset));
+            std::memcpy(space.data, encoded.data() + offset, length);
+            decoder.commit(length);
+            offset += length;
+            while (decoder.next(frame)) {
+                frames.push_back(frame);
+            }
+        }
+        ASSERT(frames.size() == payloads.size());
+        for (ulong i = 0; i < payloads.size(); ++i) {
+            ASSERT(frames[i].str() == payloads[i]);
+        }
+        ASSERT(pool.get_allocated() > 1);
+        frames.clear();
+        frame = network::Frame();
+        ASSERT(pool.get_allocated() == 1);
+    }
+    ASSERT(pool.get_allocated() == 0);
+    ASSERT(pool.get_free() > 0 && pool.get_free() <= 4);
+    
+    network::FrameDecoder decoder(pool);
+    network::Frame frame;
+    for (uint i = 0; i < 100; ++i) {
+        std::string encoded_one = encode(network::FrameOptions(), {"reuse"});
+        decoder.feed(encoded_one.data(), encoded_one.size());
+        ASSERT(decoder.next(frame));
+        ASSERT(frame.str() == "reuse");
+    }
+    frame = network::Frame();
+    ASSERT(pool.get_allocated() == 1);
+}
+
+void test_frame_socket() {
+    network::Socket listener = network::Socket();
+    listener.set(network::SockOpt::REUSEADDR, 1);
+    listener.bind(8094);
+    listener.listen(1);
+    
+    const uint count = 2000;
+    std::thread client([count]() {
+        network::Socket socket = network::Socket();
+        socket.connect("127.0.0.1", 8094);
+        network::FrameOptions options;
+        options.checksum = true;
+        network::FrameEncoder encoder(options, 4096);
+        for (uint i = 0; i < count; ++i) {
+            std::string payload = "frame " + std::to_string(i);
+            encoder.write(payload.data(), payload.size());
+            if (encoder.should_flush()) {
+                encoder.flush(socket);
+            }
+        }
+        encoder.flush(socket);
+        socket.shutdown(SHUT_WR);
+        char done;
+        socket.recv_into(&done, 1);
+    });
+    
+    network::Socket server = listener.accept();
+    network::BufferPool pool(1024);
+    network::FrameOptions options;
+    options.checksum = true;
+    network::FrameDecoder decoder(pool, options);
+    network::Frame frame;
+    uint received = 0;
+    bool in_order = true;
+    network::IOResult result;
+    while ((result = decoder.read_from(server)).bytes > 0) {
+        while (decoder.next(frame)) {
+            in_order = in_order && frame.str() == "frame " + std::to_string(received);
+            received++;
+        }
+    }
+    server.send_all("!", 1);
+    client.join();
+    ASSERT(result.ok());
+    ASSERT(in_order);
+    ASSERT(received == count);
+}
+
+void run_framing_tests() {
+    TEST(test_frame_roundtrip)
+    TEST(test_frame_prefix_sizes)
+    TEST(test_frame_errors)
+    TEST(test_frame_pooling)
+    TEST(test_frame_socket)
+}
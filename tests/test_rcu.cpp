@@ -0,0 +1,85 @@
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "at_tests"
+#include "utils/rcu.h"
+
+#include "test_rcu.h"
+
+namespace {
+
+/**
+ * Object that counts its live instances, and checks it's never read after being freed
+ */
+struct Tracked {
+    
+    static std::atomic<int> live;
+    std::atomic<ulong> value;
+    
+    explicit Tracked(ulong value) : value(value) {
+        live++;
+    }
+    
+    ~Tracked() {
+        value = 0;
+        live--;
+    }
+    
+};
+
+std::atomic<int> Tracked::live {0};
+
+}
+
+void test_rcu_retire() {
+    std::atomic<Tracked*> current {new Tracked(1)};
+    {
+        util::RcuReadGuard guard;
+        Tracked* seen = current.load();
+        util::rcu_retire(current.exchange(new Tracked(2)));
+        {
+            util::RcuReadGuard nested;
+        }
+        ASSERT(seen->value == 1);
+        ASSERT(Tracked::live == 2);
+        ASSERT(util::rcu_pending() >= 1);
+    }
+    util::rcu_synchronize();
+    ASSERT(Tracked::live == 1);
+    delete current.load();
+}
+
+void test_rcu_readers() {
+    std::atomic<Tracked*> current {new Tracked(1)};
+    std::atomic<bool> stop {false};
+    std::atomic<ulong> bad {0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                util::RcuReadGuard guard;
+                Tracked* seen = current.load(std::memory_order_acquire);
+                if (seen->value == 0) {
+                    bad++;
+                }
+            }
+        });
+    }
+    for (ulong i = 2; i < 2000; ++i) {
+        util::rcu_retire(current.exchange(new Tracked(i), std::memory_order_acq_rel));
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    util::rcu_synchronize();
+    ASSERT(bad == 0);
+    ASSERT(Tracked::live == 1);
+    delete current.load();
+}
+
+void run_rcu_tests() {
+    TEST(test_rcu_retire)
+    TEST(test_rcu_readers)
+}
@@ -0,0 +1,150 @@
+
+#include <memory>
+#include <thread>
+#include "at_tests"
+#include "network/uring.h"
+#include "test_reactor.h"
+
+using namespace std::chrono_literals;
+
+/**
+ * Run a check against a fresh event loop of every backend this kernel supports
+ */
+template<typename Check>
+static void for_each_backend(Check check) {
+    std::unique_ptr<network::EventLoop> epoll_loop(network::make_event_loop(network::LoopBackend::EPOLL));
+    check(*epoll_loop);
+    if (network::UringReactor::supported()) {
+        std::unique_ptr<network::EventLoop> uring_loop(network::make_event_loop(network::LoopBackend::IO_URING));
+        check(*uring_loop);
+    }
+}
+
+static void check_timers(network::EventLoop& reactor) {
+    int once = 0, repeated = 0, cancelled = 0;
+    reactor.add_timer(10ms, [&]() { once++; });
+    ulong repeat_id = reactor.add_timer(5ms, [&]() { repeated++; }, 5ms);
+    ulong cancel_id = reactor.add_timer(20ms, [&]() { cancelled++; });
+    ASSERT(reactor.cancel_timer(cancel_id));
+    ASSERT(!reactor.cancel_timer(cancel_id));
+    
+    auto end = std::chrono::steady_clock::now() + 60ms;
+    while (std::chrono::steady_clock::now() < end) {
+        reactor.run_once(10ms);
+    }
+    ASSERT(once == 1);
+    ASSERT(repeated >= 3);
+    ASSERT(cancelled == 0);
+    ASSERT(reactor.cancel_timer(repeat_id));
+}
+
+static void check_stop(network::EventLoop& reactor) {
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(20ms);
+        reactor.stop();
+    });
+    auto start = std::chrono::steady_clock::now();
+    reactor.run();
+    stopper.join();
+    ASSERT(std::chrono::steady_clock::now() - start < 5s);
+    
+    int runs = 0;
+    reactor.add_timer(1ms, [&]() {
+        runs++;
+        reactor.stop();
+    });
+    reactor.run();
+    ASSERT(runs == 1);
+}
+
+static void check_echo(network::EventLoop& reactor) {
+    network::Socket listener((ushort)AF_INET, (uint)SOCK_STREAM);
+    int reuse = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &reuse);
+    listener.bind(8083);
+    listener.listen(16);
+    
+    const uint clients = 4;
+    std::vector<network::Socket> accepted;
+    accepted.reserve(clients);
+    reactor.add(listener, network::IO_READ, [&](uint) {
+        ulong before = accepted.size();
+        listener.accept_many(accepted);
+        for (ulong i = before; i < accepted.size(); ++i) {
+            network::Socket* client = &accepted[i];
+            reactor.add(client->get_fd(), network::IO_READ, [client](uint) {
+                char buffer[256];
+                network::IOResult result;
+                while ((result = client->recv_into(buffer, sizeof(buffer))).bytes > 0) {
+                    client->send_all(buffer, result.bytes);
+                }
+            });
+        }
+    });
+    
+    std::vector<network::Socket> sockets;
+    sockets.reserve(clients);
+    for (uint i = 0; i < clients; ++i) {
+        sockets.emplace_back((ushort)AF_INET, (uint)SOCK_STREAM);
+        sockets.back().connect("127.0.0.1", 8083);
+    }
+    
+    std::string received;
+    for (uint i = 0; i < clients; ++i) {
+        network::Socket* client = &sockets[i];
+        reactor.add(sockets[i], network::IO_READ, [client, &received](uint) {
+            char buffer[256];
+            network::IOResult result;
+            while ((result = client->recv_into(buffer, sizeof(buffer))).bytes > 0) {
+                received.append(buffer, result.bytes);
+            }
+        });
+        ASSERT(sockets[i].send_all("ping", 4).bytes == 4);
+    }
+    
+    auto end = std::chrono::steady_clock::now() + 5s;
+    while (received.size() < clients * 4 && std::chrono::steady_clock::now() < end) {
+        reactor.run_once(100ms);
+    }
+    ASSERT(accepted.size() == clients);
+    ASSERT(received == "pingpingpingping");
+    ASSERT(reactor.get_watched() == 1 + 2 * clients);
+    
+    reactor.modify(sockets[0].get_fd(), network::IO_READ | network::IO_WRITE);
+    ASSERT(sockets[1].send_all("pong", 4).bytes == 4);
+    end = std::chrono::steady_clock::now() + 5s;
+    while (received.size() < clients * 4 + 4 && std::chrono::steady_clock::now() < end) {
+        reactor.run_once(100ms);
+    }
+    ASSERT(received.size() == clients * 4 + 4);
+    
+    for (auto& socket : sockets) {
+        ASSERT(reactor.remove(socket.get_fd()));
+    }
+    ASSERT(!reactor.remove(sockets[0].get_fd()));
+    ASSERT(reactor.get_watched() == 1 + clients);
+    for (auto& socket : accepted) {
+        ASSERT(reactor.remove(socket.get_fd()));
+    }
+    ASSERT(reactor.remove(listener.get_fd()));
+    ASSERT(reactor.get_watched() == 0);
+    reactor.run_once(0ms);
+}
+
+void test_reactor_timers() {
+    for_each_backend(check_timers);
+}
+
+void test_reactor_stop() {
+    for_each_backend(check_stop);
+}
+
+void test_reactor_echo() {
+    for_each_backend(check_echo);
+}
+
+void run_reactor_tests() {
+    TEST(test_reactor_timers)
+    TEST(test_reactor_stop)
+    TEST(test_reactor_echo)
+}
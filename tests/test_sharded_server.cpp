@@ -0,0 +1,72 @@
+
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include "at_tests"
+#include "network/sharded_server.h"
+#include "test_sharded_server.h"
+
+using namespace std::chrono_literals;
+
+void test_sharded_server() {
+    network::ShardedServer server(8090, 2, network::LoopBackend::EPOLL);
+    ASSERT(server.get_workers() == 2);
+    
+    std::mutex lock;
+    std::vector<std::unique_ptr<network::Socket>> served;
+    server.start([&](network::EventLoop& loop, network::Socket socket) {
+        network::Socket* connection = new network::Socket(std::move(socket));
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            served.emplace_back(connection);
+        }
+        loop.add(*connection, network::IO_READ, [&loop, connection](uint) {
+            char buffer[64];
+            network::IOResult result;
+            while ((result = connection->recv_into(buffer, sizeof(buffer))).bytes > 0) {
+                connection->send_all(buffer, result.bytes);
+            }
+            if (result.ok()) {
+                loop.remove(connection->get_fd());
+            }
+        });
+    });
+    ASSERT_THROWS(network::socket_error, [&]() {
+        server.start([](network::EventLoop&, network::Socket) {});
+    });
+    
+    const uint clients = 16;
+    for (uint i = 0; i < clients; ++i) {
+        network::Socket client = network::Socket();
+        client.connect("127.0.0.1", 8090);
+        client.send_all("hi", 2);
+        char reply[2];
+        network::IOResult result = client.recv_exact(reply, 2, 5s);
+        ASSERT(result.bytes == 2);
+        ASSERT(std::string(reply, 2) == "hi");
+    }
+    
+    std::vector<ulong> accepted = server.get_accepted();
+    ASSERT(accepted.size() == 2);
+    ASSERT(std::accumulate(accepted.begin(), accepted.end(), 0ul) == clients);
+    server.stop();
+    ASSERT(server.get_accepted().empty());
+    ASSERT(served.size() == clients);
+}
+
+void test_sharded_server_conflict() {
+    network::Socket other = network::Socket();
+    other.set(network::SockOpt::REUSEADDR, 1);
+    other.bind(8091);
+    other.listen(1);
+    network::ShardedServer server(8091, 2);
+    ASSERT_THROWS(network::socket_error, [&]() {
+        server.start([](network::EventLoop&, network::Socket) {});
+    });
+    ASSERT(server.get_accepted().empty());
+}
+
+void run_sharded_server_tests() {
+    TEST(test_sharded_server)
+    TEST(test_sharded_server_conflict)
+}
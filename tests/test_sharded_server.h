@@ -0,0 +1,3 @@
+#pragma once
+
+void run_sharded_server_tests();
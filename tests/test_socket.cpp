@@ -1,7 +1,10 @@
 
 #include <sstream>
+#include <cerrno>
 #include <thread>
 #include "at_tests"
+#include <netinet/tcp.h>
+#include <unistd.h>
 #include "network/socket.h"
 
 static std::stringstream* stream;
@@ -51,6 +54,213 @@ void test_sockets() {
     ASSERT(stream->str() == "hello world");
 }
 
+void test_socket_exact() {
+    network::Socket listener = network::Socket();
+    int val = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &val);
+    listener.bind(8084);
+    listener.listen(2);
+    
+    // The client sends its last bytes only once told to, so the server sees an empty socket before then
+    ulong first_sent = 0, second_sent = 0;
+    bool last_sent = false;
+    std::thread client([&]() {
+        network::Socket soc = network::Socket();
+        soc.connect("127.0.0.1", 8084);
+        first_sent = soc.send_some("abc", 3).bytes;
+        second_sent = soc.send_all("defgh", 5).bytes;
+        char signal;
+        soc.recv_exact(&signal, 1);
+        last_sent = soc.send_all("ij", 2).ok();
+        soc.recv_exact(&signal, 1);
+    });
+    
+    network::Socket accepted = listener.accept();
+    char buffer[16] = {};
+    network::IOResult result = accepted.recv_exact(buffer, 8);
+    ASSERT(result.ok());
+    ASSERT(result.bytes == 8);
+    ASSERT(std::string(buffer, 8) == "abcdefgh");
+    
+    accepted.set_blocking(false);
+    result = accepted.recv_into(buffer, sizeof(buffer));
+    ASSERT(result.would_block());
+    ASSERT(result.bytes == 0);
+    accepted.send_all("?", 1);
+    
+    result = accepted.recv_exact(buffer, 4, std::chrono::milliseconds(1000));
+    ASSERT(result.error == ETIMEDOUT);
+    ASSERT(result.bytes == 2);
+    ASSERT(std::string(buffer, 2) == "ij");
+    accepted.send_all("!", 1);
+    client.join();
+    ASSERT(first_sent == 3);
+    ASSERT(second_sent == 5);
+    ASSERT(last_sent);
+    
+    result = accepted.recv_exact(buffer, 4, std::chrono::milliseconds(1000));
+    ASSERT(result.ok());
+    ASSERT(result.bytes == 0);
+}
+
+void test_socket_vectored() {
+    network::Socket listener = network::Socket();
+    int val = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &val);
+    listener.bind(8085);
+    listener.listen(2);
+    
+    ulong head_sent = 0;
+    network::IOResult large_sent;
+    std::thread client([&]() {
+        network::Socket soc = network::Socket();
+        soc.connect("127.0.0.1", 8085);
+        head_sent = soc.send_vectored({{"head", 4}, {"", 0}, {"body", 4}}).bytes;
+        
+        std::string large(200000, 'x');
+        network::ConstBuffer parts[] = {{"size", 4}, {large.data(), large.size()}, {"end", 3}};
+        network::CorkGuard cork(soc);
+        large_sent = soc.send_all_vectored(parts, 3, AT_MSG_MORE);
+    });
+    
+    network::Socket accepted = listener.accept();
+    char head[4], body[6];
+    network::MutableBuffer parts[] = {{head, 4}, {body, 6}};
+    ulong total = 0;
+    while (total < 8) {
+        network::IOResult result = accepted.recv_vectored(parts, 2, MSG_PEEK);
+        ASSERT(result.ok());
+        total = result.bytes;
+    }
+    ASSERT(std::string(head, 4) == "head");
+    ASSERT(std::string(body, 4) == "body");
+    network::IOResult result = accepted.recv_exact(body, 6);
+    ASSERT(std::string(body, 6) == "headbo");
+    
+    std::string received;
+    char buffer[4096];
+    while ((result = accepted.recv_into(buffer, sizeof(buffer))).bytes > 0) {
+        received.append(buffer, result.bytes);
+    }
+    client.join();
+    ASSERT(head_sent == 8);
+    ASSERT(large_sent.ok());
+    ASSERT(large_sent.bytes == 200007);
+    ASSERT(received.size() == 200009);
+    ASSERT(received.compare(0, 6, "dysize") == 0);
+    ASSERT(received.compare(received.size() - 4, 4, "xend") == 0);
+}
+
+void test_socket_options() {
+    network::Socket soc = network::Socket();
+    soc.set(network::SockOpt::REUSEADDR, 1);
+    ASSERT(soc.get(network::SockOpt::REUSEADDR) != 0);
+    soc.set(network::SockOpt::NODELAY, 1);
+    ASSERT(soc.get(network::SockOpt::NODELAY) != 0);
+    soc.set(network::SockOpt::NODELAY, 0);
+    ASSERT(soc.get(network::SockOpt::NODELAY) == 0);
+    
+    linger value {1, 5};
+    soc.set(network::SockOpt::LINGER, value);
+    ASSERT(soc.get(network::SockOpt::LINGER).l_linger == 5);
+    
+    network::TypedSockOpt<int> max_segment("Max Segment", IPPROTO_TCP, TCP_MAXSEG);
+    ASSERT(soc.get(max_segment) > 0);
+    
+    network::TypedSockOpt<int> unsupported("Unsupported", SOL_SOCKET, -1);
+    ASSERT_THROWS(network::socket_error, [&]() {
+        soc.set(unsupported, 1);
+    });
+    ASSERT_THROWS(network::socket_error, [&]() {
+        soc.setopt(network::SockOpt("Invalid", SOL_SOCKET, 99999, sizeof(int)), &value);
+    });
+}
+
+void test_unix_sockets() {
+    network::Socket listener((ushort)AF_UNIX, (uint)SOCK_STREAM);
+    listener.bind(network::abstract_name("alpha-tools-test"));
+    listener.listen(1);
+    network::Socket client((ushort)AF_UNIX, (uint)SOCK_STREAM);
+    client.connect(network::abstract_name("alpha-tools-test"));
+    network::Socket server = listener.accept();
+    client.send_all("abstract", 8);
+    char buffer[16];
+    ASSERT(server.recv_exact(buffer, 8).bytes == 8);
+    ASSERT(std::string(buffer, 8) == "abstract");
+    
+    std::string path = "test_unix_seqpacket.sock";
+    ::unlink(path.c_str());
+    network::Socket packets((ushort)AF_UNIX, (uint)SOCK_SEQPACKET);
+    packets.bind(path);
+    packets.listen(1);
+    network::Socket sender((ushort)AF_UNIX, (uint)SOCK_SEQPACKET);
+    sender.connect(path);
+    network::Socket receiver = packets.accept();
+    sender.send_all("one", 3);
+    sender.send_all("two!", 4);
+    ASSERT(receiver.recv_into(buffer, sizeof(buffer)).bytes == 3);
+    ASSERT(receiver.recv_into(buffer, sizeof(buffer)).bytes == 4);
+    ASSERT(std::string(buffer, 4) == "two!");
+    ::unlink(path.c_str());
+    
+    ASSERT_THROWS(network::socket_error, [&]() {
+        network::Socket invalid((ushort)AF_UNIX, (uint)SOCK_STREAM);
+        invalid.bind(std::string(200, 'x'));
+    });
+}
+
+void test_fd_passing() {
+    auto pair = network::Socket::pair(SOCK_SEQPACKET);
+    
+    int pipe_fds[2];
+    ASSERT(::pipe(pipe_fds) == 0);
+    auto connection = network::Socket::pair();
+    int passed[] = {pipe_fds[1], (int)connection.second.get_fd()};
+    network::IOResult result = pair.first.send_fds("fds", 3, passed, 2);
+    ASSERT(result.ok());
+    ASSERT(result.bytes == 3);
+    ::close(pipe_fds[1]);
+    
+    char buffer[8];
+    std::vector<int> received;
+    result = pair.second.recv_fds(buffer, sizeof(buffer), received);
+    ASSERT(result.ok());
+    ASSERT(result.bytes == 3);
+    ASSERT(received.size() == 2);
+    
+    ASSERT(::write(received[0], "piped", 5) == 5);
+    ::close(received[0]);
+    ASSERT(::read(pipe_fds[0], buffer, sizeof(buffer)) == 5);
+    ASSERT(std::string(buffer, 5) == "piped");
+    ::close(pipe_fds[0]);
+    
+    network::Socket handed = network::Socket::adopt((ulong)received[1]);
+    handed.send_all("handed", 6);
+    ASSERT(connection.first.recv_exact(buffer, 6).bytes == 6);
+    ASSERT(std::string(buffer, 6) == "handed");
+    
+    ASSERT(pair.first.send_fds("", 0, passed, 1).error == EINVAL);
+    
+    // Credentials take up part of the control buffer, so the most descriptors allowed no longer fit
+    network::TypedSockOpt<int> pass_credentials("Pass Credentials", SOL_SOCKET, SO_PASSCRED);
+    pair.second.set(pass_credentials, 1);
+    std::vector<int> many(AT_MAX_FDS, (int)connection.first.get_fd());
+    ASSERT(pair.first.send_fds("many", 4, many.data(), many.size()).ok());
+    received.clear();
+    result = pair.second.recv_fds(buffer, sizeof(buffer), received);
+    ASSERT(result.error == EMSGSIZE);
+    ASSERT(result.bytes == 4);
+    ASSERT(received.size() < AT_MAX_FDS);
+    for (int fd : received) {
+        ::close(fd);
+    }
+}
+
 void run_socket_tests() {
     TEST(test_sockets)
+    TEST(test_socket_options)
+    TEST(test_socket_exact)
+    TEST(test_socket_vectored)
+    TEST(test_unix_sockets)
+    TEST(test_fd_passing)
 }
@@ -0,0 +1,76 @@
+
+#include <string>
+#include <thread>
+#include "at_tests"
+#include "at_utils"
+#include "network/stream.h"
+#include "test_stream.h"
+
+void test_socket_stream() {
+    network::Socket listener = network::Socket();
+    listener.set(network::SockOpt::REUSEADDR, 1);
+    listener.bind(8095);
+    listener.listen(1);
+    
+    std::string large(1 << 20, '\0');
+    for (ulong i = 0; i < large.size(); ++i) {
+        large[i] = (char)(i * 7);
+    }
+    
+    bool client_good = false;
+    std::string reply;
+    std::thread client([&]() {
+        network::Socket socket = network::Socket();
+        socket.connect("127.0.0.1", 8095);
+        network::SocketStream stream(socket, 256, 256);
+        for (uint i = 0; i < 1000; ++i) {
+            util::write_uint(stream, i);
+            util::write_ushort<Endian::LITTLE>(stream, (ushort)(i * 3));
+        }
+        util::write_double(stream, 2.5);
+        util::write_string(stream, "hello");
+        stream.write(large.data(), (std::streamsize)large.size());
+        stream << "text " << 42 << '\n';
+        stream.flush();
+        client_good = stream.good();
+        
+        reply = util::next_string(stream, 2);
+    });
+    
+    network::Socket server = listener.accept();
+    network::SocketStream stream(server, 512);
+    bool matched = true;
+    for (uint i = 0; i < 1000; ++i) {
+        matched = matched && util::next_uint(stream) == i;
+        matched = matched && util::next_ushort<Endian::LITTLE>(stream) == (ushort)(i * 3);
+    }
+    ASSERT(matched);
+    ASSERT(util::next_double(stream) == 2.5);
+    ASSERT(util::next_string(stream, 5) == "hello");
+    
+    std::string received(large.size(), '\0');
+    stream.read(&received[0], (std::streamsize)received.size());
+    ASSERT(stream.gcount() == (std::streamsize)large.size());
+    ASSERT(received == large);
+    
+    std::string word;
+    int number;
+    stream >> word >> number;
+    ASSERT(word == "text");
+    ASSERT(number == 42);
+    
+    util::write_string(stream, "ok");
+    stream.flush();
+    client.join();
+    ASSERT(client_good);
+    ASSERT(reply == "ok");
+    
+    char extra;
+    stream.get();
+    ASSERT(!stream.read(&extra, 1));
+    ASSERT(stream.eof());
+}
+
+void run_stream_tests() {
+    TEST(test_socket_stream)
+}
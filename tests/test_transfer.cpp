@@ -0,0 +1,153 @@
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include "at_tests"
+#include "network/transfer.h"
+#include "test_transfer.h"
+
+/**
+ * Connect a client to a listener, returning both ends of the connection
+ */
+static std::pair<network::Socket, network::Socket> connect_pair(network::Socket& listener, ushort port) {
+    network::Socket client = network::Socket();
+    client.connect("127.0.0.1", port);
+    return {std::move(client), listener.accept()};
+}
+
+/**
+ * Receive until the peer closes the connection
+ */
+static std::string recv_all(network::Socket& socket) {
+    std::string received;
+    char buffer[4096];
+    network::IOResult result;
+    while ((result = socket.recv_into(buffer, sizeof(buffer))).bytes > 0) {
+        received.append(buffer, result.bytes);
+    }
+    return received;
+}
+
+void test_send_file() {
+    std::string contents;
+    for (uint i = 0; i < 50000; ++i) {
+        contents += std::to_string(i) + "\n";
+    }
+    {
+        std::ofstream out("test_send_file.txt", std::ios::binary);
+        out << contents;
+    }
+    
+    network::Socket listener = network::Socket();
+    int val = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &val);
+    listener.bind(8086);
+    listener.listen(2);
+    auto ends = connect_pair(listener, 8086);
+    
+    std::string received;
+    std::thread reader([&]() {
+        received = recv_all(ends.second);
+    });
+    network::IOResult result = network::send_file(ends.first, "test_send_file.txt", 10);
+    ASSERT(result.ok());
+    ASSERT(result.bytes == contents.size() - 10);
+    ends.first.shutdown(SHUT_WR);
+    reader.join();
+    ASSERT(received == contents.substr(10));
+    
+    ASSERT_THROWS(std::runtime_error, []() {
+        network::Socket socket = network::Socket();
+        network::send_file(socket, "test_send_file_missing.txt");
+    });
+    std::remove("test_send_file.txt");
+}
+
+void test_splice() {
+    network::Socket listener = network::Socket();
+    int val = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &val);
+    listener.bind(8087);
+    listener.listen(4);
+    auto inbound = connect_pair(listener, 8087);
+    auto outbound = connect_pair(listener, 8087);
+    inbound.second.set_blocking(false);
+    outbound.first.set_blocking(false);
+    
+    network::Pipe pipe;
+    ASSERT(pipe.get_capacity() > 0);
+    network::IOResult result = network::splice(inbound.second, outbound.first, pipe, 1024);
+    ASSERT(result.would_block());
+    ASSERT(result.bytes == 0);
+    
+    std::string payload(300000, 'p');
+    std::thread writer([&]() {
+        inbound.first.send_all(payload.data(), payload.size());
+        inbound.first.shutdown(SHUT_WR);
+    });
+    std::string received;
+    std::thread reader([&]() {
+        received = recv_all(outbound.second);
+    });
+    
+    ulong moved = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < end) {
+        result = network::splice(inbound.second, outbound.first, pipe, ~(ulong)0);
+        moved += result.bytes;
+        if (result.ok()) {
+            break;
+        }
+        ASSERT(result.would_block());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT(moved == payload.size());
+    ASSERT(pipe.get_buffered() == 0);
+    outbound.first.shutdown(SHUT_WR);
+    writer.join();
+    reader.join();
+    ASSERT(received == payload);
+}
+
+void test_splice_fallback() {
+    int file_fd = ::open("test_splice_fallback.txt", O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    ASSERT(file_fd >= 0);
+    auto ends = network::Socket::pair();
+    std::string payload(200000, 'f');
+    std::thread writer([&]() {
+        ends.first.send_all(payload.data(), payload.size());
+        ends.first.shutdown(SHUT_WR);
+    });
+    
+    network::Pipe pipe;
+    network::IOResult result;
+    ulong moved = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < end) {
+        result = network::splice(ends.second.get_fd(), (ulong)file_fd, pipe, ~(ulong)0);
+        moved += result.bytes;
+        if (!result.would_block()) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    writer.join();
+    ::close(file_fd);
+    ASSERT(result.ok());
+    ASSERT(moved == payload.size());
+    ASSERT(pipe.get_buffered() == 0);
+    
+    std::ifstream in("test_splice_fallback.txt", std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT(written == payload);
+    std::remove("test_splice_fallback.txt");
+}
+
+void run_transfer_tests() {
+    TEST(test_send_file)
+    TEST(test_splice)
+    TEST(test_splice_fallback)
+}
@@ -0,0 +1,108 @@
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "at_tests"
+#include "network/uring.h"
+#include "test_uring.h"
+
+using namespace std::chrono_literals;
+
+/**
+ * Run a loop until a condition holds, or a few seconds pass
+ */
+template<typename Condition>
+static void run_until(network::EventLoop& loop, Condition condition) {
+    auto end = std::chrono::steady_clock::now() + 5s;
+    while (!condition() && std::chrono::steady_clock::now() < end) {
+        loop.run_once(100ms);
+    }
+}
+
+void test_event_loop_backends() {
+    network::EventLoop* epoll_loop = network::make_event_loop(network::LoopBackend::EPOLL);
+    ASSERT(dynamic_cast<network::Reactor*>(epoll_loop) != nullptr);
+    delete epoll_loop;
+    
+    network::EventLoop* loop = network::make_event_loop(network::LoopBackend::IO_URING);
+    if (!network::UringReactor::supported()) {
+        ASSERT(dynamic_cast<network::Reactor*>(loop) != nullptr);
+        delete loop;
+        throw testing::skip_test("io_uring isn't supported by this kernel");
+    }
+    ASSERT(dynamic_cast<network::UringReactor*>(loop) != nullptr);
+    delete loop;
+    
+    loop = network::make_event_loop();
+    ASSERT(dynamic_cast<network::UringReactor*>(loop) != nullptr);
+    delete loop;
+}
+
+void test_uring_completions() {
+    if (!network::UringReactor::supported()) {
+        throw testing::skip_test("io_uring isn't supported by this kernel");
+    }
+    network::UringReactor reactor;
+    network::Socket listener((ushort)AF_INET, (uint)SOCK_STREAM);
+    int reuse = 1;
+    listener.setopt(network::SockOpt::REUSEADDR, &reuse);
+    listener.bind(8089);
+    listener.listen(4);
+    
+    network::Socket server;
+    bool accepted = false;
+    reactor.accept(listener, [&](network::Socket socket, int error) {
+        ASSERT(error == 0);
+        server = std::move(socket);
+        accepted = true;
+    });
+    network::Socket client = network::Socket();
+    client.connect("127.0.0.1", 8089);
+    run_until(reactor, [&]() { return accepted; });
+    ASSERT(accepted);
+    
+    char buffer[16] = {};
+    network::IOResult received, sent;
+    reactor.recv(server, buffer, sizeof(buffer), [&](network::IOResult result) { received = result; });
+    reactor.send(client, "hello", 5, [&](network::IOResult result) { sent = result; });
+    ASSERT(reactor.get_pending() == 2);
+    run_until(reactor, [&]() { return reactor.get_pending() == 0; });
+    ASSERT(sent.bytes == 5);
+    ASSERT(received.ok());
+    ASSERT(std::string(buffer, received.bytes) == "hello");
+    
+    int fd = ::open("test_uring.txt", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    reactor.register_buffers(2, 4096);
+    std::memcpy(reactor.get_buffer(0), "registered", 10);
+    network::IOResult written, read;
+    reactor.write_fixed((ulong)fd, 0, 10, 0, [&](network::IOResult result) { written = result; });
+    run_until(reactor, [&]() { return reactor.get_pending() == 0; });
+    ASSERT(written.bytes == 10);
+    reactor.read_fixed((ulong)fd, 1, 4096, 0, [&](network::IOResult result) { read = result; });
+    run_until(reactor, [&]() { return reactor.get_pending() == 0; });
+    ASSERT(read.bytes == 10);
+    ASSERT(std::string(reactor.get_buffer(1), 10) == "registered");
+    
+    reactor.write((ulong)fd, "plain", 5, 10, [&](network::IOResult result) { written = result; });
+    reactor.read((ulong)fd, buffer, sizeof(buffer), 0, [&](network::IOResult result) { read = result; });
+    run_until(reactor, [&]() { return reactor.get_pending() == 0; });
+    ASSERT(written.bytes == 5);
+    ASSERT(read.bytes == 10 || read.bytes == 15);
+    ASSERT_THROWS(std::out_of_range, [&]() {
+        reactor.read_fixed((ulong)fd, 2, 10, 0, [](network::IOResult) {});
+    });
+    
+    reactor.recv(server, buffer, sizeof(buffer), [&](network::IOResult result) { received = result; });
+    client.shutdown(SHUT_WR);
+    run_until(reactor, [&]() { return reactor.get_pending() == 0; });
+    ASSERT(received.ok());
+    ASSERT(received.bytes == 0);
+    ::close(fd);
+    std::remove("test_uring.txt");
+}
+
+void run_uring_tests() {
+    TEST(test_event_loop_backends)
+    TEST(test_uring_completions)
+}
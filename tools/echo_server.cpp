@@ -0,0 +1,137 @@
+
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <cerrno>
+#include "argparser.h"
+#include "network/uring.h"
+
+/**
+ * \file echo_server.cpp
+ * \brief Example event-driven TCP echo server
+ *
+ * Serves any number of connections from one thread with an event loop, writing back everything each client sends.
+ * Connections that can't take the data yet have it queued, and are watched for writability until it's sent. A
+ * repeating timer prints how many clients are connected.
+ *
+ * The backend is io_uring where the kernel supports it and epoll otherwise, unless one is picked with --backend.
+ *
+ * Usage: `echo_server [--port=<port>] [--stats=<seconds>] [--backend=auto|epoll|uring]`
+ */
+
+/**
+ * A client connection and the data waiting to be echoed back to it
+ */
+struct Connection {
+    network::Socket socket;
+    std::string pending;
+    bool writing = false;
+};
+
+static std::unordered_map<ulong, std::unique_ptr<Connection>> connections;
+
+/**
+ * Stop serving a connection, closing it
+ */
+static void drop(network::EventLoop& loop, ulong fd) {
+    loop.remove(fd);
+    connections.erase(fd);
+}
+
+/**
+ * Send as much pending data as the connection will take, then watch for writability only if some is left
+ *
+ * \return Whether the connection is still usable
+ */
+static bool flush(network::EventLoop& loop, Connection& connection) {
+    network::IOResult result = connection.socket.send_all(connection.pending.data(), connection.pending.size());
+    if (!result.ok() && !result.would_block()) {
+        return false;
+    }
+    connection.pending.erase(0, result.bytes);
+    bool writing = !connection.pending.empty();
+    if (writing != connection.writing) {
+        loop.modify(connection.socket.get_fd(), writing ? network::IO_READ | network::IO_WRITE : network::IO_READ);
+        connection.writing = writing;
+    }
+    return true;
+}
+
+/**
+ * Read everything a connection has sent, queue it to echo, and send what can be sent
+ *
+ * \return Whether the connection is still open
+ */
+static bool echo(network::EventLoop& loop, Connection& connection) {
+    char buffer[64 * 1024];
+    while (true) {
+        network::IOResult result = connection.socket.recv_into(buffer, sizeof(buffer));
+        if (result.would_block()) {
+            break;
+        }
+        if (!result.ok() || result.bytes == 0) {
+            return false;
+        }
+        connection.pending.append(buffer, result.bytes);
+    }
+    return flush(loop, connection);
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    ushort port = args.has_variable("port") ? (ushort)std::stoul(args.get_variable("port")) : 7000;
+    long stats = args.has_variable("stats") ? std::stol(args.get_variable("stats")) : 10;
+    std::string name = args.has_variable("backend") ? args.get_variable("backend") : "auto";
+    network::LoopBackend backend = name == "epoll" ? network::LoopBackend::EPOLL :
+                                   name == "uring" ? network::LoopBackend::IO_URING : network::LoopBackend::AUTO;
+    
+    try {
+        network::EventLoop* loop = network::make_event_loop(backend);
+        network::Socket listener((ushort)AF_INET, (uint)SOCK_STREAM);
+        int reuse = 1;
+        listener.setopt(network::SockOpt::REUSEADDR, &reuse);
+        listener.bind(port);
+        listener.listen(4096);
+        
+        std::vector<network::Socket> accepted;
+        loop->add(listener, network::IO_READ, [&](uint) {
+            try {
+                listener.accept_many(accepted);
+            } catch (network::socket_error& e) {
+                std::cerr << e.what() << ", errno " << errno << std::endl;
+            }
+            for (auto& socket : accepted) {
+                ulong fd = socket.get_fd();
+                Connection* connection = new Connection();
+                connection->socket = std::move(socket);
+                connections[fd] = std::unique_ptr<Connection>(connection);
+                loop->add(fd, network::IO_READ, [loop, connection, fd](uint events) {
+                    bool open = !(events & network::IO_ERROR);
+                    if (open && (events & network::IO_READ)) {
+                        open = echo(*loop, *connection);
+                    } else if (open && (events & network::IO_WRITE)) {
+                        open = flush(*loop, *connection);
+                    }
+                    if (!open || ((events & network::IO_HANGUP) && connection->pending.empty())) {
+                        drop(*loop, fd);
+                    }
+                });
+            }
+            accepted.clear();
+        });
+        
+        if (stats > 0) {
+            loop->add_timer(std::chrono::seconds(stats), []() {
+                std::cout << connections.size() << " clients connected" << std::endl;
+            }, std::chrono::seconds(stats));
+        }
+        bool uring = dynamic_cast<network::UringReactor*>(loop) != nullptr;
+        std::cout << "Echoing on port " << port << " with " << (uring ? "io_uring" : "epoll") << std::endl;
+        loop->run();
+        delete loop;
+    } catch (network::socket_error& e) {
+        std::cerr << "Echo server failed: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "argparser.h"
+#include "logging/file_handler.h"
+#include "logging/shipping.h"
+
+/**
+ * \file log_collector.cpp
+ * \brief Receives shipped log batches and writes them to a file
+ *
+ * Listens for connections from ShippingHandlers, on a TCP port or a Unix domain socket, and writes every record
+ * received into one log file. Each connection is read on its own thread, and the file is flushed once per batch.
+ *
+ * Usage: `log_collector (--port=<port> | --unix=<path>) --out=<log file>`
+ */
+
+static const std::string collector_name = "collector";
+
+/**
+ * Read batches from one connection until it closes, writing their records to the file
+ */
+static void serve(network::Socket connection, logging::BufferedFileHandler* file) {
+    std::vector<logging::ShippedRecord> records;
+    try {
+        while (logging::read_batch(connection, records)) {
+            for (const auto& shipped : records) {
+                logging::Record record = {shipped.level, &collector_name, &shipped.text, &shipped.text,
+                                          logging::SourceLocation()};
+                if (file->accepts(record)) {
+                    file->handle(record);
+                }
+            }
+            records.clear();
+            file->flush();
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Dropped connection: " << e.what() << std::endl;
+    }
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    if (!args.has_variable("out") || args.has_variable("port") == args.has_variable("unix")) {
+        std::cerr << "Usage: log_collector (--port=<port> | --unix=<path>) --out=<log file>" << std::endl;
+        return 2;
+    }
+    logging::__ensure_levels();
+    
+    try {
+        logging::BufferedFileHandler file(args.get_variable("out"));
+        network::Socket server((ushort)(args.has_variable("port") ? AF_INET : AF_UNIX), (uint)SOCK_STREAM);
+        if (args.has_variable("port")) {
+            int reuse = 1;
+            server.setopt(network::SockOpt::REUSEADDR, &reuse);
+            server.bind((ushort)std::stoi(args.get_variable("port")));
+        } else {
+            std::remove(args.get_variable("unix").c_str());
+            server.bind(args.get_variable("unix"));
+        }
+        server.listen(64);
+        
+        while (true) {
+            std::thread(serve, server.accept(), &file).detach();
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Collector failed: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,41 @@
+
+#include <iostream>
+#include <fstream>
+#include "argparser.h"
+#include "logging/binary.h"
+
+/**
+ * \file log_decode.cpp
+ * \brief Renders binary log files as text
+ *
+ * Usage: `log_decode <binary log> [--out=<text file>]`
+ */
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    if (args.num_arguments() != 1) {
+        std::cerr << "Usage: log_decode <binary log> [--out=<text file>]" << std::endl;
+        return 2;
+    }
+    
+    std::ifstream in(args.get_argument(0), std::ios::binary);
+    if (!in) {
+        std::cerr << "Couldn't open " << args.get_argument(0) << std::endl;
+        return 1;
+    }
+    
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+    if (args.has_variable("out")) {
+        file.open(args.get_variable("out"));
+        out = &file;
+    }
+    
+    try {
+        logging::decode_binary(in, *out);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Failed to decode " << args.get_argument(0) << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+
+#include <iostream>
+#include <cstring>
+#include <string_view>
+#include "argparser.h"
+#include "logging/log_index.h"
+
+/**
+ * \file log_query.cpp
+ * \brief Searches a log file through its sidecar index
+ *
+ * Maps a log written by a BufferedFileHandler with an index, and prints only the lines in blocks that may hold
+ * records in a time range, at or above a level, or from a logger. Lines in those blocks can be filtered further by
+ * text. Times are given in seconds since the Unix epoch, and may have a fractional part. With --regions, prints the
+ * matching byte ranges and how much of the log they cover instead of the lines.
+ *
+ * Usage: `log_query <log file> [--from=<time>] [--to=<time>] [--level=<name>] [--logger=<name>]
+ * [--contains=<text>] [--regions]`
+ */
+
+/**
+ * Convert a time in seconds given on the command line to nanoseconds
+ */
+static ulong parse_time(const std::string& text) {
+    return (ulong)(std::stod(text) * 1e9);
+}
+
+int main(int argc, const char** argv) {
+    ArgParser args = ArgParser(argc, argv);
+    if (args.num_arguments() != 1) {
+        std::cerr << "Usage: log_query <log file> [--from=<time>] [--to=<time>] [--level=<name>] "
+                     "[--logger=<name>] [--contains=<text>] [--regions]" << std::endl;
+        return 2;
+    }
+    
+    logging::IndexQuery query;
+    try {
+        if (args.has_variable("from")) {
+            query.start_time = parse_time(args.get_variable("from"));
+        }
+        if (args.has_variable("to")) {
+            query.end_time = parse_time(args.get_variable("to"));
+        }
+    } catch (std::logic_error&) {
+        std::cerr << "Times must be seconds since the Unix epoch" << std::endl;
+        return 2;
+    }
+    if (args.has_variable("level")) {
+        query.min_level = logging::find_level(args.get_variable("level"));
+        if (query.min_level == nullptr) {
+            std::cerr << "Unknown level " << args.get_variable("level") << std::endl;
+            return 2;
+        }
+    }
+    if (args.has_variable("logger")) {
+        query.logger = args.get_variable("logger");
+    }
+    std::string contains = args.has_variable("contains") ? args.get_variable("contains") : "";
+    
+    try {
+        logging::LogIndex index(args.get_argument(0));
+        std::vector<logging::LogRegion> regions = index.find(query);
+        
+        if (args.has_flag("regions")) {
+            ulong covered = 0;
+            for (auto& region : regions) {
+                std::cout << region.offset << " " << region.length << std::endl;
+                covered += region.length;
+            }
+            std::cerr << regions.size() << " regions, " << covered << " of " << index.get_size() << " bytes from "
+                      << index.get_entries().size() << " index entries" << std::endl;
+            return 0;
+        }
+        
+        for (auto& region : regions) {
+            const char* line = region.data;
+            const char* end = region.data + region.length;
+            while (line < end) {
+                const char* next = (const char*)std::memchr(line, '\n', (ulong)(end - line));
+                ulong length = next != nullptr ? (ulong)(next - line) : (ulong)(end - line);
+                std::string_view text(line, length);
+                if (contains.empty() || text.find(contains) != std::string_view::npos) {
+                    std::cout << text << '\n';
+                }
+                line += length + 1;
+            }
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Failed to query " << args.get_argument(0) << ": " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}